@@ -0,0 +1,417 @@
+#ifndef QEMS_AGGREGATES_H_
+#define QEMS_AGGREGATES_H_
+
+#include <LittleFS.h>
+#include <QEMSBlockWriter.h>
+#include <QEMSCsvParser.h>
+#include <QEMSDataSource.h>
+#include <vector>
+
+/**
+ * File extension of the aggregate files, the aggregates of "/co2.csv" are stored in "/co2.csv.agg".
+ */
+#define AGGREGATE_SUFFIX ".agg"
+
+/**
+ * File extension of the archive with the hour and day buckets of the records dropped from a data file, e.g. "/co2.csv.arc". It has the format of an
+ * aggregate file without minute buckets.
+ */
+#define ARCHIVE_SUFFIX ".arc"
+
+/**
+ * Number of days before the oldest record of a data file the hour buckets are archived for, only day buckets are kept for older records.
+ */
+#define ARCHIVE_HOUR_DAYS 31
+
+/**
+ * Number of aggregation levels and the span of a bucket per level in seconds: minutes, hours and days (UTC).
+ */
+#define AGGREGATE_LEVELS 3
+#define AGGREGATE_SPANS {60, 3600, 86400}
+
+/**
+ * @brief aggregated values of a channel over a time range, the values are in percent.
+ */
+struct QEMSAggregate {
+    uint32_t count; // number of records in the range
+    float min;
+    float max;
+    float mean;
+    float sum;
+};
+
+/**
+ * @brief multi resolution aggregates of a CSV data file. For every minute, hour and day containing records the number of records and the minimum, maximum and
+ * sum of the values of each channel of the file are stored, so a query over any range combines a few buckets of the coarsest fitting level with buckets of
+ * the finer levels at its edges instead of reading the records.
+ *
+ * The aggregates are written while the complete data file is parsed anyway. The minute buckets are written directly to the file, the far fewer hour and
+ * day buckets are collected in RAM and appended at the end together with a trailer describing the levels.
+ *
+ * Records dropped from the data file by the retention (see QEMSRetention) keep their hour and day buckets in the archive of the data file, the archived
+ * buckets are copied in front of the buckets of the records whenever the aggregates are written, so queries still cover the dropped records.
+ */
+class QEMSAggregates {
+
+    /**
+     * Aggregated values of one channel in a bucket, in hundredth of a percent.
+     */
+    struct Stats {
+        uint16_t min;
+        uint16_t max;
+        uint32_t sum;
+    };
+
+    /**
+     * A bucket of one level. Only the stats of the channels of the file are stored, so the size of a bucket in the file depends on the number of channels.
+     */
+    struct Bucket {
+        uint32_t start; // epoch timestamp of the beginning of the bucket
+        uint32_t count; // number of records in the bucket
+        Stats stats[MAX_CHANNELS];
+    };
+
+    /**
+     * Trailer at the end of the file.
+     */
+    struct Trailer {
+        uint32_t magic;                    // AGGREGATE_MAGIC
+        uint32_t csvSize;                  // size of the aggregated data file, for an archive the end of the archived records
+        uint32_t counts[AGGREGATE_LEVELS]; // number of buckets per level
+        uint32_t channels;                 // number of channels per bucket
+    };
+
+    /**
+     * Aggregated values of one channel over a queried range.
+     */
+    struct Total {
+        uint32_t count;
+        uint16_t min;
+        uint16_t max;
+        uint64_t sum;
+    };
+
+    static const uint32_t AGGREGATE_MAGIC = 0x47474151; // "QAGG"
+
+    typedef QEMSFixedPoint<uint16_t> FixedPoint;
+
+  public:
+    /**
+     * @brief returns the aggregate file for the passed data file.
+     */
+    static String getPath(String csvPath) { return csvPath + AGGREGATE_SUFFIX; }
+
+    /**
+     * @brief returns the archive for the passed data file.
+     */
+    static String getArchivePath(String csvPath) { return csvPath + ARCHIVE_SUFFIX; }
+
+    /**
+     * @brief checks if there are aggregates for the current content of the data file.
+     */
+    static bool exists(String csvPath, size_t csvSize) {
+        File file = LittleFS.open(getPath(csvPath).c_str());
+        Trailer trailer;
+        bool valid = readTrailer(file, trailer) && trailer.csvSize == csvSize;
+        file.close();
+        return valid;
+    }
+
+    /**
+     * @brief starts writing the aggregates of a data file.
+     * @param csvPath the data file
+     * @param csvSize the size of the data file
+     * @param channels the number of channels loaded from the file
+     */
+    bool begin(String csvPath, size_t csvSize, uint8_t channels) {
+        _path = getPath(csvPath);
+        _trailer = {AGGREGATE_MAGIC, (uint32_t)csvSize, {0}, channels};
+        _sorted = true;
+        for (Bucket &bucket : _open) {
+            bucket.count = 0;
+        }
+        _hours.clear();
+        _days.clear();
+
+        // the archived buckets are copied by end(), records of the archived range are ignored
+        File archive = LittleFS.open(getArchivePath(csvPath).c_str());
+        _archivePath = getArchivePath(csvPath);
+        _archive = {0, 0, {0}, 0};
+        if (!readTrailer(archive, _archive) || _archive.channels != channels) {
+            _archive = {0, 0, {0}, 0};
+        }
+        archive.close();
+
+        return _writer.open(_path);
+    }
+
+    /**
+     * @brief adds the next record of the data file.
+     * @param time the timestamp of the record
+     * @param values the values of the channels in hundredth of a percent
+     */
+    void add(time_t time, const uint16_t *values) {
+        static const uint32_t spans[] = AGGREGATE_SPANS;
+
+        if (time < (time_t)_archive.csvSize) {
+            return;
+        }
+
+        for (uint8_t level = 0; level < AGGREGATE_LEVELS; level++) {
+            Bucket &bucket = _open[level];
+            uint32_t start = time - time % spans[level];
+
+            if (bucket.count > 0 && bucket.start != start) {
+                _sorted = _sorted && start > bucket.start;
+                close(level);
+            }
+
+            if (bucket.count == 0) {
+                bucket.start = start;
+                for (uint8_t c = 0; c < _trailer.channels; c++) {
+                    bucket.stats[c] = {values[c], values[c], 0};
+                }
+            }
+
+            bucket.count++;
+            for (uint8_t c = 0; c < _trailer.channels; c++) {
+                Stats &stats = bucket.stats[c];
+                stats.min = min(stats.min, values[c]);
+                stats.max = max(stats.max, values[c]);
+                stats.sum += values[c];
+            }
+        }
+    }
+
+    /**
+     * @brief finishes the aggregates. The file is deleted if the data file is invalid or not sorted by time.
+     * @param valid if the complete data file was aggregated successfully
+     */
+    bool end(bool valid) {
+        for (uint8_t level = 0; level < AGGREGATE_LEVELS; level++) {
+            if (_open[level].count > 0) {
+                close(level);
+            }
+        }
+
+        File archive = _archive.magic == AGGREGATE_MAGIC ? LittleFS.open(_archivePath.c_str()) : File();
+        for (uint8_t level = 1; level < AGGREGATE_LEVELS; level++) {
+            Bucket bucket;
+            for (uint32_t index = 0; index < _archive.counts[level] && readBucket(archive, _archive, level, index, bucket); index++) {
+                _writer.write((const uint8_t *)&bucket, getBucketSize(_trailer.channels));
+                _trailer.counts[level]++;
+            }
+
+            for (Bucket &bucket : level == 1 ? _hours : _days) {
+                _writer.write((const uint8_t *)&bucket, getBucketSize(_trailer.channels));
+            }
+        }
+        archive.close();
+        _writer.write((const uint8_t *)&_trailer, sizeof(_trailer));
+
+        _hours.clear();
+        _hours.shrink_to_fit();
+        _days.clear();
+        _days.shrink_to_fit();
+
+        if (!_writer.close() || !valid || !_sorted) {
+            LittleFS.remove(_path.c_str());
+            return false;
+        }
+
+        Serial.printf("Created aggregates [%s] with %d / %d / %d buckets\n", _path.c_str(), _trailer.counts[0], _trailer.counts[1], _trailer.counts[2]);
+        return true;
+    }
+
+    /**
+     * @brief writes the hour and day buckets of the records before the passed time to the archive of the data file. The aggregates of the data file have to
+     * be up to date, they already contain the buckets archived before.
+     * @param csvPath the data file
+     * @param before the end of the archived records, the start of a day
+     * @return false if the aggregates of the data file are outdated or the archive could not be written
+     */
+    static bool archive(String csvPath, time_t before) {
+        File csv = LittleFS.open(csvPath.c_str());
+        size_t csvSize = csv ? csv.size() : 0;
+        csv.close();
+
+        File file = LittleFS.open(getPath(csvPath).c_str());
+        Trailer trailer;
+        if (!readTrailer(file, trailer) || trailer.csvSize != csvSize) {
+            file.close();
+            return false;
+        }
+
+        // the archive is replaced atomically, a power loss leaves either the old or the new one
+        String path = getArchivePath(csvPath);
+        String temp = path + String(".tmp");
+        QEMSBlockWriter writer;
+        if (!writer.open(temp)) {
+            file.close();
+            return false;
+        }
+
+        Trailer archived = {AGGREGATE_MAGIC, (uint32_t)before, {0}, trailer.channels};
+        for (uint8_t level = 1; level < AGGREGATE_LEVELS; level++) {
+            Bucket bucket;
+            for (uint32_t index = 0; index < trailer.counts[level] && readBucket(file, trailer, level, index, bucket) && (time_t)bucket.start < before;
+                 index++) {
+                if (level == 1 && (time_t)bucket.start < before - ARCHIVE_HOUR_DAYS * 86400) {
+                    continue;
+                }
+                writer.write((const uint8_t *)&bucket, getBucketSize(trailer.channels));
+                archived.counts[level]++;
+            }
+        }
+        writer.write((const uint8_t *)&archived, sizeof(archived));
+        file.close();
+
+        if (!writer.close() || !LittleFS.rename(temp.c_str(), path.c_str())) {
+            LittleFS.remove(temp.c_str());
+            return false;
+        }
+
+        Serial.printf("Archived %d / %d buckets of [%s]\n", archived.counts[1], archived.counts[2], csvPath.c_str());
+        return true;
+    }
+
+    /**
+     * @brief aggregates the values of a channel over a time range. The range is reduced to the full minutes it contains.
+     * @param csvPath the data file of the channel
+     * @param position the position of the channel among the channels loaded from the file
+     * @param from the start of the range (inclusive)
+     * @param to the end of the range (exclusive)
+     * @param result the aggregated values
+     * @return false if there are no aggregates for the data file or no records in the range
+     */
+    static bool query(String csvPath, uint8_t position, time_t from, time_t to, QEMSAggregate &result) {
+        result = {0, 0, 0, 0, 0};
+
+        File csv = LittleFS.open(csvPath.c_str());
+        size_t csvSize = csv ? csv.size() : 0;
+        csv.close();
+
+        File file = LittleFS.open(getPath(csvPath).c_str());
+        Trailer trailer;
+        if (!readTrailer(file, trailer) || trailer.csvSize != csvSize || position >= trailer.channels) {
+            file.close();
+            return false;
+        }
+
+        Total total = {0, UINT16_MAX, 0, 0};
+        collect(file, trailer, position, AGGREGATE_LEVELS - 1, from, to, total);
+        file.close();
+
+        if (total.count == 0) {
+            return false;
+        }
+
+        float scale = 100.0f / FixedPoint::SCALE;
+        result = {total.count, total.min * scale, total.max * scale, (float)total.sum / total.count * scale, total.sum * scale};
+        return true;
+    }
+
+  private:
+    QEMSBlockWriter _writer;
+
+    String _path;
+
+    Trailer _trailer;
+
+    /**
+     * The archive of the data file and its trailer, the magic is 0 without archive.
+     */
+    String _archivePath;
+    Trailer _archive;
+
+    /**
+     * The currently filled bucket of every level.
+     */
+    Bucket _open[AGGREGATE_LEVELS];
+
+    /**
+     * Completed hour and day buckets, written after the minute buckets.
+     */
+    std::vector<Bucket> _hours;
+    std::vector<Bucket> _days;
+
+    bool _sorted = true;
+
+    static size_t getBucketSize(uint32_t channels) { return 2 * sizeof(uint32_t) + channels * sizeof(Stats); }
+
+    void close(uint8_t level) {
+        Bucket &bucket = _open[level];
+        if (level == 0) {
+            _writer.write((const uint8_t *)&bucket, getBucketSize(_trailer.channels));
+        } else {
+            (level == 1 ? _hours : _days).push_back(bucket);
+        }
+        _trailer.counts[level]++;
+        bucket.count = 0;
+    }
+
+    static bool readTrailer(File &file, Trailer &trailer) {
+        return file && file.size() >= sizeof(Trailer) && file.seek(file.size() - sizeof(Trailer)) &&
+               file.read((uint8_t *)&trailer, sizeof(trailer)) == sizeof(trailer) && trailer.magic == AGGREGATE_MAGIC && trailer.channels <= MAX_CHANNELS;
+    }
+
+    /**
+     * @brief reads the bucket with the passed index of a level.
+     */
+    static bool readBucket(File &file, const Trailer &trailer, uint8_t level, uint32_t index, Bucket &bucket) {
+        size_t size = getBucketSize(trailer.channels);
+        uint32_t offset = index;
+        for (uint8_t l = 0; l < level; l++) {
+            offset += trailer.counts[l];
+        }
+        return file.seek(offset * size) && file.read((uint8_t *)&bucket, size) == size;
+    }
+
+    /**
+     * @brief adds the buckets covering the range to the total. The part of the range covered by complete buckets of the level is taken from this level, the
+     * remaining parts at the edges are taken from the next finer level.
+     */
+    static void collect(File &file, const Trailer &trailer, uint8_t position, int level, time_t from, time_t to, Total &total) {
+        static const uint32_t spans[] = AGGREGATE_SPANS;
+
+        if (level < 0 || from >= to) {
+            return;
+        }
+
+        time_t start = (from + spans[level] - 1) / spans[level] * spans[level];
+        time_t end = to / spans[level] * spans[level];
+
+        if (start >= end) {
+            collect(file, trailer, position, level - 1, from, to, total);
+            return;
+        }
+
+        // first bucket of the level starting in the range
+        Bucket bucket;
+        uint32_t lo = 0;
+        uint32_t hi = trailer.counts[level];
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (!readBucket(file, trailer, level, mid, bucket)) {
+                return;
+            }
+            if ((time_t)bucket.start < start) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        for (uint32_t index = lo; index < trailer.counts[level] && readBucket(file, trailer, level, index, bucket) && (time_t)bucket.start < end; index++) {
+            total.count += bucket.count;
+            total.min = min(total.min, bucket.stats[position].min);
+            total.max = max(total.max, bucket.stats[position].max);
+            total.sum += bucket.stats[position].sum;
+        }
+
+        collect(file, trailer, position, level - 1, from, start, total);
+        collect(file, trailer, position, level - 1, end, to, total);
+    }
+};
+
+#endif
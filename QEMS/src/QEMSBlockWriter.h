@@ -0,0 +1,170 @@
+#ifndef QEMS_BLOCK_WRITER_H_
+#define QEMS_BLOCK_WRITER_H_
+
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+
+/**
+ * Block size of the LittleFS partition. Writes of exactly this size starting at a block boundary can be programmed without a read-modify-write cycle.
+ */
+#define FS_BLOCK_SIZE 4096
+
+/**
+ * @brief write combining wrapper around a LittleFS file. Incoming data is staged in a buffer of the file system block size and only whole blocks are written
+ * to the flash, the last partial block is written when the file is closed.
+ */
+class QEMSBlockWriter {
+
+  public:
+    ~QEMSBlockWriter() { abort(); }
+
+    /**
+     * @brief opens (and truncates) the file to write to and allocates the staging buffer.
+     * @param path the absolute path of the file
+     * @return true if the file could be opened
+     */
+    bool open(String path) {
+        abort();
+
+        _buffer = (uint8_t *)malloc(FS_BLOCK_SIZE);
+        if (!_buffer) {
+            Serial.println("Cannot allocate upload buffer");
+            return false;
+        }
+
+        _file = LittleFS.open(path.c_str(), FILE_WRITE);
+        if (!_file) {
+            free(_buffer);
+            _buffer = nullptr;
+            return false;
+        }
+
+        _buffered = 0;
+        _written = 0;
+        _blocks = 0;
+        _crc = 0;
+        return true;
+    }
+
+    /**
+     * @brief stages the passed data and writes every completed block to the file.
+     * @return the number of bytes accepted, less than len if a block could not be written
+     */
+    size_t write(const uint8_t *data, size_t len) {
+        if (!_buffer) {
+            return 0;
+        }
+
+        size_t accepted = 0;
+        while (accepted < len) {
+            size_t chunk = std::min(len - accepted, (size_t)FS_BLOCK_SIZE - _buffered);
+            memcpy(_buffer + _buffered, data + accepted, chunk);
+            _crc = esp_rom_crc32_le(_crc, data + accepted, chunk);
+            _buffered += chunk;
+            accepted += chunk;
+
+            if (_buffered == FS_BLOCK_SIZE && !flush()) {
+                return accepted - chunk;
+            }
+        }
+
+        return accepted;
+    }
+
+    /**
+     * @brief writes the remaining partial block and closes the file.
+     * @return true if all staged data was written
+     */
+    bool close() {
+        if (!_buffer) {
+            return false;
+        }
+
+        bool result = flush();
+        _file.close();
+        free(_buffer);
+        _buffer = nullptr;
+        return result;
+    }
+
+    /**
+     * @brief closes the file without writing the staged data.
+     */
+    void abort() {
+        if (_buffer) {
+            _file.close();
+            free(_buffer);
+            _buffer = nullptr;
+        }
+    }
+
+    /**
+     * @brief returns the number of bytes written to the file system so far.
+     */
+    size_t getWrittenBytes() { return _written; }
+
+    /**
+     * @brief returns the number of write calls issued to the file system so far.
+     */
+    size_t getBlockCount() { return _blocks; }
+
+    /**
+     * @brief returns the CRC32 of the data passed to the writer.
+     */
+    uint32_t getCrc() { return _crc; }
+
+  private:
+    /**
+     * Writes the staged data to the file.
+     */
+    bool flush() {
+        if (_buffered == 0) {
+            return true;
+        }
+
+        size_t writtenBytes = _file.write(_buffer, _buffered);
+        _written += writtenBytes;
+        _blocks++;
+
+        if (writtenBytes != _buffered) {
+            Serial.printf("%d - failed to write\n", writtenBytes);
+            _buffered = 0;
+            return false;
+        }
+
+        _buffered = 0;
+        return true;
+    }
+
+    /**
+     * The file the data is written to.
+     */
+    File _file;
+
+    /**
+     * Staging buffer with the size of one file system block, only allocated while a file is open.
+     */
+    uint8_t *_buffer = nullptr;
+
+    /**
+     * Number of bytes currently staged in the buffer.
+     */
+    size_t _buffered = 0;
+
+    /**
+     * Number of bytes written to the file.
+     */
+    size_t _written = 0;
+
+    /**
+     * Number of write calls issued to the file system.
+     */
+    size_t _blocks = 0;
+
+    /**
+     * CRC32 of the data passed to the writer.
+     */
+    uint32_t _crc = 0;
+};
+
+#endif
@@ -0,0 +1,586 @@
+#ifndef QEMS_COMPRESSED_SERIES_H_
+#define QEMS_COMPRESSED_SERIES_H_
+
+#include <LittleFS.h>
+#include <QEMSBlockWriter.h>
+#include <QEMSCsvParser.h>
+#include <QEMSDataSource.h>
+#include <vector>
+
+/**
+ * Number of records per block of a compressed series. Every block is decoded on its own, so it is the granularity of a seek.
+ */
+#define SERIES_BLOCK_RECORDS 128
+
+/**
+ * File extension of the compressed file written while a CSV data file is converted.
+ */
+#define SERIES_SUFFIX ".qts"
+
+/**
+ * @brief compressed storage of the records of a data file, an alternative to the CSV format that needs about a tenth of the flash.
+ *
+ * The records are split into blocks of SERIES_BLOCK_RECORDS records that are decoded independently. Inside a block the timestamps are stored as delta of
+ * delta, i.e. a record with the same distance to its predecessor as the previous one takes a single bit. The values are fixed point numbers in hundredth of
+ * a percent, stored as difference to the previous value of the channel or, if the difference is large, as plain value. A directory with the first timestamp
+ * and offset of every block at the end of the file allows to seek without decoding the blocks before.
+ *
+ * File layout: FileHeader, blocks (BlockHeader followed by the bit stream), directory entries, Trailer. The file starts with SERIES_MAGIC, so the data
+ * managers detect compressed data files by their content and not by their name.
+ */
+class QEMSCompressedSeries {
+
+  protected:
+    static const uint32_t SERIES_MAGIC = 0x31535451; // "QTS1"
+
+    struct FileHeader {
+        uint32_t magic;    // SERIES_MAGIC
+        uint32_t channels; // number of value columns
+    };
+
+    struct BlockHeader {
+        uint32_t time;  // timestamp of the first record
+        uint16_t count; // number of records
+        uint16_t bytes; // length of the bit stream
+    };
+
+    struct DirectoryEntry {
+        uint32_t time;   // timestamp of the first record of the block
+        uint32_t offset; // offset of the BlockHeader
+    };
+
+    struct Trailer {
+        uint32_t magic;   // SERIES_MAGIC
+        uint32_t blocks;  // number of directory entries
+        uint32_t records; // number of records in all blocks
+    };
+
+    /**
+     * @brief returns the maximum length of the bit stream of a block: a record needs at most 4 + 32 bits for the timestamp and 3 + 16 bits per value.
+     */
+    static size_t getMaxBlockBytes(uint8_t channels) { return (SERIES_BLOCK_RECORDS * (36 + 19 * channels) + 7) / 8; }
+
+  public:
+    /**
+     * @brief checks if the passed data file is a compressed series. The file position is not changed.
+     */
+    static bool isCompressed(File &file) {
+        uint32_t magic = 0;
+        size_t position = file.position();
+        bool compressed = file.seek(0) && file.read((uint8_t *)&magic, sizeof(magic)) == sizeof(magic) && magic == SERIES_MAGIC;
+        file.seek(position);
+        return compressed;
+    }
+};
+
+/**
+ * @brief writes a compressed series, see QEMSCompressedSeries.
+ */
+class QEMSSeriesWriter : public QEMSCompressedSeries {
+
+  public:
+    ~QEMSSeriesWriter() { free(_block); }
+
+    /**
+     * @brief starts writing a compressed series.
+     * @param path the file to write
+     * @param channels the number of values per record
+     */
+    bool begin(String path, uint8_t channels) {
+        free(_block);
+        _block = (uint8_t *)malloc(getMaxBlockBytes(channels));
+        if (!_block || channels == 0 || channels > MAX_CHANNELS || !_writer.open(path)) {
+            Serial.printf("Cannot create compressed series [%s]\n", path.c_str());
+            return false;
+        }
+
+        _channels = channels;
+        _count = 0;
+        _records = 0;
+        _offset = sizeof(FileHeader);
+        _directory.clear();
+
+        FileHeader header = {SERIES_MAGIC, channels};
+        _writer.write((const uint8_t *)&header, sizeof(header));
+        return true;
+    }
+
+    /**
+     * @brief appends the next record, the records have to be sorted by time.
+     * @param time the timestamp of the record
+     * @param values the values of the channels in hundredth of a percent
+     */
+    void add(time_t time, const uint16_t *values) {
+        if (_count == 0) {
+            memset(_block, 0, getMaxBlockBytes(_channels));
+            _bits = 0;
+            _first = time;
+            _delta = 0;
+            for (uint8_t c = 0; c < _channels; c++) {
+                put(values[c], 16);
+            }
+        } else {
+            putTime(time);
+            for (uint8_t c = 0; c < _channels; c++) {
+                putValue(_values[c], values[c]);
+            }
+        }
+
+        _time = time;
+        memcpy(_values, values, _channels * sizeof(uint16_t));
+        _records++;
+
+        if (++_count == SERIES_BLOCK_RECORDS) {
+            flushBlock();
+        }
+    }
+
+    /**
+     * @brief finishes the series with the directory of the blocks. The file is deleted if it is not valid.
+     * @param valid if all records were added successfully
+     */
+    bool end(bool valid) {
+        flushBlock();
+
+        for (DirectoryEntry &entry : _directory) {
+            _writer.write((const uint8_t *)&entry, sizeof(entry));
+        }
+        Trailer trailer = {SERIES_MAGIC, (uint32_t)_directory.size(), _records};
+        _writer.write((const uint8_t *)&trailer, sizeof(trailer));
+
+        _directory.clear();
+        _directory.shrink_to_fit();
+        free(_block);
+        _block = nullptr;
+
+        return _writer.close() && valid;
+    }
+
+    /**
+     * @brief replaces a CSV data file with its compressed series. The file is parsed strictly, all value columns found in the first record are kept.
+     * @param csvPath the data file
+     * @return false if the file is not a valid CSV data file, in this case it is not changed
+     */
+    bool convert(String csvPath) {
+        File csv = LittleFS.open(csvPath.c_str());
+        if (!csv || isCompressed(csv)) {
+            csv.close();
+            return false;
+        }
+
+        unsigned long start = millis();
+        size_t csvSize = csv.size();
+        String seriesPath = csvPath + SERIES_SUFFIX;
+        bool valid = true;
+        bool open = false;
+        time_t lastTime = 0;
+        uint8_t channels = 0;
+
+        while (valid && csv.available()) {
+            String r = csv.readStringUntil('\n');
+            r.trim();
+            if (r.length() == 0) {
+                continue;
+            }
+
+            if (!open) {
+                for (int i = r.indexOf(';'); i >= 0; i = r.indexOf(';', i + 1)) {
+                    channels++;
+                }
+                valid = open = begin(seriesPath, channels);
+            }
+
+            time_t time;
+            uint16_t values[MAX_CHANNELS];
+            valid = valid && r.length() >= 21 && r.charAt(19) == ';' && QEMSCsvParser::parseTime(r, time) && time >= lastTime;
+            for (uint8_t c = 0; valid && c < channels; c++) {
+                int value;
+                valid = QEMSCsvParser::parseValue(r, c + 1, QEMSFixedPoint<uint16_t>::SCALE, value);
+                values[c] = value;
+            }
+
+            if (valid) {
+                add(time, values);
+                lastTime = time;
+            } else {
+                Serial.printf("Cannot convert record [%s]\n", r.c_str());
+            }
+        }
+        csv.close();
+
+        valid = open && end(valid) && _records > 0;
+        size_t seriesSize = _writer.getWrittenBytes();
+        if (!valid || !LittleFS.rename(seriesPath.c_str(), csvPath.c_str())) {
+            LittleFS.remove(seriesPath.c_str());
+            return false;
+        }
+
+        Serial.printf("Compressed [%s] with %d records from %d to %d bytes in %lu ms\n", csvPath.c_str(), _records, csvSize, seriesSize, millis() - start);
+        return true;
+    }
+
+    /**
+     * @brief returns the size and CRC32 of the last written series.
+     */
+    size_t getWrittenBytes() { return _writer.getWrittenBytes(); }
+
+    uint32_t getCrc() { return _writer.getCrc(); }
+
+  private:
+    QEMSBlockWriter _writer;
+
+    uint8_t _channels = 0;
+
+    /**
+     * Offset of the next block in the file and the directory of the written blocks.
+     */
+    uint32_t _offset = 0;
+    std::vector<DirectoryEntry> _directory;
+
+    /**
+     * Bit stream of the current block, number of bits and records in it and the timestamp of its first record.
+     */
+    uint8_t *_block = nullptr;
+    uint32_t _bits = 0;
+    uint16_t _count = 0;
+    time_t _first = 0;
+
+    /**
+     * The previous record and the distance to its predecessor.
+     */
+    time_t _time = 0;
+    int32_t _delta = 0;
+    uint16_t _values[MAX_CHANNELS];
+
+    uint32_t _records = 0;
+
+    void put(uint32_t value, uint8_t bits) {
+        for (int8_t bit = bits - 1; bit >= 0; bit--, _bits++) {
+            if (value & (1UL << bit)) {
+                _block[_bits / 8] |= 0x80 >> (_bits % 8);
+            }
+        }
+    }
+
+    void putTime(time_t time) {
+        int32_t delta = time - _time;
+        int32_t dod = delta - _delta;
+        _delta = delta;
+
+        if (dod == 0) {
+            put(0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            put(0b10, 2);
+            put(dod + 63, 7);
+        } else if (dod >= -255 && dod <= 256) {
+            put(0b110, 3);
+            put(dod + 255, 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            put(0b1110, 4);
+            put(dod + 2047, 12);
+        } else {
+            put(0b1111, 4);
+            put(dod, 32);
+        }
+    }
+
+    void putValue(uint16_t previous, uint16_t value) {
+        int32_t delta = (int32_t)value - previous;
+        uint32_t zigzag = delta >= 0 ? delta * 2 : -delta * 2 - 1;
+
+        if (zigzag == 0) {
+            put(0, 1);
+        } else if (zigzag < 128) {
+            put(0b10, 2);
+            put(zigzag, 7);
+        } else if (zigzag < 1024) {
+            put(0b110, 3);
+            put(zigzag, 10);
+        } else {
+            put(0b111, 3);
+            put(value, 16);
+        }
+    }
+
+    void flushBlock() {
+        if (_count == 0) {
+            return;
+        }
+
+        BlockHeader header = {(uint32_t)_first, _count, (uint16_t)((_bits + 7) / 8)};
+        _writer.write((const uint8_t *)&header, sizeof(header));
+        _writer.write(_block, header.bytes);
+
+        _directory.push_back({(uint32_t)_first, _offset});
+        _offset += sizeof(header) + header.bytes;
+        _count = 0;
+    }
+};
+
+/**
+ * @brief reads a compressed series record by record, only the current block is kept in RAM. See QEMSCompressedSeries.
+ */
+class QEMSSeriesReader : public QEMSCompressedSeries {
+
+  public:
+    ~QEMSSeriesReader() { close(); }
+
+    /**
+     * @brief opens a compressed series and positions it at the first record.
+     * @return false if the file is not a complete compressed series
+     */
+    bool open(String path) {
+        close();
+
+        _file = LittleFS.open(path.c_str());
+        FileHeader header;
+        Trailer trailer;
+        bool valid = _file && _file.size() >= sizeof(FileHeader) + sizeof(Trailer) &&
+                     _file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == SERIES_MAGIC && header.channels > 0 &&
+                     header.channels <= MAX_CHANNELS && _file.seek(_file.size() - sizeof(Trailer)) &&
+                     _file.read((uint8_t *)&trailer, sizeof(trailer)) == sizeof(trailer) && trailer.magic == SERIES_MAGIC &&
+                     _file.size() >= sizeof(FileHeader) + trailer.blocks * sizeof(DirectoryEntry) + sizeof(Trailer);
+
+        _block = valid ? (uint8_t *)malloc(getMaxBlockBytes(header.channels)) : nullptr;
+        if (!_block) {
+            Serial.printf("Cannot open compressed series [%s]\n", path.c_str());
+            close();
+            return false;
+        }
+
+        _channels = header.channels;
+        _blocks = trailer.blocks;
+        _records = trailer.records;
+        _directory = _file.size() - sizeof(Trailer) - _blocks * sizeof(DirectoryEntry);
+        _valid = true;
+        return seekBlock(sizeof(FileHeader));
+    }
+
+    void close() {
+        _file.close();
+        free(_block);
+        _block = nullptr;
+        _remaining = 0;
+    }
+
+    uint8_t getChannelCount() { return _channels; }
+
+    uint32_t getRecordCount() { return _records; }
+
+    /**
+     * @brief positions the series at the beginning of the last block that starts before the passed time, so the following records include the first one
+     * with a timestamp of at least the passed time.
+     */
+    bool seek(time_t time) {
+        uint32_t block;
+        if (!findBlock(time, block)) {
+            return false;
+        }
+        return _blocks == 0 ? seekBlock(sizeof(FileHeader)) : seekBlockNumber(block);
+    }
+
+    uint32_t getBlockCount() { return _blocks; }
+
+    /**
+     * @brief finds the last block that starts before the passed time.
+     * @param block receives the number of the block, 0 if all blocks start later
+     * @return false if the directory cannot be read
+     */
+    bool findBlock(time_t time, uint32_t &block) {
+        uint32_t lo = 0;
+        uint32_t hi = _blocks;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            DirectoryEntry e;
+            if (!readDirectory(mid, e)) {
+                return _valid = false;
+            }
+            if ((time_t)e.time < time) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        block = lo > 0 ? lo - 1 : 0;
+        return true;
+    }
+
+    /**
+     * @brief positions the series at the beginning of a block.
+     * @return false if there is no such block
+     */
+    bool seekBlockNumber(uint32_t block) {
+        DirectoryEntry entry;
+        if (block >= _blocks || !readDirectory(block, entry)) {
+            return false;
+        }
+        return seekBlock(entry.offset);
+    }
+
+    /**
+     * @brief decodes the next record.
+     * @param time receives the timestamp
+     * @param values receives the values of all channels in hundredth of a percent
+     * @return false at the end of the series or if a block is corrupt, see isValid()
+     */
+    bool next(time_t &time, uint16_t *values) {
+        if (_remaining == 0 && !loadBlock()) {
+            return false;
+        }
+
+        if (_decoded == 0) {
+            for (uint8_t c = 0; c < _channels; c++) {
+                _values[c] = get(16);
+            }
+        } else {
+            _time += getDelta();
+            for (uint8_t c = 0; c < _channels; c++) {
+                _values[c] = getValue(_values[c]);
+            }
+        }
+
+        if (_bits > _length * 8) {
+            Serial.println("Corrupt block in compressed series");
+            _remaining = 0;
+            return _valid = false;
+        }
+
+        _decoded++;
+        _remaining--;
+        time = _time;
+        memcpy(values, _values, _channels * sizeof(uint16_t));
+        return true;
+    }
+
+    /**
+     * @brief returns true if the last record returned by next() was the last one of its block.
+     */
+    bool isBlockEnd() { return _remaining == 0; }
+
+    /**
+     * @brief returns false if a block could not be read or decoded.
+     */
+    bool isValid() { return _valid; }
+
+  private:
+    File _file;
+
+    uint8_t _channels = 0;
+    uint32_t _blocks = 0;
+    uint32_t _records = 0;
+
+    /**
+     * Offset of the directory and of the next block to load.
+     */
+    uint32_t _directory = 0;
+    uint32_t _offset = 0;
+
+    /**
+     * Bit stream of the current block, its length, the read position in bits and the number of decoded and remaining records.
+     */
+    uint8_t *_block = nullptr;
+    uint16_t _length = 0;
+    uint32_t _bits = 0;
+    uint16_t _decoded = 0;
+    uint16_t _remaining = 0;
+
+    /**
+     * The last decoded record and the distance to its predecessor.
+     */
+    time_t _time = 0;
+    int32_t _delta = 0;
+    uint16_t _values[MAX_CHANNELS];
+
+    bool _valid = false;
+
+    bool readDirectory(uint32_t block, DirectoryEntry &entry) {
+        return _file.seek(_directory + block * sizeof(DirectoryEntry)) && _file.read((uint8_t *)&entry, sizeof(entry)) == sizeof(entry);
+    }
+
+    bool seekBlock(uint32_t offset) {
+        _offset = offset;
+        _remaining = 0;
+        return _valid;
+    }
+
+    bool loadBlock() {
+        BlockHeader header;
+        if (!_valid || _offset >= _directory) {
+            return false;
+        }
+
+        if (!_file.seek(_offset) || _file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.count == 0 ||
+            header.count > SERIES_BLOCK_RECORDS || header.bytes > getMaxBlockBytes(_channels) || _file.read(_block, header.bytes) != header.bytes) {
+            Serial.println("Cannot read block of compressed series");
+            return _valid = false;
+        }
+
+        _offset += sizeof(header) + header.bytes;
+        _length = header.bytes;
+        _bits = 0;
+        _decoded = 0;
+        _remaining = header.count;
+        _time = header.time;
+        _delta = 0;
+        return true;
+    }
+
+    uint32_t get(uint8_t bits) {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < bits; i++, _bits++) {
+            bool set = _bits < _length * 8 && (_block[_bits / 8] & (0x80 >> (_bits % 8)));
+            value = (value << 1) | set;
+        }
+        return value;
+    }
+
+    /**
+     * @brief returns the number of set bits before the first cleared one, at most max.
+     */
+    uint8_t getPrefix(uint8_t max) {
+        uint8_t ones = 0;
+        while (ones < max && get(1)) {
+            ones++;
+        }
+        return ones;
+    }
+
+    int32_t getDelta() {
+        switch (getPrefix(4)) {
+        case 0:
+            break;
+        case 1:
+            _delta += (int32_t)get(7) - 63;
+            break;
+        case 2:
+            _delta += (int32_t)get(9) - 255;
+            break;
+        case 3:
+            _delta += (int32_t)get(12) - 2047;
+            break;
+        default:
+            _delta += (int32_t)get(32);
+            break;
+        }
+        return _delta;
+    }
+
+    uint16_t getValue(uint16_t previous) {
+        uint32_t zigzag;
+        switch (getPrefix(3)) {
+        case 0:
+            return previous;
+        case 1:
+            zigzag = get(7);
+            break;
+        case 2:
+            zigzag = get(10);
+            break;
+        default:
+            return get(16);
+        }
+        return previous + (zigzag & 1 ? -(int32_t)(zigzag + 1) / 2 : (int32_t)zigzag / 2);
+    }
+};
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef QEMS_CSV_INDEX_H_
+#define QEMS_CSV_INDEX_H_
+
+#include <LittleFS.h>
+#include <QEMSBlockWriter.h>
+#include <QEMSCsvParser.h>
+
+/**
+ * Every CSV_INDEX_STRIDE-th record of a data file is added to its index.
+ */
+#define CSV_INDEX_STRIDE 64
+
+/**
+ * File extension of the index files, the index of "/co2.csv" is stored in "/co2.csv.idx".
+ */
+#define CSV_INDEX_SUFFIX ".idx"
+
+/**
+ * @brief sparse index for the CSV data files. The index maps the timestamp of every CSV_INDEX_STRIDE-th record to its byte offset in the file, so loading
+ * data for a given time can seek close to the first relevant record instead of parsing the file from the beginning. The index is a binary file with a header
+ * and sorted entries, it is searched directly in the file system and never loaded completely.
+ */
+class QEMSCsvIndex {
+
+    /**
+     * Header of the index file, used to detect an index that does not belong to the data file.
+     */
+    struct Header {
+        uint32_t magic;   // INDEX_MAGIC
+        uint32_t csvSize; // size of the indexed data file
+    };
+
+    /**
+     * Single index entry.
+     */
+    struct Entry {
+        uint32_t time;   // epoch timestamp of the record
+        uint32_t offset; // byte offset of the line of the record
+    };
+
+    static const uint32_t INDEX_MAGIC = 0x58444951; // "QIDX"
+
+  public:
+    /**
+     * @brief returns the index file for the passed data file.
+     */
+    static String getIndexPath(String csvPath) { return csvPath + CSV_INDEX_SUFFIX; }
+
+    /**
+     * @brief starts writing a new index.
+     * @param csvPath the data file to index
+     * @param csvSize the size of the data file
+     */
+    bool begin(String csvPath, size_t csvSize) {
+        _records = 0;
+        _lastTime = 0;
+        _sorted = true;
+        _path = getIndexPath(csvPath);
+
+        if (!_writer.open(_path)) {
+            return false;
+        }
+
+        Header header = {INDEX_MAGIC, (uint32_t)csvSize};
+        _writer.write((const uint8_t *)&header, sizeof(header));
+        return true;
+    }
+
+    /**
+     * @brief passes the next record of the data file to the index.
+     * @param time the timestamp of the record
+     * @param offset the byte offset of the line of the record
+     */
+    void add(time_t time, uint32_t offset) {
+        _sorted = _sorted && time >= _lastTime;
+        _lastTime = time;
+
+        if (_records++ % CSV_INDEX_STRIDE == 0) {
+            Entry entry = {(uint32_t)time, offset};
+            _writer.write((const uint8_t *)&entry, sizeof(entry));
+        }
+    }
+
+    /**
+     * @brief finishes the index. The index is deleted if the file is invalid or not sorted by time, because it cannot be searched in this case.
+     * @param valid if the complete data file was indexed successfully
+     */
+    bool end(bool valid) {
+        if (!_writer.close() || !valid || !_sorted) {
+            LittleFS.remove(_path.c_str());
+            return false;
+        }
+
+        Serial.printf("Created index [%s] for %d records\n", _path.c_str(), _records);
+        return true;
+    }
+
+    /**
+     * @brief determines the position to start parsing a data file to find the first record with a timestamp of at least the passed time. The data file is
+     * positioned at the start of the line of the last indexed record before the passed time.
+     * @param csv the data file to position
+     * @param csvPath the path of the data file
+     * @param time the timestamp to search for
+     * @return false if there is no valid index for the data file, in this case the file is positioned at the beginning
+     */
+    static bool seek(File &csv, String csvPath, time_t time) {
+        File index;
+        bool valid = open(index, csvPath, csv.size());
+        if (!index) {
+            return false;
+        }
+
+        // last entry with a timestamp before the searched one
+        Entry entry = {0, 0};
+        uint32_t position;
+        valid = valid && find(index, time, position) && (position == 0 || readEntry(index, position - 1, entry));
+
+        index.close();
+
+        // the line at the offset has to match the indexed record, otherwise the index is outdated
+        if (valid && entry.offset > 0) {
+            csv.seek(entry.offset);
+            String line = csv.readStringUntil('\n');
+            line.trim();
+            time_t lineTime;
+            valid = QEMSCsvParser::parseTime(line, lineTime) && lineTime == (time_t)entry.time;
+        }
+
+        csv.seek(valid ? entry.offset : 0);
+
+        if (!valid) {
+            Serial.printf("Index for [%s] is outdated\n", csvPath.c_str());
+        }
+        return valid;
+    }
+
+    /**
+     * @brief opens the index of a data file to read its entries.
+     * @param index receives the index file
+     * @param csvPath the path of the data file
+     * @param csvSize the size of the data file
+     * @return false if there is no index for the current content of the data file
+     */
+    static bool open(File &index, String csvPath, size_t csvSize) {
+        index = LittleFS.open(getIndexPath(csvPath).c_str());
+        Header header;
+        return index && index.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == INDEX_MAGIC && header.csvSize == csvSize;
+    }
+
+    /**
+     * @brief returns the number of entries of an opened index.
+     */
+    static uint32_t getEntryCount(File &index) { return (index.size() - sizeof(Header)) / sizeof(Entry); }
+
+    /**
+     * @brief reads an entry of an opened index.
+     * @param index the index file
+     * @param position the number of the entry
+     * @param time receives the timestamp of the indexed record
+     * @param offset receives the byte offset of the line of the record
+     */
+    static bool getEntry(File &index, uint32_t position, time_t &time, uint32_t &offset) {
+        Entry entry;
+        if (!readEntry(index, position, entry)) {
+            return false;
+        }
+        time = entry.time;
+        offset = entry.offset;
+        return true;
+    }
+
+    /**
+     * @brief finds the first entry of an opened index with a timestamp of at least the passed time.
+     * @param position receives the number of the entry, the number of entries if all are older
+     * @return false if the index cannot be read
+     */
+    static bool find(File &index, time_t time, uint32_t &position) {
+        uint32_t lo = 0;
+        uint32_t hi = getEntryCount(index);
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            Entry e;
+            if (!readEntry(index, mid, e)) {
+                return false;
+            }
+            if ((time_t)e.time < time) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        position = lo;
+        return true;
+    }
+
+  private:
+    static bool readEntry(File &index, uint32_t position, Entry &entry) {
+        return index.seek(sizeof(Header) + position * sizeof(Entry)) && index.read((uint8_t *)&entry, sizeof(entry)) == sizeof(entry);
+    }
+
+    /**
+     * Writer for the index file.
+     */
+    QEMSBlockWriter _writer;
+
+    String _path;
+
+    /**
+     * Number of records passed to the index.
+     */
+    uint32_t _records = 0;
+
+    /**
+     * Timestamp of the last record, used to check that the records are sorted.
+     */
+    time_t _lastTime = 0;
+
+    bool _sorted = true;
+};
+
+#endif
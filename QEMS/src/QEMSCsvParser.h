@@ -0,0 +1,61 @@
+#ifndef QEMS_CSV_PARSER_H_
+#define QEMS_CSV_PARSER_H_
+
+#include <Arduino.h>
+#include <time.h>
+
+/**
+ * @brief fixed point representation of the values in the data files, which are fractions from 0 .. 1. The scale defines the stored value for 1.
+ */
+template <typename Value> struct QEMSFixedPoint;
+
+template <> struct QEMSFixedPoint<uint8_t> {
+    static const int SCALE = 100; // percent
+};
+
+template <> struct QEMSFixedPoint<uint16_t> {
+    static const int SCALE = 10000; // hundredth of a percent
+};
+
+/**
+ * @brief parsing of the records in the CSV data files, which have the format "dd.mm.yyyy HH:MM:SS;value[;value...]" with values from 0 .. 1.
+ */
+class QEMSCsvParser {
+
+  public:
+    /**
+     * @brief parses the timestamp at the beginning of a record.
+     * @return false if the line does not start with a timestamp in format "dd.mm.yyyy HH:MM:SS"
+     */
+    static bool parseTime(String &line, time_t &time) {
+        struct tm ts = {0};
+        bool valid = strptime(line.substring(0, 19).c_str(), "%d.%m.%Y %H:%M:%S", &ts) != NULL;
+        time = mktime(&ts); // convert the timestamp from the String into an epoch timestamp for easier handling
+        return valid;
+    }
+
+    /**
+     * @brief parses a value of a record into a fixed point number.
+     * @param line the record
+     * @param column the value column, starting with 1
+     * @param scale the fixed point value for 1, the value is limited to 0 .. scale
+     * @param value the parsed value
+     * @return false if the value is missing or not a number
+     */
+    static bool parseValue(String &line, uint8_t column, int scale, int &value) {
+        // find the value column
+        int start = -1;
+        for (uint8_t i = 0; i < column && (i == 0 || start >= 0); i++) {
+            start = line.indexOf(';', start + 1);
+        }
+
+        int end = start < 0 ? -1 : line.indexOf(';', start + 1);
+        String data = start < 0 ? String("") : line.substring(start + 1, end < 0 ? line.length() : end);
+        data.replace(',', '.');
+
+        value = constrain((int)(data.toFloat() * scale), 0, scale); // convert the String value into a fixed point value
+        return data.length() > 0 && isDigit(data.charAt(0));
+    }
+};
+
+#endif
@@ -2,123 +2,368 @@
 #define QEMS_DATA_MANAGER_H_
 
 #include <LittleFS.h>
+#include <QEMSAggregates.h>
+#include <QEMSBlockWriter.h>
+#include <QEMSCompressedSeries.h>
+#include <QEMSCsvIndex.h>
+#include <QEMSCsvParser.h>
+#include <QEMSDataSource.h>
+#include <QEMSParallelParser.h>
+#include <QEMSRecordCache.h>
+#include <QEMSRetention.h>
+#include <QEMSRunningTotals.h>
+#include <QEMSTimeAxis.h>
 #include <QEMSTimeManager.h>
+#include <esp_rom_crc.h>
 #include <time.h>
 
-#define RECORD_CNT 120
-
 /**
- * @brief utility class to load data records from uploaded csv files to provide the data to the display.
+ * @brief utility class to load data records from uploaded csv files to provide the data to the display. The data manager holds multiple channels (e.g. CO2
+ * and cost savings) on a shared time axis, so the timestamps are stored and looked up only once for all channels. A channel is read either from a single
+ * channel file with lines in format "dd.mm.yyyy HH:MM:SS;value" or from one column of a multi column file "dd.mm.yyyy HH:MM:SS;value1;value2;...".
+ *
+ * The records are stored packed: values as fixed point numbers of type Value (uint8_t for a resolution of 1%, uint16_t for 0.01%), timestamps as 16 bit
+ * offsets to the base timestamp of their block. If the sampling interval of the data is known at compile time, no timestamps are stored at all and the
+ * record for a time is calculated.
+ *
+ * @tparam Value the fixed point type of the values
+ * @tparam Capacity the number of records kept in RAM, by default one day of data with the 15 s interval of the data files
+ * @tparam Interval the fixed distance between two records in seconds or 0 for arbitrary timestamps
  */
-class QEMSDataManager {
+template <typename Value = uint8_t, uint16_t Capacity = 5760, uint16_t Interval = 0> class QEMSDataManager : public QEMSDataSource {
+
+    /**
+     * Data source of a channel.
+     */
+    struct Channel {
+        String file;    // the file to load the data from
+        uint8_t column; // the value column in the file, starting with 1
+    };
+
+    /**
+     * The loaded records in columnar layout, i.e. one shared time axis and one value column per channel.
+     */
+    struct Window {
+        QEMSTimeAxis<Capacity, Interval> time; // timestamps of the records
+        Value *values;                         // fixed point values, Capacity entries per channel
+        time_t loaded;                         // the time the records were loaded for
+    };
 
     /**
-     * Data record from the file.
+     * Header of the checkpoint file, followed by the time axis and the values of the window.
      */
-    struct Record {
-        time_t time; // epoch timestamp
-        int value;   // value from 0 .. 100
+    struct Checkpoint {
+        uint32_t magic;  // CHECKPOINT_MAGIC
+        uint32_t source; // checksum of the channels and their data files
+        uint32_t size;   // size of the window data, changes with the template parameters
+        uint32_t loaded; // the time the records were loaded for, they do not cover earlier times
     };
 
+    static const uint32_t CHECKPOINT_MAGIC = 0x4b484351; // "QCHK"
+
   public:
-    QEMSDataManager(QEMSTimeManager *timeManager, String dataFile) : _timeManager(timeManager), _dataFile(dataFile) {
+    QEMSDataManager(QEMSTimeManager *timeManager) : _timeManager(timeManager) {}
 
-        File f = LittleFS.open(_dataFile);
-        if (f) {
-            _fileAvailable = true;
-            f.close();
-        } else {
+    uint8_t addChannel(String dataFile, uint8_t column = 1) override {
+        if (_channelCount >= MAX_CHANNELS || _windows[0].values) {
+            Serial.printf("Cannot add channel [%s]\n", dataFile.c_str());
+            return _channelCount - 1;
+        }
+
+        _channels[_channelCount] = {dataFile, column};
 
+        bool available = true;
+        for (uint8_t c = 0; c <= _channelCount; c++) {
+            File f = LittleFS.open(_channels[c].file);
+            if (f) {
+                f.close();
+            } else {
+                available = false;
+            }
         }
+        _fileAvailable = available;
+
+        return _channelCount++;
     }
 
-    int getActiveValue() {
+    uint8_t getChannelCount() override { return _channelCount; }
+
+    String getFileName(uint8_t channel) override { return _channels[channel].file; }
 
+    bool usesFile(String file) override {
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            if (_channels[c].file == file) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool getActiveValues(int *values, time_t *validUntil = nullptr) override {
+
+        clearChange();
         time_t now = _timeManager->now();
+        uint32_t generation = getGeneration(); // read before the window, it is incremented after the window was swapped
+        Window *window = _active;              // the window may be swapped by an update from another task
+
+        // first record in the future, the record at index 0 is never used
+        uint16_t index = max(window->time.findNext(now), (uint16_t)1);
 
-        for (uint8_t i = 0; i < RECORD_CNT; i++) {
-            if (_dataPoints[i].time > now && i > 0) {
-                return _dataPoints[i].value;
+        if (index < window->time.size()) {
+            for (uint8_t c = 0; c < _channelCount; c++) {
+                values[c] = window->values[c * Capacity + index] * 100 / QEMSFixedPoint<Value>::SCALE;
             }
+
+            advanceTotals(window, generation, now, window->time.findNext(now));
+
+            // the values change when the active record is reached
+            setValidity(_timeManager->toRealMillis(window->time.get(index) - now));
+            if (validUntil) {
+                *validUntil = window->time.get(index);
+            }
+            return true;
         }
 
-        Serial.printf("No data available for [%s]\n", _dataFile);
+        Serial.println("No data available");
         _ready = false;
+        setValidity(0);
+        if (validUntil) {
+            *validUntil = 0;
+        }
 
-        return 0;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            values[c] = 0;
+        }
+        return false;
     }
 
-    bool isFileAvailable() { return _fileAvailable; }
+    bool sampleValues(int64_t timeMs, float *values) override {
+        Window *window = _active; // the window may be swapped by an update from another task
 
-    /**
-     * @brief loads data records from the uploaded CSV file.
-     */
-    void loadDataFromFile() {
+        // the time is between the previous and the next record
+        uint16_t index = window->time.findNext(timeMs / 1000);
+
+        if (index > 0 && index < window->time.size()) {
+            int64_t from = (int64_t)window->time.get(index - 1) * 1000;
+            float fraction = (float)(timeMs - from) / ((int64_t)window->time.get(index) * 1000 - from);
+
+            for (uint8_t c = 0; c < _channelCount; c++) {
+                int previous = window->values[c * Capacity + index - 1];
+                int next = window->values[c * Capacity + index];
+                values[c] = (previous + (next - previous) * fraction) * 100 / QEMSFixedPoint<Value>::SCALE;
+            }
+            return true;
+        }
+
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            values[c] = 0;
+        }
+        return false;
+    }
+
+    time_t getNextChange(time_t time) override {
+        Window *window = _active;
+        uint16_t index = max(window->time.findNext(time), (uint16_t)1);
+        return index < window->time.size() ? window->time.get(index) : 0;
+    }
+
+    uint16_t getRecords(uint8_t channel, time_t from, time_t to, time_t *times, float *values, uint16_t maxCount) override {
+        Window *window = _active; // the window may be swapped by an update from another task
+        uint16_t size = window->time.size();
+        time_t first = size > 0 ? window->time.get(0) : to;
+
+        // records before and after the loaded ones are read from the data file through the record cache
+        uint16_t count = from < first ? _cache.read(_channels[channel].file, _channels[channel].column, from, min(to, first), times, values, maxCount) : 0;
+
+        for (uint16_t index = window->time.findNext(from - 1); index < window->time.size() && count < maxCount; index++) {
+            time_t time = window->time.get(index);
+            if (time >= to) {
+                break;
+            }
+
+            times[count] = time;
+            values[count++] = window->values[channel * Capacity + index] * 100.0f / QEMSFixedPoint<Value>::SCALE;
+        }
+
+        time_t last = size > 0 ? window->time.get(size - 1) : to;
+        if (last + 1 < to && count < maxCount) {
+            count += _cache.read(_channels[channel].file, _channels[channel].column, max(from, last + 1), to, times + count, values + count, maxCount - count);
+        }
+        return count;
+    }
+
+    bool getCacheStatistics(QEMSCacheStatistics &statistics) override {
+        statistics = _cache.getStatistics();
+        return true;
+    }
+
+    bool getRunningTotals(uint8_t channel, QEMSAggregate &today, QEMSAggregate &week) override {
+        return channel < _channelCount && _totals.get(channel, _timeManager->now(), today, week);
+    }
+
+    bool restartTotals() override {
+        time_t now = _timeManager->now();
+        uint32_t jumps = _timeManager->getJumps();
+        uint32_t generation = getGeneration(); // read before the window, it is incremented after the window was swapped
+        Window *window = _active;
+
+        xSemaphoreTake(_totalsMutex, portMAX_DELAY);
+        bool current = _totalsStarted && generation == _totalsGeneration && jumps == _totalsJumps && now >= _totals.getTime();
+        _totalsStarted = current;
+        xSemaphoreGive(_totalsMutex);
+        if (current || !_ready) {
+            return false;
+        }
+
+        // the aggregates are read without the mutex, getActiveValues() skips the totals meanwhile
+        time_t until = _totals.restart(this, now);
+        addPassedRecords(until, window->time.size() > 0 ? window->time.get(0) : until);
+
+        xSemaphoreTake(_totalsMutex, portMAX_DELAY);
+        _totalsCursor = window->time.findNext(until - 1);
+        _totalsGeneration = generation;
+        _totalsJumps = jumps;
+        _totalsStarted = true;
+        xSemaphoreGive(_totalsMutex);
+        return true;
+    }
+
+    bool getAggregate(uint8_t channel, time_t from, time_t to, QEMSAggregate &result) override {
+        return QEMSAggregates::query(_channels[channel].file, getFilePosition(channel), from, to, result);
+    }
+
+    bool isFileAvailable() override { return _fileAvailable; }
+
+    void loadDataFromFile() override {
 
         // If we already load data, we do not need to do anything here.
-        if (_loadInProgress) {
+        if (xSemaphoreTake(_loadMutex, 0) != pdTRUE) {
             return;
         }
 
         _ready = false;
-        _loadInProgress = true;
 
-        // open the file with the data to create records from.
-        File dataFile = LittleFS.open(_dataFile);
-        // take the current time.
-        time_t now = _timeManager->now();
+        // after a reboot the records of the last load are restored without parsing the data files
+        bool loaded = restoreCheckpoint(getStagingWindow());
+        if (!loaded) {
+            loaded = loadWindow(getStagingWindow(), false, "", "");
+            if (loaded) {
+                saveCheckpoint(getStagingWindow());
+            }
+        }
+        _active = getStagingWindow();
 
-        if (!dataFile) {
-            Serial.println("Could not open data file, skip processing...");
-            _fileAvailable = false;
-            _loadInProgress = false;
-            return;
-        } else {
-            Serial.printf("Opened data file [%s], process data...\n", _dataFile);
-            _fileAvailable = true;
+        // check if we have enough data loaded
+        _fileAvailable = loaded;
+        _ready = loaded;
+        notifyChange();
+
+        xSemaphoreGive(_loadMutex);
+    }
+
+    bool prepareUpdate(String file, String replacement) override {
+
+        // wait for a running load, it would use the staging window as well. The mutex is held until the update is committed or discarded.
+        xSemaphoreTake(_loadMutex, portMAX_DELAY);
+
+        if (!loadWindow(getStagingWindow(), true, file, replacement)) {
+            Serial.printf("Rejected data file [%s]\n", replacement.c_str());
+            xSemaphoreGive(_loadMutex);
+            return false;
         }
 
-        // we store exactly x records which are not in the past.
+        return true;
+    }
+
+    void commitUpdate() override {
+        // the data files were replaced or rewritten
+        _cache.clear();
+        saveCheckpoint(getStagingWindow());
+        _active = getStagingWindow();
+        _fileAvailable = true;
+        _ready = true;
+        notifyChange();
+        xSemaphoreGive(_loadMutex);
+    }
 
-        String r;
-        uint8_t recordPointer = 0; // pointer to the record that is currently stored
-        while (dataFile.available()) {
+    void discardUpdate() override { xSemaphoreGive(_loadMutex); }
 
-            r = dataFile.readStringUntil('\n'); // read the next line
+    bool appendRecords(uint8_t channel, String &records) override {
+        String file = _channels[channel].file;
 
-            String data = r.substring(20, 25);
-            data.replace(',', '.');
-            int value = (int)(data.toFloat() * 100); // convert the String value into an integer value
+        // the active records are extended in the staging window, so no load must run in parallel
+        xSemaphoreTake(_loadMutex, portMAX_DELAY);
 
-            struct tm ts = {0};
-            strptime(r.substring(0, 19).c_str(), "%d.%m.%Y %H:%M:%S", &ts);
-            time_t epoch_ts = mktime(&ts); // convert the timestamp from the String into an epoch timestamp for easier handling
+        unsigned long start = micros();
+        uint16_t count = 0;
+        if (!writeSegment(file, records, count)) {
+            xSemaphoreGive(_loadMutex);
+            return false;
+        }
 
-            // record is in the future, store it ffu
-            if (epoch_ts > now && recordPointer < RECORD_CNT) {
-                _dataPoints[recordPointer] = {epoch_ts, value};
-                recordPointer++;
-            }
-            
+        // without active records the segment is read with the next load
+        uint16_t added = _ready ? extendWindow(getStagingWindow()) : 0;
+        if (added > 0) {
+            _active = getStagingWindow();
+            saveCheckpoint(_active);
+            notifyChange();
         }
 
-        dataFile.close();
-        Serial.printf("Updated data records for [%s], loaded records = %d\n", _dataFile, recordPointer);
+        Serial.printf("Appended %d records to [%s], %d records added to the active records in %lu us\n", count, file.c_str(), added, micros() - start);
+        xSemaphoreGive(_loadMutex);
+        return true;
+    }
 
-        if (recordPointer >= RECORD_CNT) { // check if we have enough dat aloaded
-            _fileAvailable = true;
-            _ready = true;
-        } else {
-            _fileAvailable = false;
-            _ready = false;
+    bool dropHistory(time_t before) override {
+        xSemaphoreTake(_loadMutex, portMAX_DELAY);
+
+        bool dropped = false;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            size_t size;
+            uint32_t crc;
+            if (QEMSRetention::dropRecords(_channels[c].file, before, size, crc)) {
+                notifyFileWritten(_channels[c].file, size, crc);
+                dropped = true;
+            }
         }
 
-        _loadInProgress = false;
+        // the index and aggregates of the shortened data files are recreated even if the clock passed most of the loaded records
+        bool reloaded = !dropped || reloadChangedFiles();
+        xSemaphoreGive(_loadMutex);
+        return reloaded;
     }
 
-    bool isReady() { return _ready && _fileAvailable; }
+    bool compactSegment(uint8_t channel) override {
+        String file = _channels[channel].file;
+        String path = file + SEGMENT_SUFFIX;
+        String temp = file + String(".tmp");
+
+        xSemaphoreTake(_loadMutex, portMAX_DELAY);
+
+        // the records are merged into a copy of the data file that replaces it, so the data file stays complete if the merge fails. A power loss before the
+        // segment is removed leaves records in both files, they are skipped when the segment is read.
+        unsigned long start = millis();
+        File segment = LittleFS.open(path.c_str());
+        size_t size = segment ? segment.size() : 0;
+        segment.close();
+        size_t written;
+        uint32_t crc;
+        if (!mergeSegment(file, path, temp, written, crc) || !LittleFS.rename(temp.c_str(), file.c_str())) {
+            LittleFS.remove(temp.c_str());
+            xSemaphoreGive(_loadMutex);
+            Serial.printf("Cannot merge segment [%s]\n", path.c_str());
+            return false;
+        }
+        bool removed = LittleFS.remove(path.c_str());
+        notifyFileWritten(file, written, crc);
+        Serial.printf("Merged segment [%s] with %d bytes into the data file in %lu ms\n", path.c_str(), size, millis() - start);
+
+        bool reloaded = reloadChangedFiles();
+        xSemaphoreGive(_loadMutex);
+        return reloaded && removed;
+    }
 
-    String getFileName() { return _dataFile; }
+    bool isReady() override { return _ready && _fileAvailable; }
 
   private:
     /**
@@ -127,19 +372,22 @@ class QEMSDataManager {
     bool _ready = false;
 
     /**
-     * Flag that indicates that the data is currently loaded, needed to avoid multiple imports at once when the method is called from different CPU cores
+     * Held while the data is loaded or an update is prepared until it is committed or discarded, needed to avoid multiple imports at once when the methods are
+     * called from different CPU cores
      */
-    bool _loadInProgress = false;
+    SemaphoreHandle_t _loadMutex = xSemaphoreCreateMutex();
 
     /**
-     * If the file was found in the file system.
+     * If the files of all channels were found in the file system.
      */
     bool _fileAvailable = false;
 
     /**
-     * The file to load the data from
+     * The channels to load.
      */
-    String _dataFile;
+    Channel _channels[MAX_CHANNELS];
+
+    uint8_t _channelCount = 0;
 
     /**
      * @brief provides access to the current time
@@ -147,9 +395,808 @@ class QEMSDataManager {
     QEMSTimeManager *_timeManager;
 
     /**
-     * @brief contains the first 100 data points in the future starting from the last parsing action.
+     * @brief pages of the data files for queries of records that are not loaded.
+     */
+    QEMSRecordCache _cache;
+
+    /**
+     * @brief aggregates of today and the current week, restarted by restartTotals() and advanced by getActiveValues(). The cursor is the first record of the
+     * window that was not added yet, it is only valid for the window of the generation and clock jumps it was set for. The mutex protects the cursor and
+     * its state, it is not held while the aggregates are read.
+     */
+    QEMSRunningTotals _totals;
+    uint16_t _totalsCursor = 0;
+    uint32_t _totalsGeneration = 0;
+    uint32_t _totalsJumps = 0;
+    bool _totalsStarted = false;
+    SemaphoreHandle_t _totalsMutex = xSemaphoreCreateMutex();
+
+    /**
+     * @brief two record windows, one is active and used to provide the values while the other one is filled when data is (re)loaded. The record buffers are
+     * allocated on the first load, when the number of channels is known.
+     */
+    Window _windows[2] = {};
+
+    /**
+     * @brief contains the first Capacity data points in the future starting from the last parsing action.
+     */
+    Window *volatile _active = &_windows[0];
+
+    /**
+     * @brief returns the window that is currently not used to provide values.
+     */
+    Window *getStagingWindow() { return _active == &_windows[0] ? &_windows[1] : &_windows[0]; }
+
+    /**
+     * @brief allocates the record buffers of both windows.
+     */
+    bool allocateWindows() {
+        if (_windows[0].values) {
+            return true;
+        }
+
+        for (Window &window : _windows) {
+            window.values = (Value *)malloc(Capacity * _channelCount * sizeof(Value));
+
+            if (!window.values) {
+                Serial.println("Cannot allocate data records");
+                for (Window &w : _windows) {
+                    free(w.values);
+                    w.values = nullptr;
+                }
+                return false;
+            }
+        }
+
+        Serial.printf("Allocated %d bytes for data records\n", sizeof(_windows) + 2 * Capacity * _channelCount * sizeof(Value));
+        return true;
+    }
+
+    /**
+     * @brief returns the size of the window data stored in a checkpoint.
+     */
+    size_t getCheckpointSize() { return sizeof(Window::time) + Capacity * _channelCount * sizeof(Value); }
+
+    /**
+     * @brief calculates the checksum over the channels and the size and modification time of their data files, used to detect an outdated checkpoint.
+     */
+    uint32_t getSourceChecksum() {
+        uint32_t crc = 0;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            File f = LittleFS.open(_channels[c].file);
+            File segment = LittleFS.open((_channels[c].file + SEGMENT_SUFFIX).c_str());
+            uint32_t stamp[4] = {_channels[c].column, f ? (uint32_t)f.size() : 0, f ? (uint32_t)f.getLastWrite() : 0, segment ? (uint32_t)segment.size() : 0};
+            crc = esp_rom_crc32_le(crc, (const uint8_t *)_channels[c].file.c_str(), _channels[c].file.length());
+            crc = esp_rom_crc32_le(crc, (const uint8_t *)stamp, sizeof(stamp));
+            f.close();
+            segment.close();
+        }
+        return crc;
+    }
+
+    /**
+     * @brief adds the records the clock passed since the last call to the running totals, so every record is added once. If the window or the clock changed
+     * in between, no records are added until the data task restarted the totals, see restartTotals().
+     * @param window the active window
+     * @param generation the generation of the window
+     * @param now the current time
+     * @param index the first record in the future
+     */
+    void advanceTotals(Window *window, uint32_t generation, time_t now, uint16_t index) {
+        xSemaphoreTake(_totalsMutex, portMAX_DELAY);
+        if (_totalsStarted && generation == _totalsGeneration && _timeManager->getJumps() == _totalsJumps && now >= _totals.getTime()) {
+            float values[MAX_CHANNELS];
+            for (; _totalsCursor < index; _totalsCursor++) {
+                for (uint8_t c = 0; c < _channelCount; c++) {
+                    values[c] = window->values[c * Capacity + _totalsCursor] * 100.0f / QEMSFixedPoint<Value>::SCALE;
+                }
+                _totals.add(window->time.get(_totalsCursor), values);
+            }
+        }
+        xSemaphoreGive(_totalsMutex);
+    }
+
+    /**
+     * @brief adds the records the clock passed before the first record of the window to the running totals, read from the data files. These are the records
+     * of the current minute the aggregates do not cover.
+     * @param from the start of the range (inclusive)
+     * @param to the end of the range (exclusive)
+     */
+    void addPassedRecords(time_t from, time_t to) {
+        static const uint16_t MAX_PASSED = 64;
+        time_t times[MAX_CHANNELS][MAX_PASSED];
+        float values[MAX_CHANNELS][MAX_PASSED];
+        uint16_t counts[MAX_CHANNELS];
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            counts[c] = from < to ? getRecords(c, from, to, times[c], values[c], MAX_PASSED) : 0;
+        }
+
+        // only the records all channels have values for, like the window
+        uint16_t next[MAX_CHANNELS] = {0};
+        for (uint16_t i = 0; _channelCount > 0 && i < counts[0]; i++) {
+            float record[MAX_CHANNELS];
+            bool complete = true;
+            for (uint8_t c = 0; c < _channelCount && complete; c++) {
+                while (next[c] < counts[c] && times[c][next[c]] < times[0][i]) {
+                    next[c]++;
+                }
+                complete = next[c] < counts[c] && times[c][next[c]] == times[0][i];
+                record[c] = complete ? values[c][next[c]] : 0;
+            }
+            if (complete) {
+                _totals.add(times[0][i], record);
+            }
+        }
+    }
+
+    /**
+     * @brief stores the records of a window in the checkpoint file, so they are available right after a reboot.
+     */
+    void saveCheckpoint(Window *window) {
+        unsigned long start = millis();
+        String path = _channels[0].file + CHECKPOINT_SUFFIX;
+        Checkpoint checkpoint = {CHECKPOINT_MAGIC, getSourceChecksum(), (uint32_t)getCheckpointSize(), (uint32_t)window->loaded};
+
+        QEMSBlockWriter writer;
+        if (!writer.open(path)) {
+            return;
+        }
+        writer.write((const uint8_t *)&checkpoint, sizeof(checkpoint));
+        writer.write((const uint8_t *)&window->time, sizeof(window->time));
+        writer.write((const uint8_t *)window->values, Capacity * _channelCount * sizeof(Value));
+
+        if (!writer.close() || writer.getWrittenBytes() != sizeof(checkpoint) + checkpoint.size) {
+            LittleFS.remove(path.c_str());
+            return;
+        }
+        Serial.printf("Saved checkpoint [%s] with %d records in %lu ms\n", path.c_str(), window->time.size(), millis() - start);
+    }
+
+    /**
+     * @brief restores the records of the checkpoint file into a window.
+     * @return false if there is no checkpoint for the current data files or it does not provide MIN_RECORD_CNT records in the future
+     */
+    bool restoreCheckpoint(Window *window) {
+        unsigned long start = millis();
+        String path = _channels[0].file + CHECKPOINT_SUFFIX;
+        File file = LittleFS.open(path.c_str());
+        if (!file || !allocateWindows()) {
+            return false;
+        }
+
+        Checkpoint checkpoint;
+        bool valid = file.read((uint8_t *)&checkpoint, sizeof(checkpoint)) == sizeof(checkpoint) && checkpoint.magic == CHECKPOINT_MAGIC &&
+                     checkpoint.size == getCheckpointSize() && checkpoint.source == getSourceChecksum() &&
+                     file.read((uint8_t *)&window->time, sizeof(window->time)) == sizeof(window->time) &&
+                     file.read((uint8_t *)window->values, Capacity * _channelCount * sizeof(Value)) == Capacity * _channelCount * sizeof(Value);
+        file.close();
+        window->loaded = checkpoint.loaded;
+
+        time_t now = _timeManager->now();
+        uint16_t future = valid && now >= (time_t)checkpoint.loaded ? window->time.size() - window->time.findNext(now) : 0;
+        if (future < MIN_RECORD_CNT) {
+            window->time.clear();
+            return false;
+        }
+
+        Serial.printf("Restored checkpoint [%s] with %d records in the future in %lu ms\n", path.c_str(), future, millis() - start);
+        return true;
+    }
+
+    /**
+     * @brief loads the records of all channels. The files are read in the order of the channels, the first file defines the time axis and the records of
+     * the other files are merged into it.
+     * @param window the window to store the records in
+     * @param strict if true, the loading fails for lines which do not match the expected format
+     * @param replacedFile a data file that is replaced by an upload
+     * @param replacement the file to read instead of replacedFile
+     * @return true if all channels have values for at least MIN_RECORD_CNT records in the future
+     */
+    bool loadWindow(Window *window, bool strict, String replacedFile, String replacement) {
+        window->time.clear();
+        window->loaded = _timeManager->now();
+
+        if (!allocateWindows()) {
+            return false;
+        }
+
+        // a regular reload reads all files in one pass, validation and (re)creating the index and aggregates need the complete files one after the other
+        if (!strict && parseFilesLockstep(window)) {
+            return window->time.size() >= MIN_RECORD_CNT;
+        }
+
+        if (!parseFiles(window, strict, replacedFile, replacement, 0)) {
+            return false;
+        }
+
+        Serial.printf("Updated data records, loaded records = %d\n", window->time.size());
+        return window->time.size() >= MIN_RECORD_CNT;
+    }
+
+    /**
+     * @brief reloads the records after data files were changed in place, e.g. by merging a segment or dropping records. The previous records are outdated,
+     * so unlike an update the reloaded records are activated even if there are fewer than MIN_RECORD_CNT future records, the data source is then not ready
+     * like after loadDataFromFile(). Called with the load mutex held.
+     * @return false if the changed files are invalid
+     */
+    bool reloadChangedFiles() {
+        Window *window = getStagingWindow();
+        window->time.clear();
+        window->loaded = _timeManager->now();
+
+        // the validating reload recreates the index and aggregates of the changed files, files it rejects are loaded like after a reboot
+        bool valid = allocateWindows() && parseFiles(window, true, "", "", 0);
+        if (!valid) {
+            loadWindow(window, false, "", "");
+        }
+        bool loaded = window->time.size() >= MIN_RECORD_CNT;
+
+        _cache.clear();
+        if (loaded) {
+            saveCheckpoint(window);
+        }
+        _active = window;
+        _fileAvailable = loaded;
+        _ready = loaded;
+        notifyChange();
+        return valid;
+    }
+
+    /**
+     * @brief writes the data file followed by the records of its segment to the target file.
+     * @param written the size of the target file
+     * @param crc the CRC32 of the target file
+     */
+    bool mergeSegment(String file, String segmentPath, String target, size_t &written, uint32_t &crc) {
+        File dataFile = LittleFS.open(file.c_str());
+        File segment = LittleFS.open(segmentPath.c_str());
+        QEMSBlockWriter writer;
+        bool merged = dataFile && segment && writer.open(target);
+
+        uint8_t buffer[512];
+        size_t length;
+        bool terminated = true;
+        while (merged && (length = dataFile.read(buffer, sizeof(buffer))) > 0) {
+            merged = writer.write(buffer, length) == length;
+            terminated = buffer[length - 1] == '\n';
+        }
+        merged = merged && (terminated || writer.write((const uint8_t *)"\n", 1) == 1);
+        while (merged && (length = segment.read(buffer, sizeof(buffer))) > 0) {
+            merged = writer.write(buffer, length) == length;
+        }
+        dataFile.close();
+        segment.close();
+
+        bool closed = writer.close();
+        written = writer.getWrittenBytes();
+        crc = writer.getCrc();
+        return closed && merged;
+    }
+
+    /**
+     * @brief parses the data files of all channels one after the other, see parseFile().
+     * @param first the first record of the time axis to fill, 0 for a new time axis
+     */
+    bool parseFiles(Window *window, bool strict, String replacedFile, String replacement, uint16_t first) {
+        for (uint8_t c = 0; c < _channelCount; c++) {
+
+            // channels of a multi column file are loaded together with the first channel of the file
+            bool loaded = false;
+            for (uint8_t p = 0; p < c; p++) {
+                loaded = loaded || _channels[p].file == _channels[c].file;
+            }
+
+            if (loaded) {
+                continue;
+            }
+
+            String path = _channels[c].file == replacedFile ? replacement : _channels[c].file;
+            if (!parseFile(path, _channels[c].file, window, strict, c == 0, first)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief extends a copy of the active records by the records after its last one, used after records were appended to a segment.
+     * @return the number of added records
+     */
+    uint16_t extendWindow(Window *window) {
+        window->time = _active->time;
+        window->loaded = _active->loaded;
+        memcpy(window->values, _active->values, Capacity * _channelCount * sizeof(Value));
+
+        uint16_t first = window->time.size();
+        if (first == 0 || !parseFiles(window, false, "", "", first)) {
+            return 0;
+        }
+
+        return window->time.size() - first;
+    }
+
+    /**
+     * @brief reads the timestamp of the last record of a CSV file.
+     * @return false if the file does not exist or its last line has no timestamp
+     */
+    bool readLastTime(String path, time_t &time) {
+        File file = LittleFS.open(path.c_str());
+        if (!file) {
+            return false;
+        }
+
+        size_t size = file.size();
+        file.seek(size > 128 ? size - 128 : 0);
+        String tail = file.readString();
+        file.close();
+
+        tail.trim();
+        String last = tail.substring(tail.lastIndexOf('\n') + 1);
+        return last.length() >= 19 && QEMSCsvParser::parseTime(last, time);
+    }
+
+    /**
+     * @brief validates records and appends them to the segment of a data file.
+     * @param file the data file
+     * @param records the records, one per line
+     * @param count receives the number of appended records
+     * @return false if one of the records is invalid or not newer than the records before, nothing is appended then
+     */
+    bool writeSegment(String file, String &records, uint16_t &count) {
+        File dataFile = LittleFS.open(file.c_str());
+        bool csv = dataFile && !QEMSCompressedSeries::isCompressed(dataFile);
+        dataFile.close();
+
+        if (!csv) {
+            Serial.printf("Cannot append records to data file [%s]\n", file.c_str());
+            return false;
+        }
+
+        String path = file + SEGMENT_SUFFIX;
+        time_t lastTime = 0;
+        if (!readLastTime(path, lastTime)) {
+            readLastTime(file, lastTime);
+        }
+
+        String segment;
+        uint32_t line = 0;
+        count = 0;
+        for (int start = 0; start < (int)records.length(); line++) {
+            int end = records.indexOf('\n', start);
+            String r = records.substring(start, end < 0 ? records.length() : end);
+            start = end < 0 ? records.length() : end + 1;
+            r.trim();
+
+            if (r.length() == 0) {
+                continue;
+            }
+
+            time_t time;
+            uint16_t values[MAX_CHANNELS];
+            if (r.length() < 21 || r.charAt(19) != ';' || !QEMSCsvParser::parseTime(r, time) || time <= lastTime || !parseFileValues(r, file, values)) {
+                Serial.printf("Invalid appended record in line %d: [%s]\n", line + 1, r.c_str());
+                return false;
+            }
+
+            lastTime = time;
+            segment += r + "\n";
+            count++;
+        }
+
+        File f = LittleFS.open(path.c_str(), FILE_APPEND);
+        bool written = count > 0 && f && f.write((const uint8_t *)segment.c_str(), segment.length()) == segment.length();
+        f.close();
+        return written;
+    }
+
+    /**
+     * @brief loads the records of all channels from their CSV data files in a single pass. The files are read in lockstep: the first file defines the time
+     * axis and for every record of the axis the other files are advanced to their first record that is not older (merge join). Files with the same
+     * timestamps, as the shipped data files, usually have lines with identical timestamps, so a timestamp is only parsed once for all files.
+     * @param window the window to store the records in
+     * @return false if there is only one file or one of the files has no valid index and aggregates or appended records, it has to be parsed with
+     * parseFile() then
+     */
+    bool parseFilesLockstep(Window *window) {
+        unsigned long start = micros();
+        time_t now = _timeManager->now();
+
+        String paths[MAX_CHANNELS];
+        uint8_t fileCount = 0;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            bool listed = false;
+            for (uint8_t f = 0; f < fileCount; f++) {
+                listed = listed || paths[f] == _channels[c].file;
+            }
+            if (!listed) {
+                paths[fileCount++] = _channels[c].file;
+            }
+        }
+
+        File files[MAX_CHANNELS];
+        bool indexed = fileCount > 1;
+        for (uint8_t f = 0; f < fileCount && indexed; f++) {
+            files[f] = LittleFS.open(paths[f]);
+            indexed = files[f] && !QEMSCompressedSeries::isCompressed(files[f]) && QEMSAggregates::exists(paths[f], files[f].size()) &&
+                      !LittleFS.exists((paths[f] + SEGMENT_SUFFIX).c_str()) && QEMSCsvIndex::seek(files[f], paths[f], now + 1);
+        }
+
+        if (!indexed) {
+            for (uint8_t f = 0; f < fileCount; f++) {
+                files[f].close();
+            }
+            return false;
+        }
+
+        String lines[MAX_CHANNELS];
+        time_t times[MAX_CHANNELS] = {0};
+        uint32_t shared = 0; // number of timestamps taken from the line of the first file
+        bool available = true;
+        while (available && files[0].available()) {
+
+            lines[0] = files[0].readStringUntil('\n');
+            lines[0].trim();
+
+            time_t time;
+            if (lines[0].length() < 19 || !QEMSCsvParser::parseTime(lines[0], time) || time <= now) {
+                continue;
+            }
+
+            for (uint8_t f = 1; f < fileCount && available; f++) {
+                while (lines[f].length() == 0 || times[f] < time) {
+                    if (!files[f].available()) {
+                        available = false;
+                        break;
+                    }
+
+                    lines[f] = files[f].readStringUntil('\n');
+                    lines[f].trim();
+
+                    if (lines[f].length() >= 19 && strncmp(lines[f].c_str(), lines[0].c_str(), 19) == 0) {
+                        times[f] = time;
+                        shared++;
+                    } else if (lines[f].length() < 19 || !QEMSCsvParser::parseTime(lines[f], times[f])) {
+                        lines[f] = "";
+                    }
+                }
+            }
+
+            if (!available || !window->time.append(time)) {
+                break;
+            }
+
+            for (uint8_t f = 0; f < fileCount; f++) {
+                storeValues(lines[f], paths[f], window, window->time.size() - 1);
+            }
+        }
+
+        for (uint8_t f = 0; f < fileCount; f++) {
+            files[f].close();
+        }
+
+        Serial.printf("Loaded %d records from %d files in one pass in %lu us, %d timestamps shared\n", window->time.size(), fileCount, micros() - start,
+                      shared);
+        return true;
+    }
+
+    /**
+     * @brief parses a CSV data file and stores the values of all channels loaded from it. If the file has a valid index, parsing starts at the indexed
+     * record right before the first needed one. Otherwise the complete file is parsed and the index is (re)created, which is always the case for the
+     * validation of an upload.
+     * @param path the file to parse
+     * @param channelFile the data file of the channels to fill
+     * @param window the window to store the records in
+     * @param strict if true, the parsing fails for lines which do not match the format "dd.mm.yyyy HH:MM:SS;value[;value...]"
+     * @param createAxis if true, the first Capacity records which are not in the past define the time axis of the window; otherwise each record of the
+     * time axis gets the values of the first record in the file that is not older
+     * @param first the first record of the time axis to fill, records before it are kept. If set, the time axis is extended by the records after its last one.
+     * @return false if the file cannot be opened or is invalid
+     */
+    bool parseFile(String path, String channelFile, Window *window, bool strict, bool createAxis, uint16_t first = 0) {
+
+        // open the file with the data to create records from.
+        File dataFile = LittleFS.open(path);
+        // take the current time.
+        time_t now = _timeManager->now();
+
+        if (!dataFile) {
+            Serial.println("Could not open data file, skip processing...");
+            return false;
+        } else {
+            Serial.printf("Opened data file [%s], process data...\n", path.c_str());
+        }
+
+        if (QEMSCompressedSeries::isCompressed(dataFile)) {
+            size_t size = dataFile.size();
+            dataFile.close();
+            return parseSeries(path, size, channelFile, window, strict, createAxis, first);
+        }
+
+        // the first record needed is the first one after now (or the last record of an extended axis) for the time axis or the first one not older than the
+        // first record to fill
+        time_t after = first > 0 ? window->time.get(first - 1) : now;
+        time_t startTime = createAxis ? after + 1 : first < window->time.size() ? window->time.get(first) : 0;
+        QEMSCsvIndex index;
+        QEMSAggregates aggregates;
+        bool scan = strict || !QEMSAggregates::exists(path, dataFile.size()) || !QEMSCsvIndex::seek(dataFile, path, startTime);
+        bool indexing = scan && index.begin(path, dataFile.size());
+        bool aggregating = scan && aggregates.begin(path, dataFile.size(), getFileChannelCount(channelFile));
+
+        // records appended through the web API continue the data file in its segment until the segment is compacted. They are not indexed or aggregated,
+        // a segment of a replaced data file is dropped with the upload.
+        File segment;
+        File *sources[] = {&dataFile, &segment};
+
+        QEMSParallelParser::Line *parsed;
+        uint16_t recordPointer = first; // pointer to the record of the time axis that is currently filled
+        time_t recordTime = startTime;
+        time_t lastTime = 0;
+        bool full = false;
+        bool valid = true;
+        uint32_t line = 0;
+        for (uint8_t source = 0; source < 2 && valid; source++) {
+
+            // the segment is only needed if the window is not filled yet
+            if (source == 1 && (path != channelFile || (createAxis ? full : recordPointer == window->time.size()) ||
+                                !(segment = LittleFS.open((channelFile + SEGMENT_SUFFIX).c_str())))) {
+                break;
+            }
+
+            // timestamps and values are parsed concurrently, the records are processed in file order
+            QEMSParallelParser parser(*sources[source], [this, channelFile](QEMSParallelParser::Line &line) {
+                line.timed = QEMSCsvParser::parseTime(line.text, line.time);
+                line.valid = parseFileValues(line.text, channelFile, line.values);
+            });
+
+            while (valid && (parsed = parser.next())) {
+
+                String &r = parsed->text;
+                line++;
+
+                if (r.length() == 0) { // ignore empty lines, e.g. at the end of the file
+                    continue;
+                }
+
+                // records of the segment that were already merged into the data file, e.g. after a power loss during the compaction, are skipped
+                if (source == 1 && (!parsed->timed || parsed->time <= lastTime)) {
+                    continue;
+                }
+
+                if (strict && (r.length() < 21 || r.charAt(19) != ';')) {
+                    Serial.printf("Invalid record in line %d: [%s]\n", line, r.c_str());
+                    valid = false;
+                    break;
+                }
+
+                time_t epoch_ts = parsed->time;
+                bool timed = parsed->timed;
+                if (!timed && strict) {
+                    Serial.printf("Invalid timestamp in line %d: [%s]\n", line, r.c_str());
+                    valid = false;
+                    break;
+                }
+
+                if (timed) {
+                    lastTime = max(lastTime, epoch_ts);
+                }
+
+                if (timed && indexing && source == 0) {
+                    index.add(epoch_ts, parsed->offset);
+                }
+
+                if (timed && aggregating && source == 0) {
+                    aggregates.add(epoch_ts, parsed->values);
+                }
+
+                if (createAxis) {
+                    // record is in the future, store it ffu
+                    if (epoch_ts > after && !full) {
+                        full = !window->time.append(epoch_ts);
+                        if (!full) {
+                            storeFileValues(parsed->values, channelFile, window, window->time.size() - 1);
+                        }
+                        if (!full && !parsed->valid && strict) {
+                            Serial.printf("Invalid value in line %d: [%s]\n", line, r.c_str());
+                            valid = false;
+                        }
+                    }
+                } else {
+                    while (valid && recordPointer < window->time.size() && recordTime <= epoch_ts) {
+                        storeFileValues(parsed->values, channelFile, window, recordPointer);
+                        if (!parsed->valid && strict) {
+                            Serial.printf("Invalid value in line %d: [%s]\n", line, r.c_str());
+                            valid = false;
+                        }
+                        recordPointer++;
+                        recordTime = recordPointer < window->time.size() ? window->time.get(recordPointer) : 0;
+                    }
+                }
+
+                // without validation, indexing and aggregation the rest of the file is not needed once the window is filled
+                if (!scan && (createAxis ? full : recordPointer == window->time.size())) {
+                    break;
+                }
+            }
+        }
+
+        dataFile.close();
+        segment.close();
+
+        if (indexing) {
+            index.end(valid);
+        }
+
+        if (aggregating) {
+            aggregates.end(valid);
+        }
+
+        if (!valid) {
+            return false;
+        }
+
+        // the time axis is limited to the records all channels have values for
+        if (!createAxis && recordPointer < window->time.size()) {
+            Serial.printf("Data file [%s] provides values only for %d of %d records\n", path.c_str(), recordPointer, window->time.size());
+            window->time.truncate(recordPointer);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief reads a compressed data file, see QEMSCompressedSeries, and stores the values of all channels loaded from it. The blocks are decoded one after the
+     * other, starting with the block right before the first needed record if the aggregates of the file exist. Otherwise the complete file is decoded and the
+     * aggregates are created. Parameters and result as for parseFile().
+     */
+    bool parseSeries(String path, size_t size, String channelFile, Window *window, bool strict, bool createAxis, uint16_t first) {
+        QEMSSeriesReader series;
+        if (!series.open(path)) {
+            return false;
+        }
+
+        uint8_t columns[MAX_CHANNELS];
+        uint8_t positions = 0;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            if (_channels[c].file == channelFile) {
+                if (_channels[c].column > series.getChannelCount()) {
+                    Serial.printf("Data file [%s] has no column %d\n", path.c_str(), _channels[c].column);
+                    return false;
+                }
+                columns[positions++] = _channels[c].column - 1;
+            }
+        }
+
+        time_t after = first > 0 ? window->time.get(first - 1) : _timeManager->now();
+        time_t startTime = createAxis ? after + 1 : first < window->time.size() ? window->time.get(first) : 0;
+        QEMSAggregates aggregates;
+        bool scan = strict || !QEMSAggregates::exists(path, size);
+        bool aggregating = scan && aggregates.begin(path, size, positions);
+        if (!scan) {
+            series.seek(startTime);
+        }
+
+        uint16_t recordPointer = first;
+        time_t recordTime = startTime;
+        time_t lastTime = 0;
+        bool full = false;
+        bool valid = true;
+        time_t time;
+        uint16_t record[MAX_CHANNELS];
+        while (valid && series.next(time, record)) {
+
+            if (time < lastTime) {
+                Serial.printf("Data file [%s] is not sorted by time\n", path.c_str());
+                valid = false;
+                break;
+            }
+            lastTime = time;
+
+            uint16_t values[MAX_CHANNELS];
+            for (uint8_t p = 0; p < positions; p++) {
+                values[p] = record[columns[p]];
+            }
+
+            if (aggregating) {
+                aggregates.add(time, values);
+            }
+
+            if (createAxis) {
+                if (time > after && !full) {
+                    full = !window->time.append(time);
+                    if (!full) {
+                        storeFileValues(values, channelFile, window, window->time.size() - 1);
+                    }
+                }
+            } else {
+                while (recordPointer < window->time.size() && recordTime <= time) {
+                    storeFileValues(values, channelFile, window, recordPointer);
+                    recordPointer++;
+                    recordTime = recordPointer < window->time.size() ? window->time.get(recordPointer) : 0;
+                }
+            }
+
+            if (!scan && (createAxis ? full : recordPointer == window->time.size())) {
+                break;
+            }
+        }
+
+        valid = valid && series.isValid();
+        if (aggregating) {
+            aggregates.end(valid);
+        }
+
+        if (!valid) {
+            return false;
+        }
+
+        if (!createAxis && recordPointer < window->time.size()) {
+            Serial.printf("Data file [%s] provides values only for %d of %d records\n", path.c_str(), recordPointer, window->time.size());
+            window->time.truncate(recordPointer);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief stores the values of all channels loaded from the passed file, given in hundredth of a percent in the order of the channels.
      */
-    Record _dataPoints[RECORD_CNT] = {0, 0};
+    void storeFileValues(const uint16_t *values, String channelFile, Window *window, uint16_t index) {
+        uint8_t position = 0;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            if (_channels[c].file == channelFile) {
+                window->values[c * Capacity + index] = values[position++] * QEMSFixedPoint<Value>::SCALE / QEMSFixedPoint<uint16_t>::SCALE;
+            }
+        }
+    }
+
+    /**
+     * @brief returns the number of channels loaded from the passed file.
+     */
+    uint8_t getFileChannelCount(String channelFile) {
+        uint8_t count = 0;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            count += _channels[c].file == channelFile;
+        }
+        return count;
+    }
+
+    /**
+     * @brief parses the values of all channels loaded from the passed file in hundredth of a percent, as used for the aggregates.
+     * @return false if one of the values is missing or not a number
+     */
+    bool parseFileValues(String &r, String channelFile, uint16_t *values) {
+        bool valid = true;
+        uint8_t position = 0;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            int value = 0;
+            if (_channels[c].file == channelFile) {
+                valid = QEMSCsvParser::parseValue(r, _channels[c].column, QEMSFixedPoint<uint16_t>::SCALE, value) && valid;
+                values[position++] = value;
+            }
+        }
+        return valid;
+    }
+
+    /**
+     * @brief stores the values of all channels loaded from the passed file.
+     * @return false if one of the values is missing or not a number
+     */
+    bool storeValues(String &r, String channelFile, Window *window, uint16_t index) {
+        bool valid = true;
+
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            if (_channels[c].file != channelFile) {
+                continue;
+            }
+
+            int value;
+            valid = QEMSCsvParser::parseValue(r, _channels[c].column, QEMSFixedPoint<Value>::SCALE, value) && valid;
+            window->values[c * Capacity + index] = value;
+        }
+
+        return valid;
+    }
 };
 
 #endif
@@ -0,0 +1,280 @@
+#ifndef QEMS_DATA_SOURCE_H_
+#define QEMS_DATA_SOURCE_H_
+
+#include <Arduino.h>
+#include <functional>
+
+/**
+ * Maximum number of value channels managed by one data manager.
+ */
+#define MAX_CHANNELS 4
+
+/**
+ * Minimum number of records in the future a data file has to provide to be accepted.
+ */
+#define MIN_RECORD_CNT 120
+
+/**
+ * File extension of the checkpoint of the loaded records, stored next to the data file of the first channel, e.g. "/co2.csv.chk".
+ */
+#define CHECKPOINT_SUFFIX ".chk"
+
+/**
+ * File extension of the segment with the records appended to a data file through the web API, e.g. "/co2.csv.seg". The segment continues the data file
+ * until it is merged into it by compactSegment().
+ */
+#define SEGMENT_SUFFIX ".seg"
+
+/**
+ * Size of a segment in bytes from which on it is merged into its data file in the background.
+ */
+#define SEGMENT_COMPACT_SIZE 8192
+
+struct QEMSAggregate;
+struct QEMSCacheStatistics;
+
+/**
+ * @brief interface of the data managers that provide the channel values to the display. The records are either kept in a RAM window (QEMSDataManager,
+ * layout chosen through its template parameters) or in a memory mapped flash partition (QEMSMappedDataManager), the tasks and the web server only depend on
+ * this interface.
+ */
+class QEMSDataSource {
+
+  public:
+    QEMSDataSource() { _changed = xSemaphoreCreateBinary(); }
+
+    virtual ~QEMSDataSource() { vSemaphoreDelete(_changed); }
+
+    /**
+     * @brief adds a channel to the data source. Channels that are read from the same file are loaded in one pass.
+     * @param dataFile the file to load the data from
+     * @param column the value column in the file, starting with 1
+     * @return the index of the channel
+     */
+    virtual uint8_t addChannel(String dataFile, uint8_t column = 1) = 0;
+
+    virtual uint8_t getChannelCount() = 0;
+
+    /**
+     * @brief returns the file the passed channel is loaded from.
+     */
+    virtual String getFileName(uint8_t channel) = 0;
+
+    /**
+     * @brief returns true if one of the channels is loaded from the passed file.
+     */
+    virtual bool usesFile(String file) = 0;
+
+    /**
+     * @brief determines the active record and stores the values of all channels in percent.
+     * @param values array with one entry per channel
+     * @param validUntil if set, receives the time until the values stay the same, i.e. the timestamp of the active record
+     * @return false if no data is available for the current time, in this case all values are 0
+     */
+    virtual bool getActiveValues(int *values, time_t *validUntil = nullptr) = 0;
+
+    /**
+     * @brief returns the active value of a single channel in percent.
+     */
+    int getActiveValue(uint8_t channel) {
+        int values[MAX_CHANNELS];
+        getActiveValues(values);
+        return values[channel];
+    }
+
+    /**
+     * @brief samples the values of all channels at an arbitrary time. The records are treated as samples at their timestamps and the values are
+     * interpolated linearly between the last record at or before the time and the first record after it.
+     * @param timeMs the time in milliseconds since epoch
+     * @param values array with one entry per channel, the values in percent
+     * @return false if the time is not covered by the loaded records, in this case all values are 0
+     */
+    virtual bool sampleValues(int64_t timeMs, float *values) = 0;
+
+    /**
+     * @brief returns the time the active values change next, i.e. the timestamp of the active record. Until then getActiveValues() returns the same values.
+     * @param time the time to start from
+     * @return the timestamp of the next change or 0 if there is no data for the time
+     */
+    virtual time_t getNextChange(time_t time) = 0;
+
+    /**
+     * @brief waits until the values returned by the last getActiveValues() call are no longer valid, either because the time reached the next record or
+     * because new records were loaded. Checking with a timeout of 0 needs no time conversion, so it can be done on every iteration of the UI loop.
+     * @param timeoutMs maximum time to wait in milliseconds, 0 to only check
+     * @return true if the active values have to be read again
+     */
+    bool waitForChange(uint32_t timeoutMs) {
+        int32_t remaining = _changeDeadline - millis();
+        if (remaining <= 0) {
+            return true;
+        }
+
+        return xSemaphoreTake(_changed, pdMS_TO_TICKS(min((uint32_t)remaining, timeoutMs))) == pdTRUE || (int32_t)(_changeDeadline - millis()) <= 0;
+    }
+
+    /**
+     * @brief reads the records of a channel in a time range. Records that are not loaded are read from the data file, if supported by the data source.
+     * @param channel the channel
+     * @param from the start of the range (inclusive)
+     * @param to the end of the range (exclusive)
+     * @param times receives the timestamps of the records
+     * @param values receives the values of the records in percent
+     * @param maxCount the size of the arrays
+     * @return the number of records stored in the arrays
+     */
+    virtual uint16_t getRecords(uint8_t channel, time_t from, time_t to, time_t *times, float *values, uint16_t maxCount) = 0;
+
+    /**
+     * @brief aggregates the values of a channel over a time range of its data file, see QEMSAggregates.
+     * @param channel the channel
+     * @param from the start of the range (inclusive)
+     * @param to the end of the range (exclusive)
+     * @param result the aggregated values in percent
+     * @return false if there are no aggregates for the data file or no records in the range
+     */
+    virtual bool getAggregate(uint8_t channel, time_t from, time_t to, QEMSAggregate &result) = 0;
+
+    /**
+     * @brief returns the counters of the cache for records that are not loaded, see QEMSRecordCache.
+     * @return false if the data source has no such cache
+     */
+    virtual bool getCacheStatistics(QEMSCacheStatistics &statistics) { return false; }
+
+    /**
+     * @brief returns the aggregated values of a channel from the start of the current day and week up to the current time, see QEMSRunningTotals. The
+     * totals are updated while the active values advance, so reading them costs no access to the records.
+     * @param channel the channel
+     * @param today the aggregated values of today in percent
+     * @param week the aggregated values of the current week in percent
+     * @return false if the data source keeps no totals or no active values were read yet
+     */
+    virtual bool getRunningTotals(uint8_t channel, QEMSAggregate &today, QEMSAggregate &week) { return false; }
+
+    /**
+     * @brief restarts the running totals from the aggregates of the data files if other records were activated or the clock jumped since they were started.
+     * Reading the aggregates accesses the file system, so the data task calls this after loading records while getActiveValues() only adds the records the
+     * clock passed, and skips them until the totals were restarted.
+     * @return false if the totals were up to date, no records are loaded or the data source keeps no totals
+     */
+    virtual bool restartTotals() { return false; }
+
+    /**
+     * @brief returns a counter that is incremented whenever new records were activated, used to detect that views of the records have to be rebuilt.
+     */
+    uint32_t getGeneration() { return _generation; }
+
+    virtual bool isFileAvailable() = 0;
+
+    virtual bool isReady() = 0;
+
+    /**
+     * @brief loads data records from the uploaded CSV files.
+     */
+    virtual void loadDataFromFile() = 0;
+
+    /**
+     * @brief validates an uploaded replacement of a data file and loads the records of all channels into a staging area. The active records stay untouched
+     * until commitUpdate() is called, so the display continues to show data while the new file is processed.
+     * @param file the data file that is replaced, an empty String reloads the existing files
+     * @param replacement the temporary file the upload was written to
+     * @return true if the file is valid and contains enough records in the future; in this case either commitUpdate() or discardUpdate() has to be called by
+     * the same task, loads and other updates are blocked until then
+     */
+    virtual bool prepareUpdate(String file, String replacement) = 0;
+
+    /**
+     * @brief activates the records loaded by prepareUpdate(). Has to be called after the uploaded file replaced the data file.
+     */
+    virtual void commitUpdate() = 0;
+
+    /**
+     * @brief drops the records loaded by prepareUpdate() and keeps the active ones.
+     */
+    virtual void discardUpdate() = 0;
+
+    /**
+     * @brief appends records to the segment of the data file of a channel and merges them into the active records without reloading the data files.
+     * @param channel the channel, the records provide the values of all channels loaded from its file
+     * @param records lines in the format of the data file, all newer than the last record of the file and its segment
+     * @return false if the records are invalid or the data source does not support appending
+     */
+    virtual bool appendRecords(uint8_t channel, String &records) = 0;
+
+    /**
+     * @brief merges the segment of the data file of a channel into the data file and recreates its index and aggregates.
+     * @return false if the segment could not be merged or the merged data file is invalid
+     */
+    virtual bool compactSegment(uint8_t channel) = 0;
+
+    /**
+     * @brief drops the records before the passed time from the data files of all channels, see QEMSRetention, and reloads the records afterwards.
+     * @return false if the shortened data files are invalid
+     */
+    virtual bool dropHistory(time_t before) = 0;
+
+    /**
+     * @brief sets the function that is called after a data file was rewritten by compactSegment() or dropHistory(), e.g. to update the file index of the
+     * web server without reading the file again.
+     * @param listener called with the path, the size and the CRC32 of the written file
+     */
+    void setFileListener(std::function<void(String path, size_t size, uint32_t crc)> listener) { _fileListener = listener; }
+
+  protected:
+    /**
+     * @brief returns the position of a channel among the channels loaded from the same file.
+     */
+    uint8_t getFilePosition(uint8_t channel) {
+        uint8_t position = 0;
+        for (uint8_t c = 0; c < channel; c++) {
+            position += getFileName(c) == getFileName(channel);
+        }
+        return position;
+    }
+
+    /**
+     * @brief drops a pending change notification, called before the active records are read, so only later changes wake up waitForChange().
+     */
+    void clearChange() { xSemaphoreTake(_changed, 0); }
+
+    /**
+     * @brief sets the deadline for waitForChange() after the active values were determined.
+     * @param validMs the real time in milliseconds until the values change, see QEMSTimeManager::toRealMillis(), 0 if there is no data
+     */
+    void setValidity(uint32_t validMs) { _changeDeadline = millis() + validMs; }
+
+    /**
+     * @brief reports a rewritten data file to the listener, see setFileListener().
+     */
+    void notifyFileWritten(String path, size_t size, uint32_t crc) {
+        if (_fileListener) {
+            _fileListener(path, size, crc);
+        }
+    }
+
+    /**
+     * @brief wakes up waitForChange() after new records were activated.
+     */
+    void notifyChange() {
+        _generation++;
+        _changeDeadline = millis();
+        xSemaphoreGive(_changed);
+    }
+
+  private:
+    /**
+     * Value of millis() when the active values change.
+     */
+    volatile uint32_t _changeDeadline = 0;
+
+    volatile uint32_t _generation = 0;
+
+    /**
+     * Given when new records are activated.
+     */
+    SemaphoreHandle_t _changed;
+
+    std::function<void(String, size_t, uint32_t)> _fileListener;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef QEMS_FILE_INDEX_H_
+#define QEMS_FILE_INDEX_H_
+
+#include <LittleFS.h>
+#include <QEMSAggregates.h>
+#include <QEMSCsvIndex.h>
+#include <QEMSDataSource.h>
+#include <esp_rom_crc.h>
+#include <vector>
+
+/**
+ * Extensions of the files created next to a data file, e.g. "/co2.csv.idx". They are maintained together with their data file and not listed.
+ */
+#define SIDECAR_SUFFIXES {CSV_INDEX_SUFFIX, AGGREGATE_SUFFIX, CHECKPOINT_SUFFIX, SEGMENT_SUFFIX, ARCHIVE_SUFFIX}
+
+/**
+ * @brief in-memory index of the files in the root directory of the file system. The index is built once on startup and afterwards maintained by the
+ * operations that modify the file system, so listing files and checking for their existence does not touch the flash. The index is updated by background jobs
+ * and read by the web server, all accesses are synchronized.
+ */
+class QEMSFileIndex {
+
+  public:
+    /**
+     * Index entry of a single file.
+     */
+    struct Entry {
+        String name;     // file name without leading slash
+        size_t size;     // size in bytes
+        time_t modified; // epoch timestamp of the upload
+        uint32_t crc;    // CRC32 of the content
+    };
+
+    /**
+     * @brief reads the root directory and calculates the checksum of every file.
+     * @return false if the root directory cannot be opened
+     */
+    bool build() {
+        File root = LittleFS.open("/");
+        if (!root) {
+            return false;
+        }
+
+        std::vector<Entry> entries;
+
+        // no support for directories in this simple demo application
+        while (true) {
+            File entry = root.openNextFile();
+            if (!entry) {
+                // no more files
+                break;
+            }
+
+            bool sidecar = false;
+            for (const char *suffix : SIDECAR_SUFFIXES) {
+                sidecar = sidecar || String(entry.name()).endsWith(suffix);
+            }
+
+            if (sidecar) {
+                entry.close();
+                continue;
+            }
+
+            uint8_t buf[512];
+            uint32_t crc = 0;
+            size_t len;
+            while ((len = entry.read(buf, sizeof(buf))) > 0) {
+                crc = esp_rom_crc32_le(crc, buf, len);
+            }
+
+            entries.push_back({String(entry.name()), entry.size(), entry.getLastWrite(), crc});
+            entry.close();
+        }
+
+        root.close();
+
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        _entries = entries;
+        refreshUsage();
+        xSemaphoreGive(_mutex);
+
+        Serial.printf("Indexed %d files, usage %d / %d bytes\n", entries.size(), _usedBytes, _totalBytes);
+        return true;
+    }
+
+    /**
+     * @brief adds a file to the index or replaces the entry of an existing file with the same name.
+     */
+    void put(String name, size_t size, time_t modified, uint32_t crc) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+
+        Entry *entry = find(name);
+        if (entry) {
+            *entry = {name, size, modified, crc};
+        } else {
+            _entries.push_back({name, size, modified, crc});
+        }
+        refreshUsage();
+
+        xSemaphoreGive(_mutex);
+    }
+
+    /**
+     * @brief removes a file from the index.
+     */
+    void remove(String name) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+
+        for (auto it = _entries.begin(); it != _entries.end(); it++) {
+            if (it->name == name) {
+                _entries.erase(it);
+                break;
+            }
+        }
+        refreshUsage();
+
+        xSemaphoreGive(_mutex);
+    }
+
+    /**
+     * @brief removes all files from the index, used after the file system was formatted.
+     */
+    void clear() {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        _entries.clear();
+        refreshUsage();
+        xSemaphoreGive(_mutex);
+    }
+
+    /**
+     * @brief returns true if the file with the passed name exists.
+     */
+    bool exists(String name) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        bool result = find(name) != nullptr;
+        xSemaphoreGive(_mutex);
+        return result;
+    }
+
+    /**
+     * @brief returns a copy of the index entries.
+     */
+    std::vector<Entry> getEntries() {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        std::vector<Entry> result = _entries;
+        xSemaphoreGive(_mutex);
+        return result;
+    }
+
+    size_t getUsedBytes() { return _usedBytes; }
+
+    size_t getTotalBytes() { return _totalBytes; }
+
+  private:
+    /**
+     * Returns the entry for the passed file name or null if the file does not exist, the caller has to hold the mutex.
+     */
+    Entry *find(String name) {
+        for (Entry &entry : _entries) {
+            if (entry.name == name) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Reads the usage of the file system, which requires a traversal of the file system metadata and is therefore only done after a modification.
+     */
+    void refreshUsage() {
+        _usedBytes = LittleFS.usedBytes();
+        _totalBytes = LittleFS.totalBytes();
+    }
+
+    /**
+     * The indexed files.
+     */
+    std::vector<Entry> _entries;
+
+    size_t _usedBytes = 0;
+
+    size_t _totalBytes = 0;
+
+    /**
+     * Synchronizes the access to the entries.
+     */
+    SemaphoreHandle_t _mutex = xSemaphoreCreateMutex();
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef QEMS_FLASH_IMAGE_H_
+#define QEMS_FLASH_IMAGE_H_
+
+#include <Arduino.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_partition.h>
+#include <esp_spi_flash.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Label of the raw data partition holding the image, see partitions_mmap.csv.
+ */
+#define FLASH_IMAGE_PARTITION "qems"
+
+/**
+ * Image file and its size used instead of the partition on the host.
+ */
+#define FLASH_IMAGE_FILE "qems.img"
+#define FLASH_IMAGE_SIZE 0x100000
+
+/**
+ * Erase unit of the flash, erased ranges have to be aligned to it.
+ */
+#define FLASH_SECTOR_SIZE 4096
+
+/**
+ * @brief raw flash area that is written with explicit erase and program operations and read through memory mapping. On the ESP32 the area is a data
+ * partition, mapped into the address space through the flash cache, so reading does not copy the data into RAM. On the host the same interface is backed by
+ * an image file mapped with mmap, so code reading the image can be run and measured outside the device.
+ */
+class QEMSFlashImage {
+
+  public:
+    /**
+     * @brief a mapped range of the image.
+     */
+    struct Mapping {
+        const uint8_t *data = nullptr;
+#ifdef ESP_PLATFORM
+        spi_flash_mmap_handle_t handle = 0;
+#else
+        size_t length = 0;
+#endif
+    };
+
+    /**
+     * @brief opens the partition or image file.
+     * @return false if there is no partition for the image
+     */
+    bool begin() {
+#ifdef ESP_PLATFORM
+        _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, FLASH_IMAGE_PARTITION);
+        if (!_partition) {
+            Serial.printf("Partition [%s] not found\n", FLASH_IMAGE_PARTITION);
+            return false;
+        }
+        _size = _partition->size;
+#else
+        _fd = open(FLASH_IMAGE_FILE, O_RDWR | O_CREAT, 0644);
+        if (_fd < 0 || ftruncate(_fd, FLASH_IMAGE_SIZE) != 0) {
+            Serial.printf("Cannot open image [%s]\n", FLASH_IMAGE_FILE);
+            return false;
+        }
+        _size = FLASH_IMAGE_SIZE;
+#endif
+        Serial.printf("Opened flash image with %d bytes\n", _size);
+        return true;
+    }
+
+    size_t size() { return _size; }
+
+    /**
+     * @brief erases a range of the image, i.e. sets all bits. Offset and length have to be multiples of FLASH_SECTOR_SIZE.
+     */
+    bool erase(size_t offset, size_t length) {
+#ifdef ESP_PLATFORM
+        return esp_partition_erase_range(_partition, offset, length) == ESP_OK;
+#else
+        uint8_t erased[FLASH_SECTOR_SIZE];
+        memset(erased, 0xFF, sizeof(erased));
+        for (size_t pos = 0; pos < length; pos += FLASH_SECTOR_SIZE) {
+            if (pwrite(_fd, erased, FLASH_SECTOR_SIZE, offset + pos) != FLASH_SECTOR_SIZE) {
+                return false;
+            }
+        }
+        return true;
+#endif
+    }
+
+    /**
+     * @brief writes data to an erased range of the image.
+     */
+    bool write(size_t offset, const void *data, size_t length) {
+#ifdef ESP_PLATFORM
+        return esp_partition_write(_partition, offset, data, length) == ESP_OK;
+#else
+        return pwrite(_fd, data, length, offset) == (ssize_t)length;
+#endif
+    }
+
+    /**
+     * @brief reads data from the image without mapping it.
+     */
+    bool read(size_t offset, void *data, size_t length) {
+#ifdef ESP_PLATFORM
+        return esp_partition_read(_partition, offset, data, length) == ESP_OK;
+#else
+        return pread(_fd, data, length, offset) == (ssize_t)length;
+#endif
+    }
+
+    /**
+     * @brief maps a range of the image into the address space. A range has to be mapped after it was written, an existing mapping may not reflect later
+     * writes. The offset has to be a multiple of FLASH_SECTOR_SIZE.
+     */
+    bool map(size_t offset, size_t length, Mapping &mapping) {
+#ifdef ESP_PLATFORM
+        const void *data;
+        if (esp_partition_mmap(_partition, offset, length, SPI_FLASH_MMAP_DATA, &data, &mapping.handle) != ESP_OK) {
+            return false;
+        }
+        mapping.data = (const uint8_t *)data;
+#else
+        void *data = mmap(nullptr, length, PROT_READ, MAP_SHARED, _fd, offset);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        mapping.data = (const uint8_t *)data;
+        mapping.length = length;
+#endif
+        return true;
+    }
+
+    /**
+     * @brief releases a mapping, the data of the mapping may not be accessed afterwards.
+     */
+    void unmap(Mapping &mapping) {
+        if (!mapping.data) {
+            return;
+        }
+#ifdef ESP_PLATFORM
+        spi_flash_munmap(mapping.handle);
+#else
+        munmap((void *)mapping.data, mapping.length);
+#endif
+        mapping = Mapping();
+    }
+
+  private:
+#ifdef ESP_PLATFORM
+    const esp_partition_t *_partition = nullptr;
+#else
+    int _fd = -1;
+#endif
+
+    size_t _size = 0;
+};
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef QEMS_GZIP_INFLATER_H_
+#define QEMS_GZIP_INFLATER_H_
+
+#include <Arduino.h>
+#include <QEMSBlockWriter.h>
+#include <esp_rom_crc.h>
+
+#if __has_include("esp32/rom/miniz.h")
+#include "esp32/rom/miniz.h"
+#else
+#include "rom/miniz.h"
+#endif
+
+/**
+ * Flags of the gzip member header (RFC 1952)
+ */
+#define GZIP_FLAG_HCRC 0x02
+#define GZIP_FLAG_EXTRA 0x04
+#define GZIP_FLAG_NAME 0x08
+#define GZIP_FLAG_COMMENT 0x10
+
+/**
+ * @brief streaming gzip decompressor based on the inflate implementation in the ESP32 ROM. The compressed data is passed in chunks as it arrives and the
+ * decompressed data is passed on to a block writer, so neither the compressed nor the decompressed file is held in RAM. Only the 32 KB deflate window is
+ * needed, which is the smallest window a standard gzip stream can be decoded with.
+ */
+class QEMSGzipInflater {
+
+    /**
+     * Parsing state of the gzip stream.
+     */
+    enum State { HEADER, EXTRA_LENGTH, EXTRA, NAME, COMMENT, HEADER_CRC, DATA, TRAILER, DONE, FAILED };
+
+  public:
+    ~QEMSGzipInflater() { release(); }
+
+    /**
+     * @brief allocates the buffers for a new gzip stream.
+     * @param writer the writer the decompressed data is passed to
+     * @param maxSize the number of decompressed bytes the stream fails at, e.g. the free space of the file system
+     * @return true if the buffers could be allocated
+     */
+    bool begin(QEMSBlockWriter *writer, size_t maxSize = SIZE_MAX) {
+        release();
+
+        _decompressor = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+        _dictionary = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+
+        if (!_decompressor || !_dictionary) {
+            Serial.println("Cannot allocate inflate buffers");
+            release();
+            return false;
+        }
+
+        tinfl_init(_decompressor);
+        _writer = writer;
+        _maxSize = maxSize;
+        _state = HEADER;
+        _headerPos = 0;
+        _dictionaryPos = 0;
+        _crc = 0;
+        _size = 0;
+        return true;
+    }
+
+    /**
+     * @brief processes the next chunk of the compressed stream.
+     * @return false if the stream is invalid or the decompressed data cannot be written
+     */
+    bool write(const uint8_t *data, size_t len) {
+        size_t pos = 0;
+
+        while (pos < len && _state != DATA && _state != FAILED) {
+            parseHeader(data[pos++]);
+        }
+
+        if (_state == DATA) {
+            pos += inflate(data + pos, len - pos);
+        }
+
+        while (pos < len && _state == TRAILER) {
+            _header[_headerPos++] = data[pos++];
+            if (_headerPos == 8) {
+                _state = checkTrailer() ? DONE : FAILED;
+            }
+        }
+
+        if (pos < len && _state == DONE) {
+            Serial.println("Ignore data after the end of the gzip stream");
+        }
+
+        return _state != FAILED;
+    }
+
+    /**
+     * @brief frees the buffers after the stream was processed.
+     * @return true if the complete stream was decompressed and the checksum matches
+     */
+    bool end() {
+        bool result = _state == DONE;
+        if (!result) {
+            Serial.println("Incomplete gzip stream");
+        }
+
+        release();
+        return result;
+    }
+
+    /**
+     * @brief returns the number of decompressed bytes.
+     */
+    size_t getSize() { return _size; }
+
+  private:
+    /**
+     * Processes one byte of the gzip member header.
+     */
+    void parseHeader(uint8_t b) {
+        switch (_state) {
+        case HEADER:
+            _header[_headerPos++] = b;
+            if (_headerPos == 10) {
+                if (_header[0] != 0x1f || _header[1] != 0x8b || _header[2] != 8) { // magic bytes and deflate compression method
+                    Serial.println("Invalid gzip header");
+                    _state = FAILED;
+                    return;
+                }
+                _flags = _header[3];
+                _headerPos = 0;
+                nextHeaderField(EXTRA_LENGTH);
+            }
+            break;
+        case EXTRA_LENGTH:
+            _header[_headerPos++] = b;
+            if (_headerPos == 2) {
+                _skip = _header[0] | (_header[1] << 8);
+                _headerPos = 0;
+                if (_skip > 0) {
+                    _state = EXTRA;
+                } else {
+                    nextHeaderField(NAME);
+                }
+            }
+            break;
+        case EXTRA:
+            if (--_skip == 0) {
+                nextHeaderField(NAME);
+            }
+            break;
+        case NAME:
+            if (b == 0) {
+                nextHeaderField(COMMENT);
+            }
+            break;
+        case COMMENT:
+            if (b == 0) {
+                nextHeaderField(HEADER_CRC);
+            }
+            break;
+        case HEADER_CRC:
+            if (++_headerPos == 2) {
+                _headerPos = 0;
+                _state = DATA;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    /**
+     * Moves to the passed optional header field or the next one that is present according to the header flags.
+     */
+    void nextHeaderField(State state) {
+        if (state <= EXTRA_LENGTH && (_flags & GZIP_FLAG_EXTRA)) {
+            _state = EXTRA_LENGTH;
+        } else if (state <= NAME && (_flags & GZIP_FLAG_NAME)) {
+            _state = NAME;
+        } else if (state <= COMMENT && (_flags & GZIP_FLAG_COMMENT)) {
+            _state = COMMENT;
+        } else if (state <= HEADER_CRC && (_flags & GZIP_FLAG_HCRC)) {
+            _state = HEADER_CRC;
+        } else {
+            _state = DATA;
+        }
+    }
+
+    /**
+     * Passes compressed data to the inflate implementation and writes the decompressed data. The output is written to the circular dictionary, which
+     * serves as the back reference window for the following data.
+     * @return the number of bytes consumed
+     */
+    size_t inflate(const uint8_t *data, size_t len) {
+        size_t pos = 0;
+        tinfl_status status;
+
+        do {
+            size_t inBytes = len - pos;
+            size_t outBytes = TINFL_LZ_DICT_SIZE - _dictionaryPos;
+
+            status = tinfl_decompress(_decompressor, data + pos, &inBytes, _dictionary, _dictionary + _dictionaryPos, &outBytes,
+                                      TINFL_FLAG_HAS_MORE_INPUT);
+            pos += inBytes;
+
+            if (outBytes > _maxSize - _size) {
+                Serial.printf("Decompressed data exceeds %d bytes\n", _maxSize);
+                _state = FAILED;
+                return pos;
+            }
+
+            if (outBytes > 0) {
+                if (_writer->write(_dictionary + _dictionaryPos, outBytes) != outBytes) {
+                    _state = FAILED;
+                    return pos;
+                }
+
+                _crc = esp_rom_crc32_le(_crc, _dictionary + _dictionaryPos, outBytes);
+                _size += outBytes;
+                _dictionaryPos = (_dictionaryPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+            }
+
+            if (status < TINFL_STATUS_DONE) {
+                Serial.printf("Inflate failed with status %d\n", status);
+                _state = FAILED;
+                return pos;
+            }
+
+        } while (status == TINFL_STATUS_HAS_MORE_OUTPUT || (status == TINFL_STATUS_NEEDS_MORE_INPUT && pos < len));
+
+        if (status == TINFL_STATUS_DONE) {
+            _state = TRAILER;
+            _headerPos = 0;
+        }
+
+        return pos;
+    }
+
+    /**
+     * Compares the CRC32 and size of the trailer with the decompressed data.
+     */
+    bool checkTrailer() {
+        uint32_t crc = _header[0] | (_header[1] << 8) | (_header[2] << 16) | ((uint32_t)_header[3] << 24);
+        uint32_t size = _header[4] | (_header[5] << 8) | (_header[6] << 16) | ((uint32_t)_header[7] << 24);
+
+        if (crc != _crc || size != (uint32_t)_size) {
+            Serial.printf("gzip checksum mismatch, crc %08x / %08x, size %d / %d\n", crc, _crc, size, _size);
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Frees the allocated buffers.
+     */
+    void release() {
+        free(_decompressor);
+        free(_dictionary);
+        _decompressor = nullptr;
+        _dictionary = nullptr;
+    }
+
+    /**
+     * Inflate state of the ROM implementation.
+     */
+    tinfl_decompressor *_decompressor = nullptr;
+
+    /**
+     * Circular output buffer with the size of the deflate window.
+     */
+    uint8_t *_dictionary = nullptr;
+
+    /**
+     * Write position in the dictionary.
+     */
+    size_t _dictionaryPos = 0;
+
+    /**
+     * Writer for the decompressed data.
+     */
+    QEMSBlockWriter *_writer = nullptr;
+
+    State _state = DONE;
+
+    /**
+     * Buffer for the fixed size parts of the header and the trailer.
+     */
+    uint8_t _header[10];
+    uint8_t _headerPos = 0;
+
+    /**
+     * Flags from the gzip header.
+     */
+    uint8_t _flags = 0;
+
+    /**
+     * Remaining bytes of the extra header field.
+     */
+    uint16_t _skip = 0;
+
+    /**
+     * CRC32 and size of the decompressed data.
+     */
+    uint32_t _crc = 0;
+    size_t _size = 0;
+
+    /**
+     * Limit of the decompressed data.
+     */
+    size_t _maxSize = SIZE_MAX;
+};
+
+#endif
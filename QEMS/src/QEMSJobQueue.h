@@ -0,0 +1,205 @@
+#ifndef QEMS_JOB_QUEUE_H_
+#define QEMS_JOB_QUEUE_H_
+
+#include <Arduino.h>
+#include <functional>
+
+/**
+ * Number of jobs kept in the job table, older jobs are overwritten by new ones.
+ */
+#define JOB_HISTORY 8
+
+/**
+ * @brief queue for long running operations like formatting the file system. The jobs are executed one after the other by a separate task with low priority,
+ * so the UI and web server tasks only enqueue the work and continue immediately. The state of the last JOB_HISTORY jobs can be queried by their id.
+ */
+class QEMSJobQueue {
+
+  public:
+    enum Status { QUEUED, RUNNING, DONE, FAILED };
+
+    /**
+     * A single job with its current state.
+     */
+    struct Job {
+        uint32_t id = 0;                    // unique id of the job, 0 for unused entries
+        String name;                        // name for status reports
+        volatile Status status = QUEUED;    // current state
+        volatile uint8_t progress = 0;      // progress from 0 .. 100, maintained by the job itself
+        std::function<bool(Job &)> work;    // the work to execute, returns false on failure
+    };
+
+    QEMSJobQueue() {
+        _queue = xQueueCreate(JOB_HISTORY, sizeof(uint32_t));
+        _mutex = xSemaphoreCreateMutex();
+        xTaskCreatePinnedToCore(jobTaskCode, "jobTask", 8192, this, tskIDLE_PRIORITY + 1, NULL, tskNO_AFFINITY);
+    }
+
+    /**
+     * @brief adds a job to the queue.
+     * @param name the name of the job used in status reports
+     * @param work the function to execute
+     * @return the id of the job or 0 if the queue is full
+     */
+    uint32_t enqueue(String name, std::function<bool(Job &)> work) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+
+        Job &job = _jobs[_nextId % JOB_HISTORY];
+        if (job.id != 0 && (job.status == QUEUED || job.status == RUNNING)) { // all entries are occupied by pending jobs
+            xSemaphoreGive(_mutex);
+            Serial.printf("Job queue full, cannot enqueue [%s]\n", name.c_str());
+            return 0;
+        }
+
+        uint32_t id = _nextId++;
+        job.id = id;
+        job.name = name;
+        job.status = QUEUED;
+        job.progress = 0;
+        job.work = work;
+        _pending++;
+
+        xSemaphoreGive(_mutex);
+
+        xQueueSend(_queue, &id, portMAX_DELAY);
+        Serial.printf("Enqueued job %d [%s]\n", id, name.c_str());
+        return id;
+    }
+
+    /**
+     * @brief returns the state of the job with the passed id as JSON object or an empty String if the job is unknown.
+     */
+    String getJobStatus(uint32_t id) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+
+        String result = "";
+        Job &job = _jobs[id % JOB_HISTORY];
+        if (id != 0 && job.id == id) {
+            result = toJson(job);
+        }
+
+        xSemaphoreGive(_mutex);
+        return result;
+    }
+
+    /**
+     * @brief returns the state of all known jobs as JSON array.
+     */
+    String getJobsStatus() {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+
+        String result = "[";
+        for (uint32_t id = _nextId > JOB_HISTORY ? _nextId - JOB_HISTORY : 1; id < _nextId; id++) {
+            result += (result.length() > 1 ? String(",") : String("")) + toJson(_jobs[id % JOB_HISTORY]);
+        }
+        result += "]";
+
+        xSemaphoreGive(_mutex);
+        return result;
+    }
+
+    /**
+     * @brief returns true if a job is queued or running. A job is counted from its enqueue until it finished, also while the job task takes it from the
+     * queue.
+     */
+    bool isBusy() { return _pending > 0; }
+
+  private:
+    /**
+     * Task executing the queued jobs.
+     */
+    static void jobTaskCode(void *parameter) {
+        QEMSJobQueue *queue = (QEMSJobQueue *)parameter;
+        uint32_t id;
+
+        for (;;) {
+            if (xQueueReceive(queue->_queue, &id, portMAX_DELAY) == pdTRUE) {
+                queue->execute(id);
+            }
+        }
+    }
+
+    /**
+     * Executes the job with the passed id.
+     */
+    void execute(uint32_t id) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        Job &job = _jobs[id % JOB_HISTORY];
+        std::function<bool(Job &)> work = job.work;
+        String name = job.name;
+        job.status = RUNNING;
+        xSemaphoreGive(_mutex);
+
+        Serial.printf("Start job %d [%s]\n", id, name.c_str());
+        unsigned long start = millis();
+
+        bool result = work(job);
+
+        // the entry can be reused as soon as the status is final, so the job must not be accessed afterwards
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        job.work = nullptr;
+        job.progress = 100;
+        job.status = result ? DONE : FAILED;
+        _pending--;
+        xSemaphoreGive(_mutex);
+
+        Serial.printf("Finished job %d [%s] in %d ms, result = %d\n", id, name.c_str(), millis() - start, result);
+    }
+
+    /**
+     * Creates the JSON representation of a job.
+     */
+    String toJson(Job &job) {
+        static const char *statusNames[] = {"queued", "running", "done", "failed"};
+        return String("{\"id\":") + job.id + String(",\"name\":\"") + escape(job.name) + String("\",\"status\":\"") + statusNames[job.status] +
+               String("\",\"progress\":") + (int)job.progress + String("}");
+    }
+
+    /**
+     * Escapes a string for a JSON string value, the job names contain file names of uploads.
+     */
+    static String escape(const String &value) {
+        String result;
+        for (unsigned int i = 0; i < value.length(); i++) {
+            char c = value.charAt(i);
+            if (c == '"' || c == '\\') {
+                result += '\\';
+                result += c;
+            } else if ((uint8_t)c < 0x20) {
+                char code[7];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                result += code;
+            } else {
+                result += c;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * The ids of the jobs to execute.
+     */
+    QueueHandle_t _queue;
+
+    /**
+     * Protects the job table, which is accessed by the task enqueuing jobs, the job task and the tasks querying the state.
+     */
+    SemaphoreHandle_t _mutex;
+
+    /**
+     * The last JOB_HISTORY jobs, a job is stored at index id % JOB_HISTORY.
+     */
+    Job _jobs[JOB_HISTORY];
+
+    /**
+     * The id of the next job, ids start with 1.
+     */
+    uint32_t _nextId = 1;
+
+    /**
+     * Number of jobs enqueued and not finished yet.
+     */
+    volatile uint8_t _pending = 0;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef QEMS_LTTB_H_
+#define QEMS_LTTB_H_
+
+#include <Arduino.h>
+
+/**
+ * @brief Largest-Triangle-Three-Buckets downsampling of a series. The series is split into buckets and one point per bucket is kept: the point that forms the
+ * largest triangle with the point kept for the previous bucket and the average of the next bucket. Unlike averaging, this keeps the peaks of the series
+ * visible. The buckets are processed one after the other, so new buckets can be appended to an already downsampled series.
+ */
+class QEMSLttb {
+
+  public:
+    struct Point {
+        float x;
+        float y;
+    };
+
+    /**
+     * @brief returns the average of the passed points, used as the third corner of the triangles for the previous bucket.
+     */
+    static Point average(const Point *points, uint16_t count) {
+        Point average = {0, 0};
+        for (uint16_t i = 0; i < count; i++) {
+            average.x += points[i].x;
+            average.y += points[i].y;
+        }
+        return count > 0 ? Point{average.x / count, average.y / count} : average;
+    }
+
+    /**
+     * @brief selects the point of a bucket to keep.
+     * @param previous the point kept for the previous bucket
+     * @param points the points of the bucket, at least one
+     * @param count the number of points
+     * @param next the average of the next bucket
+     * @return the index of the point to keep
+     */
+    static uint16_t select(const Point &previous, const Point *points, uint16_t count, const Point &next) {
+        uint16_t selected = 0;
+        float maxArea = -1;
+
+        for (uint16_t i = 0; i < count; i++) {
+            // twice the area of the triangle, the factor does not change the order
+            float area = fabsf((previous.x - next.x) * (points[i].y - previous.y) - (previous.x - points[i].x) * (next.y - previous.y));
+            if (area > maxArea) {
+                maxArea = area;
+                selected = i;
+            }
+        }
+        return selected;
+    }
+};
+
+#endif
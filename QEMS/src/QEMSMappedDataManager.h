@@ -0,0 +1,851 @@
+#ifndef QEMS_MAPPED_DATA_MANAGER_H_
+#define QEMS_MAPPED_DATA_MANAGER_H_
+
+#include <LittleFS.h>
+#include <QEMSAggregates.h>
+#include <QEMSCsvParser.h>
+#include <QEMSDataSource.h>
+#include <QEMSFlashImage.h>
+#include <QEMSParallelParser.h>
+#include <QEMSRetention.h>
+#include <QEMSRunningTotals.h>
+#include <QEMSTimeManager.h>
+#include <esp_rom_crc.h>
+
+/**
+ * Marker of a completely written image slot.
+ */
+#define IMAGE_MAGIC 0x474D4951 // "QIMG"
+
+/**
+ * Number of entries a column is written or read with.
+ */
+#define IMAGE_CHUNK_SIZE 64
+
+/**
+ * @brief data manager that keeps all records of the data files in a raw flash partition instead of a RAM window. The records are converted into an image
+ * with one timestamp column and one fixed point value column per channel, the image is mapped through the flash cache and the values are read directly from
+ * the mapping. The partition holds two image slots, an update is written into the inactive slot while the display continues to read the active one. The
+ * readers of a slot are counted, so the slot of the previous image is only rebuilt after the last task reading it finished.
+ *
+ * The image stays valid across reboots, it is only rebuilt if the size or modification time of one of the data files changed.
+ */
+class QEMSMappedDataManager : public QEMSDataSource {
+
+    typedef uint16_t Value; // hundredth of a percent
+
+    /**
+     * Data source of a channel.
+     */
+    struct Channel {
+        String file;    // the file to load the data from
+        uint8_t column; // the value column in the file, starting with 1
+    };
+
+    /**
+     * Header at the beginning of an image slot, followed by capacity timestamps and capacity values per channel. The header is written last, so a slot
+     * is only used if it was written completely.
+     */
+    struct Header {
+        uint32_t magic;    // IMAGE_MAGIC
+        uint32_t sequence; // incremented for every image, the slot with the highest sequence is active
+        uint32_t source;   // checksum over size and modification time of the data files
+        uint32_t count;    // number of records
+        uint32_t capacity; // number of entries per column
+        uint32_t channels; // number of value columns
+    };
+
+    /**
+     * @brief sequential writer for a column of an image slot.
+     */
+    class ColumnWriter {
+
+      public:
+        void begin(QEMSFlashImage *image, size_t offset, size_t entrySize) {
+            _image = image;
+            _offset = offset;
+            _entrySize = entrySize;
+            _fill = 0;
+        }
+
+        bool put(const void *entry) {
+            memcpy(_buffer + _fill, entry, _entrySize);
+            _fill += _entrySize;
+            return _fill < sizeof(_buffer) || flush();
+        }
+
+        bool flush() {
+            bool written = _fill == 0 || _image->write(_offset, _buffer, _fill);
+            _offset += _fill;
+            _fill = 0;
+            return written;
+        }
+
+      private:
+        QEMSFlashImage *_image = nullptr;
+        size_t _offset = 0;
+        size_t _entrySize = 0;
+        size_t _fill = 0;
+        uint8_t _buffer[IMAGE_CHUNK_SIZE * sizeof(uint32_t)];
+    };
+
+  public:
+    QEMSMappedDataManager(QEMSTimeManager *timeManager) : _timeManager(timeManager) {
+        if (_image.begin()) {
+            _slotSize = _image.size() / 2 / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+        }
+    }
+
+    uint8_t addChannel(String dataFile, uint8_t column = 1) override {
+        if (_channelCount >= MAX_CHANNELS || _active) {
+            Serial.printf("Cannot add channel [%s]\n", dataFile.c_str());
+            return _channelCount - 1;
+        }
+
+        _channels[_channelCount] = {dataFile, column};
+
+        bool available = true;
+        for (uint8_t c = 0; c <= _channelCount; c++) {
+            File f = LittleFS.open(_channels[c].file);
+            if (f) {
+                f.close();
+            } else {
+                available = false;
+            }
+        }
+        _fileAvailable = available;
+
+        return _channelCount++;
+    }
+
+    uint8_t getChannelCount() override { return _channelCount; }
+
+    String getFileName(uint8_t channel) override { return _channels[channel].file; }
+
+    bool usesFile(String file) override {
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            if (_channels[c].file == file) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool getActiveValues(int *values, time_t *validUntil = nullptr) override {
+        clearChange();
+        time_t now = _timeManager->now();
+        uint32_t generation = getGeneration(); // read before the image, it is incremented after the image was switched
+        uint8_t slot;
+        const Header *header = acquireImage(slot); // the image may be switched by an update from another task
+
+        if (header) {
+            const uint32_t *times = getTimes(header);
+            const Value *columns = (const Value *)(times + header->capacity);
+
+            // first record in the future, the record at index 0 is never used
+            uint32_t index = max(findNext(header, now), (uint32_t)1);
+
+            if (index < header->count) {
+                for (uint8_t c = 0; c < _channelCount; c++) {
+                    values[c] = columns[c * header->capacity + index] * 100 / QEMSFixedPoint<Value>::SCALE;
+                }
+
+                advanceTotals(header, generation, now, index);
+
+                // the values change when the active record is reached
+                setValidity(_timeManager->toRealMillis(times[index] - now));
+                if (validUntil) {
+                    *validUntil = times[index];
+                }
+                releaseImage(slot);
+                return true;
+            }
+        }
+        releaseImage(slot);
+
+        Serial.println("No data available");
+        _ready = false;
+        setValidity(0);
+        if (validUntil) {
+            *validUntil = 0;
+        }
+
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            values[c] = 0;
+        }
+        return false;
+    }
+
+    bool sampleValues(int64_t timeMs, float *values) override {
+        uint8_t slot;
+        const Header *header = acquireImage(slot); // the image may be switched by an update from another task
+
+        if (header) {
+            const uint32_t *times = getTimes(header);
+            const Value *columns = (const Value *)(times + header->capacity);
+
+            // the time is between the previous and the next record
+            uint32_t index = findNext(header, timeMs / 1000);
+
+            if (index > 0 && index < header->count) {
+                int64_t from = (int64_t)times[index - 1] * 1000;
+                float fraction = (float)(timeMs - from) / ((int64_t)times[index] * 1000 - from);
+
+                for (uint8_t c = 0; c < _channelCount; c++) {
+                    int previous = columns[c * header->capacity + index - 1];
+                    int next = columns[c * header->capacity + index];
+                    values[c] = (previous + (next - previous) * fraction) * 100 / QEMSFixedPoint<Value>::SCALE;
+                }
+                releaseImage(slot);
+                return true;
+            }
+        }
+        releaseImage(slot);
+
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            values[c] = 0;
+        }
+        return false;
+    }
+
+    time_t getNextChange(time_t time) override {
+        uint8_t slot;
+        const Header *header = acquireImage(slot);
+        time_t next = 0;
+        if (header) {
+            uint32_t index = max(findNext(header, time), (uint32_t)1);
+            next = index < header->count ? getTimes(header)[index] : 0;
+        }
+        releaseImage(slot);
+        return next;
+    }
+
+    uint16_t getRecords(uint8_t channel, time_t from, time_t to, time_t *times, float *values, uint16_t maxCount) override {
+        uint8_t slot;
+        const Header *header = acquireImage(slot); // the image may be switched by an update from another task
+        uint16_t count = 0;
+
+        if (header) {
+            const uint32_t *records = getTimes(header);
+            const Value *column = (const Value *)(records + header->capacity) + channel * header->capacity;
+
+            for (uint32_t index = findNext(header, from - 1); index < header->count && (time_t)records[index] < to && count < maxCount; index++) {
+                times[count] = records[index];
+                values[count++] = column[index] * 100.0f / QEMSFixedPoint<Value>::SCALE;
+            }
+        }
+        releaseImage(slot);
+        return count;
+    }
+
+    bool getRunningTotals(uint8_t channel, QEMSAggregate &today, QEMSAggregate &week) override {
+        return channel < _channelCount && _totals.get(channel, _timeManager->now(), today, week);
+    }
+
+    bool restartTotals() override {
+        time_t now = _timeManager->now();
+        uint32_t jumps = _timeManager->getJumps();
+        uint32_t generation = getGeneration(); // read before the image, it is incremented after the image was switched
+
+        xSemaphoreTake(_totalsMutex, portMAX_DELAY);
+        bool current = _totalsStarted && generation == _totalsGeneration && jumps == _totalsJumps && now >= _totals.getTime();
+        _totalsStarted = current;
+        xSemaphoreGive(_totalsMutex);
+        if (current || !_ready) {
+            return false;
+        }
+
+        uint8_t slot;
+        const Header *header = acquireImage(slot);
+        if (!header) {
+            releaseImage(slot);
+            return false;
+        }
+
+        // the aggregates are read without the mutex, getActiveValues() skips the totals meanwhile
+        time_t until = _totals.restart(this, now);
+
+        xSemaphoreTake(_totalsMutex, portMAX_DELAY);
+        _totalsCursor = max(findNext(header, until - 1), (uint32_t)1);
+        _totalsGeneration = generation;
+        _totalsJumps = jumps;
+        _totalsStarted = true;
+        xSemaphoreGive(_totalsMutex);
+        releaseImage(slot);
+        return true;
+    }
+
+    bool getAggregate(uint8_t channel, time_t from, time_t to, QEMSAggregate &result) override {
+        return QEMSAggregates::query(_channels[channel].file, getFilePosition(channel), from, to, result);
+    }
+
+    bool isFileAvailable() override { return _fileAvailable; }
+
+    void loadDataFromFile() override {
+
+        // If we already load data, we do not need to do anything here.
+        if (xSemaphoreTake(_loadMutex, 0) != pdTRUE) {
+            return;
+        }
+
+        _ready = false;
+
+        // the image is only rebuilt if the data files changed, all records of the files are already available otherwise
+        uint32_t source = getSourceChecksum("", "");
+        if (!_active || _active->source != source) {
+            if (!mapExistingImage()) {
+                uint8_t slot = getStagingSlot();
+                if (buildImage(slot, false, "", "")) {
+                    activateSlot(slot);
+                }
+            }
+        }
+
+        // check if we have enough data loaded, an image of data files that were deleted or changed since is not used
+        _fileAvailable = _active && _active->source == source;
+        _ready = _fileAvailable && _active->count - findNext(_active, _timeManager->now()) >= MIN_RECORD_CNT;
+        notifyChange();
+
+        xSemaphoreGive(_loadMutex);
+    }
+
+    bool prepareUpdate(String file, String replacement) override {
+
+        // wait for a running load, it would use the staging slot as well. The mutex is held until the update is committed or discarded.
+        xSemaphoreTake(_loadMutex, portMAX_DELAY);
+
+        if (!buildImage(getStagingSlot(), true, file, replacement)) {
+            Serial.printf("Rejected data file [%s]\n", replacement.c_str());
+            xSemaphoreGive(_loadMutex);
+            return false;
+        }
+
+        return true;
+    }
+
+    void commitUpdate() override {
+        activateSlot(getStagingSlot());
+        _fileAvailable = true;
+        _ready = true;
+        notifyChange();
+        xSemaphoreGive(_loadMutex);
+    }
+
+    void discardUpdate() override {
+        // the staged image must not be used after a reboot
+        uint8_t slot = getStagingSlot();
+        unmapSlot(slot);
+        _image.erase(slot * _slotSize, FLASH_SECTOR_SIZE);
+        xSemaphoreGive(_loadMutex);
+    }
+
+    /**
+     * The image holds the complete data files, appending would rebuild it, so records are only added by uploading the data file.
+     */
+    bool appendRecords(uint8_t channel, String &records) override {
+        Serial.println("Appending records is not supported for memory mapped data files");
+        return false;
+    }
+
+    bool compactSegment(uint8_t channel) override { return false; }
+
+    bool dropHistory(time_t before) override {
+        xSemaphoreTake(_loadMutex, portMAX_DELAY);
+
+        bool dropped = false;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            size_t size;
+            uint32_t crc;
+            if (QEMSRetention::dropRecords(_channels[c].file, before, size, crc)) {
+                notifyFileWritten(_channels[c].file, size, crc);
+                dropped = true;
+            }
+        }
+
+        // the image of the shortened data files is rebuilt even if the clock passed most of the records, the previous image shows the dropped records
+        bool reloaded = !dropped || reloadChangedFiles();
+        xSemaphoreGive(_loadMutex);
+        return reloaded;
+    }
+
+    bool isReady() override { return _ready && _fileAvailable; }
+
+  private:
+    /**
+     * If the data manager is ready to provide data.
+     */
+    bool _ready = false;
+
+    /**
+     * Held while the data is loaded or an update is prepared until it is committed or discarded, needed to avoid multiple imports at once when the methods are
+     * called from different CPU cores
+     */
+    SemaphoreHandle_t _loadMutex = xSemaphoreCreateMutex();
+
+    /**
+     * If the files of all channels were found in the file system.
+     */
+    bool _fileAvailable = false;
+
+    /**
+     * The channels to load.
+     */
+    Channel _channels[MAX_CHANNELS];
+
+    uint8_t _channelCount = 0;
+
+    /**
+     * @brief provides access to the current time
+     */
+    QEMSTimeManager *_timeManager;
+
+    /**
+     * @brief aggregates of today and the current week, restarted by restartTotals() and advanced by getActiveValues(). The cursor is the first record of the
+     * image that was not added yet, it is only valid for the image of the generation and clock jumps it was set for. The mutex protects the cursor and its
+     * state, it is not held while the aggregates are read.
+     */
+    QEMSRunningTotals _totals;
+    uint32_t _totalsCursor = 0;
+    uint32_t _totalsGeneration = 0;
+    uint32_t _totalsJumps = 0;
+    bool _totalsStarted = false;
+    SemaphoreHandle_t _totalsMutex = xSemaphoreCreateMutex();
+
+    /**
+     * @brief the partition with the two image slots.
+     */
+    QEMSFlashImage _image;
+
+    /**
+     * Size of an image slot, 0 if there is no partition for the image.
+     */
+    size_t _slotSize = 0;
+
+    /**
+     * @brief the mappings of the slots, a slot is mapped once it was written completely.
+     */
+    QEMSFlashImage::Mapping _mappings[2];
+
+    /**
+     * @brief header of the image the values are provided from, nullptr if no image is available.
+     */
+    const Header *volatile _active = nullptr;
+
+    uint8_t _activeSlot = 0;
+
+    /**
+     * Number of readers of each slot, see acquireImage(). A slot is only unmapped or overwritten without readers, a reader may still use the previous
+     * image after an update switched to the other slot.
+     */
+    uint8_t _readers[2] = {0, 0};
+
+    /**
+     * Protects the active slot and the reader counts.
+     */
+    SemaphoreHandle_t _readMutex = xSemaphoreCreateMutex();
+
+    /**
+     * Sequence of the newest image.
+     */
+    uint32_t _sequence = 0;
+
+    /**
+     * @brief returns the slot that is currently not used to provide values.
+     */
+    uint8_t getStagingSlot() { return _active ? 1 - _activeSlot : 0; }
+
+    static const uint32_t *getTimes(const Header *header) { return (const uint32_t *)(header + 1); }
+
+    /**
+     * @brief adds the records the clock passed since the last call to the running totals, so every record is added once. If the image or the clock changed
+     * in between, no records are added until the data task restarted the totals, see restartTotals().
+     * @param header the active image
+     * @param generation the generation of the image
+     * @param now the current time
+     * @param index the first record in the future
+     */
+    void advanceTotals(const Header *header, uint32_t generation, time_t now, uint32_t index) {
+        xSemaphoreTake(_totalsMutex, portMAX_DELAY);
+        if (_totalsStarted && generation == _totalsGeneration && _timeManager->getJumps() == _totalsJumps && now >= _totals.getTime()) {
+            const uint32_t *times = getTimes(header);
+            const Value *columns = (const Value *)(times + header->capacity);
+            float values[MAX_CHANNELS];
+            for (; _totalsCursor < index; _totalsCursor++) {
+                for (uint8_t c = 0; c < _channelCount; c++) {
+                    values[c] = columns[c * header->capacity + _totalsCursor] * 100.0f / QEMSFixedPoint<Value>::SCALE;
+                }
+                _totals.add(times[_totalsCursor], values);
+            }
+        }
+        xSemaphoreGive(_totalsMutex);
+    }
+
+    /**
+     * @brief returns the index of the first record with a timestamp after the passed time or the number of records if there is none.
+     */
+    static uint32_t findNext(const Header *header, time_t time) {
+        const uint32_t *times = getTimes(header);
+        uint32_t lo = 0;
+        uint32_t hi = header->count;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if ((time_t)times[mid] > time) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        return lo;
+    }
+
+    /**
+     * @brief returns the active image and registers the caller as reader of its slot, releaseImage() has to be called when the image is not accessed any
+     * longer.
+     * @param slot receives the slot to release
+     * @return the header of the image, nullptr if no image is available
+     */
+    const Header *acquireImage(uint8_t &slot) {
+        xSemaphoreTake(_readMutex, portMAX_DELAY);
+        const Header *header = _active;
+        slot = _activeSlot;
+        _readers[slot]++;
+        xSemaphoreGive(_readMutex);
+        return header;
+    }
+
+    void releaseImage(uint8_t slot) {
+        xSemaphoreTake(_readMutex, portMAX_DELAY);
+        _readers[slot]--;
+        xSemaphoreGive(_readMutex);
+    }
+
+    void activateSlot(uint8_t slot) {
+        xSemaphoreTake(_readMutex, portMAX_DELAY);
+        _activeSlot = slot;
+        _active = (const Header *)_mappings[slot].data;
+        _sequence = _active->sequence;
+        xSemaphoreGive(_readMutex);
+    }
+
+    /**
+     * @brief releases the mapping of a slot that is not active, after the readers that acquired it before it was switched away from are done.
+     */
+    void unmapSlot(uint8_t slot) {
+        for (;;) {
+            xSemaphoreTake(_readMutex, portMAX_DELAY);
+            bool used = _readers[slot] > 0;
+            xSemaphoreGive(_readMutex);
+            if (!used) {
+                break;
+            }
+            delay(1);
+        }
+        _image.unmap(_mappings[slot]);
+    }
+
+    /**
+     * @brief maps the newest image that was built from the current data files, e.g. after a reboot.
+     */
+    bool mapExistingImage() {
+        uint32_t source = getSourceChecksum("", "");
+        int found = -1;
+
+        for (uint8_t slot = 0; slot < 2 && _slotSize > 0; slot++) {
+            Header header;
+            if (_image.read(slot * _slotSize, &header, sizeof(header)) && header.magic == IMAGE_MAGIC) {
+                _sequence = max(_sequence, header.sequence);
+
+                if (header.source == source && header.channels == _channelCount && (found < 0 || header.sequence == _sequence) && mapSlot(slot)) {
+                    found = slot;
+                }
+            }
+        }
+
+        if (found >= 0) {
+            Serial.printf("Mapped existing image from slot %d\n", found);
+            activateSlot(found);
+        }
+        return found >= 0;
+    }
+
+    bool mapSlot(uint8_t slot) {
+        unmapSlot(slot);
+        return _image.map(slot * _slotSize, _slotSize, _mappings[slot]);
+    }
+
+    /**
+     * @brief calculates the checksum over size and modification time of the data files, used to detect an outdated image.
+     */
+    uint32_t getSourceChecksum(String replacedFile, String replacement) {
+        uint32_t crc = 0;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            File f = LittleFS.open(_channels[c].file == replacedFile ? replacement : _channels[c].file);
+            uint32_t stamp[2] = {f ? (uint32_t)f.size() : 0, f ? (uint32_t)f.getLastWrite() : 0};
+            crc = esp_rom_crc32_le(crc, (const uint8_t *)stamp, sizeof(stamp));
+            f.close();
+        }
+        return crc;
+    }
+
+    /**
+     * @brief rebuilds the image after data files were changed in place, e.g. by dropping records. The previous image is outdated, so unlike an update the
+     * new image is activated even if there are fewer than MIN_RECORD_CNT future records, the data source is then not ready like after loadDataFromFile().
+     * Called with the load mutex held.
+     * @return false if the changed files are invalid
+     */
+    bool reloadChangedFiles() {
+        // the validating build recreates the aggregates of the changed files, files it rejects are loaded like after a reboot
+        uint8_t slot = getStagingSlot();
+        bool valid = buildImage(slot, true, "", "", false);
+        if (valid || buildImage(slot, false, "", "", false)) {
+            activateSlot(slot);
+        }
+
+        _fileAvailable = _active && _active->source == getSourceChecksum("", "");
+        _ready = _fileAvailable && _active->count - findNext(_active, _timeManager->now()) >= MIN_RECORD_CNT;
+        notifyChange();
+        return valid;
+    }
+
+    /**
+     * @brief converts the data files into an image and maps it. The files are read in the order of the channels, the first file defines the time axis and
+     * the records of the other files are merged into it.
+     * @param slot the slot to write the image to
+     * @param strict if true, the loading fails for lines which do not match the expected format
+     * @param replacedFile a data file that is replaced by an upload
+     * @param replacement the file to read instead of replacedFile
+     * @param future if true, the image is only kept with MIN_RECORD_CNT records in the future
+     * @return true if all channels have values for at least MIN_RECORD_CNT records in the future, or for any record if future is false
+     */
+    bool buildImage(uint8_t slot, bool strict, String replacedFile, String replacement, bool future = true) {
+        if (_slotSize == 0) {
+            return false;
+        }
+
+        unsigned long start = millis();
+        size_t base = slot * _slotSize;
+        unmapSlot(slot);
+
+        // the first file limits the number of records, every record has at least 21 characters and a line break
+        File first = LittleFS.open(_channels[0].file == replacedFile ? replacement : _channels[0].file);
+        size_t recordSize = sizeof(uint32_t) + _channelCount * sizeof(Value);
+        Header header = {0, _sequence + 1, getSourceChecksum(replacedFile, replacement), 0, 0, _channelCount};
+        header.capacity = min((_slotSize - sizeof(Header)) / recordSize, (first ? first.size() : 0) / 22 + 1);
+        first.close();
+
+        // only the used part of the slot is erased
+        size_t length = (sizeof(Header) + header.capacity * recordSize + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+        if (!_image.erase(base, length)) {
+            Serial.println("Cannot erase image slot");
+            return false;
+        }
+
+        for (uint8_t c = 0; c < _channelCount; c++) {
+
+            // channels of a multi column file are loaded together with the first channel of the file
+            bool loaded = false;
+            for (uint8_t p = 0; p < c; p++) {
+                loaded = loaded || _channels[p].file == _channels[c].file;
+            }
+
+            if (loaded) {
+                continue;
+            }
+
+            String path = _channels[c].file == replacedFile ? replacement : _channels[c].file;
+            if (!parseFile(path, _channels[c].file, base, header, strict, c == 0)) {
+                return false;
+            }
+        }
+
+        header.magic = IMAGE_MAGIC;
+        if (!_image.write(base, &header, sizeof(header)) || !mapSlot(slot)) {
+            Serial.println("Cannot write image");
+            return false;
+        }
+
+        const Header *mapped = (const Header *)_mappings[slot].data;
+        uint32_t records = mapped->count - findNext(mapped, _timeManager->now());
+        Serial.printf("Created image in slot %d with %d records, %d in the future, in %lu ms\n", slot, mapped->count, records, millis() - start);
+
+        if (future ? records < MIN_RECORD_CNT : mapped->count == 0) {
+            unmapSlot(slot);
+            _image.erase(base, FLASH_SECTOR_SIZE);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief parses a CSV data file and writes the values of all channels loaded from it to the image.
+     * @param path the file to parse
+     * @param channelFile the data file of the channels to fill
+     * @param base the offset of the image slot
+     * @param header the header of the image, the number of records is updated
+     * @param strict if true, the parsing fails for lines which do not match the format "dd.mm.yyyy HH:MM:SS;value[;value...]"
+     * @param createAxis if true, the records of the file define the time axis of the image; otherwise each record of the time axis gets the values of the
+     * first record in the file that is not older
+     * @return false if the file cannot be opened or is invalid
+     */
+    bool parseFile(String path, String channelFile, size_t base, Header &header, bool strict, bool createAxis) {
+
+        File dataFile = LittleFS.open(path);
+
+        if (!dataFile) {
+            Serial.println("Could not open data file, skip processing...");
+            return false;
+        } else {
+            Serial.printf("Opened data file [%s], process data...\n", path.c_str());
+        }
+
+        size_t timeOffset = base + sizeof(Header);
+        size_t valueOffset = timeOffset + header.capacity * sizeof(uint32_t);
+
+        ColumnWriter times;
+        times.begin(&_image, timeOffset, sizeof(uint32_t));
+
+        ColumnWriter columns[MAX_CHANNELS];
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            columns[c].begin(&_image, valueOffset + c * header.capacity * sizeof(Value), sizeof(Value));
+        }
+
+        // timestamps of the time axis, read back in chunks when the file is merged
+        uint32_t axis[IMAGE_CHUNK_SIZE];
+        uint32_t recordPointer = 0;
+
+        // the file is read completely, so the aggregates are created along with the image
+        QEMSAggregates aggregates;
+        bool aggregating = aggregates.begin(path, dataFile.size(), getFileChannelCount(channelFile));
+        bool complete = true;
+
+        // timestamps and values are parsed concurrently, the records are processed in file order
+        QEMSParallelParser parser(dataFile, [this, channelFile](QEMSParallelParser::Line &line) {
+            line.timed = QEMSCsvParser::parseTime(line.text, line.time);
+            line.valid = parseFileValues(line.text, channelFile, line.values);
+        });
+
+        QEMSParallelParser::Line *parsed;
+        bool valid = true;
+        time_t lastTime = 0;
+        uint32_t line = 0;
+        while (valid && (parsed = parser.next())) {
+
+            String &r = parsed->text;
+            line++;
+
+            if (r.length() == 0) { // ignore empty lines, e.g. at the end of the file
+                continue;
+            }
+
+            time_t epoch_ts = parsed->time;
+            bool timed = (!strict || (r.length() >= 21 && r.charAt(19) == ';')) && parsed->timed;
+
+            // the records are searched by time, so they have to be sorted
+            if (!timed || epoch_ts < lastTime) {
+                if (strict) {
+                    Serial.printf("Invalid record in line %d: [%s]\n", line, r.c_str());
+                    valid = false;
+                }
+                continue;
+            }
+            lastTime = epoch_ts;
+
+            if (aggregating) {
+                aggregates.add(epoch_ts, parsed->values);
+            }
+
+            if (createAxis) {
+                if (header.count >= header.capacity) {
+                    complete = false;
+                    break;
+                }
+
+                uint32_t time = epoch_ts;
+                valid = times.put(&time) && storeValues(*parsed, channelFile, columns, strict, line);
+                header.count++;
+            } else {
+                while (valid && recordPointer < header.count) {
+                    if (recordPointer % IMAGE_CHUNK_SIZE == 0) {
+                        valid = _image.read(timeOffset + recordPointer * sizeof(uint32_t), axis,
+                                            min((uint32_t)IMAGE_CHUNK_SIZE, header.count - recordPointer) * sizeof(uint32_t));
+                    }
+
+                    if ((time_t)axis[recordPointer % IMAGE_CHUNK_SIZE] > epoch_ts) {
+                        break;
+                    }
+
+                    valid = valid && storeValues(*parsed, channelFile, columns, strict, line);
+                    recordPointer++;
+                }
+            }
+        }
+
+        dataFile.close();
+
+        if (aggregating) {
+            aggregates.end(valid && complete);
+        }
+
+        valid = valid && times.flush();
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            valid = valid && columns[c].flush();
+        }
+
+        // the time axis is limited to the records all channels have values for
+        if (valid && !createAxis && recordPointer < header.count) {
+            Serial.printf("Data file [%s] provides values only for %d of %d records\n", path.c_str(), recordPointer, header.count);
+            header.count = recordPointer;
+        }
+
+        return valid;
+    }
+
+    /**
+     * @brief returns the number of channels loaded from the passed file.
+     */
+    uint8_t getFileChannelCount(String channelFile) {
+        uint8_t count = 0;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            count += _channels[c].file == channelFile;
+        }
+        return count;
+    }
+
+    /**
+     * @brief parses the values of all channels loaded from the passed file in hundredth of a percent, the fixed point format of the image.
+     * @return false if one of the values is missing or not a number
+     */
+    bool parseFileValues(String &r, String channelFile, uint16_t *values) {
+        bool valid = true;
+        uint8_t position = 0;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            int value = 0;
+            if (_channels[c].file == channelFile) {
+                valid = QEMSCsvParser::parseValue(r, _channels[c].column, QEMSFixedPoint<uint16_t>::SCALE, value) && valid;
+                values[position++] = value;
+            }
+        }
+        return valid;
+    }
+
+    /**
+     * @brief writes the parsed values of all channels loaded from the passed file.
+     * @return false if writing failed or, in strict mode, one of the values is missing or not a number
+     */
+    bool storeValues(QEMSParallelParser::Line &parsed, String channelFile, ColumnWriter *columns, bool strict, uint32_t line) {
+        if (!parsed.valid && strict) {
+            Serial.printf("Invalid value in line %d: [%s]\n", line, parsed.text.c_str());
+            return false;
+        }
+
+        uint8_t position = 0;
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            if (_channels[c].file == channelFile && !columns[c].put(&parsed.values[position++])) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,348 @@
+#ifndef QEMS_PARALLEL_PARSER_H_
+#define QEMS_PARALLEL_PARSER_H_
+
+#include <LittleFS.h>
+#include <QEMSDataSource.h>
+#include <functional>
+
+/**
+ * Number of bytes of a data file in a range, the ranges are assigned to the workers in turn.
+ */
+#define PARSER_CHUNK_SIZE 8192
+
+/**
+ * Maximum length of a line, the last line of a range is read up to this length beyond the end of the range. Longer lines are cut.
+ */
+#define PARSER_MAX_LINE 256
+
+/**
+ * Number of lines a worker parses before handing them over, a worker holds up to two batches.
+ */
+#define PARSER_BATCH_LINES 128
+
+/**
+ * Number of workers parsing the ranges of a file concurrently, the ESP32 has two cores. Can be set as build flag, e.g. -DPARSER_WORKERS=1 to parse
+ * sequentially.
+ */
+#ifndef PARSER_WORKERS
+#define PARSER_WORKERS 2
+#endif
+
+#define PARSER_MAX_WORKERS 8
+
+/**
+ * @brief splits a CSV data file into byte ranges aligned on lines and parses them concurrently. The ranges are assigned to the workers in turn, every worker
+ * reads its ranges with its own file handle: a range starts with the first line starting in it and ends with the last line starting in it, which is read
+ * beyond the end of the range. The workers are tasks created by every parser and ended by its destructor, they are not kept between files: a file is only
+ * parsed in full on the first load, the validation of an upload and the build of an image, so the stacks are only allocated while a file is parsed. The
+ * calling task is the first worker and parses its ranges when they are needed. The parsed lines are returned in file order, so the caller processes them
+ * sequentially as if it had parsed them itself.
+ *
+ * Parsing competes with the UI for the CPU, so the worker tasks pause while setBackoff() is set, e.g. while an animation is running, unless the caller is
+ * waiting for their lines. On the ESP32 the tasks are spread over both cores, on the host they are threads.
+ */
+class QEMSParallelParser {
+
+  public:
+    /**
+     * @brief a line of the file and the result of parsing it.
+     */
+    struct Line {
+        String text;                   // the trimmed line
+        uint32_t offset;               // byte offset of the line in the file
+        time_t time;                   // the timestamp, if timed
+        bool timed;                    // if the line starts with a valid timestamp
+        bool valid;                    // if all values were parsed successfully
+        uint16_t values[MAX_CHANNELS]; // the values in hundredth of a percent
+    };
+
+    /**
+     * Parses the text of a line into the other fields, called concurrently for different lines.
+     */
+    typedef std::function<void(Line &line)> Parser;
+
+    /**
+     * @brief creates a parser reading from the current position of the file and creates its worker tasks.
+     * @param file the data file
+     * @param parser the function parsing a single line
+     * @param workers the number of concurrent workers, at most PARSER_MAX_WORKERS. No task is created for ranges beyond the end of the file.
+     */
+    QEMSParallelParser(File &file, Parser parser, uint8_t workers = PARSER_WORKERS) : _parser(parser) {
+        _start = file.position();
+        _size = file.size();
+        _finished = xSemaphoreCreateCounting(PARSER_MAX_WORKERS, 0);
+
+        begin(_workers[0], 0, &file);
+        for (uint8_t w = 1; w < constrain(workers, 1, PARSER_MAX_WORKERS) && _start + w * PARSER_CHUNK_SIZE < _size; w++) {
+            Worker &worker = _workers[w];
+            _files[w] = LittleFS.open(file.path());
+            begin(worker, w, &_files[w]);
+            if (!_files[w] ||
+                xTaskCreatePinnedToCore(workerTask, "parser", 4096, &worker, 1, NULL, (xPortGetCoreID() + w) % portNUM_PROCESSORS) != pdPASS) {
+                end(worker);
+                break;
+            }
+            _workerCount++;
+        }
+
+        // the ranges depend on the number of workers, so the tasks start parsing once all are created
+        for (uint8_t w = 1; w < _workerCount; w++) {
+            xSemaphoreGive(_workers[w].empty);
+            xSemaphoreGive(_workers[w].empty);
+        }
+    }
+
+    ~QEMSParallelParser() {
+        _stop = true;
+        for (uint8_t w = 1; w < _workerCount; w++) {
+            xSemaphoreGive(_workers[w].empty);
+        }
+        for (uint8_t w = 1; w < _workerCount; w++) {
+            xSemaphoreTake(_finished, portMAX_DELAY);
+        }
+
+        for (uint8_t w = 0; w < _workerCount; w++) {
+            end(_workers[w]);
+        }
+        vSemaphoreDelete(_finished);
+    }
+
+    /**
+     * @brief returns the next parsed line of the file, the parser is not called for empty lines.
+     * @return nullptr at the end of the file
+     */
+    Line *next() {
+        while (!_batch || _next >= _batch->count) {
+            if (!nextBatch()) {
+                return nullptr;
+            }
+        }
+        return &_batch->lines[_next++];
+    }
+
+    /**
+     * @brief pauses the worker tasks while set, the calling task keeps parsing its ranges and the lines it waits for.
+     */
+    static void setBackoff(bool backoff) { getBackoff() = backoff; }
+
+  private:
+    /**
+     * Lines of a range parsed by a worker.
+     */
+    struct Batch {
+        Line *lines;
+        uint16_t count;
+        bool last; // if the range ends with the batch
+        bool eof;  // if the range is beyond the end of the file, the batch has no lines
+    };
+
+    struct Worker {
+        QEMSParallelParser *parser;
+        File *file;
+        uint32_t range; // the index of the current range
+        bool loaded;    // if the current range is in the buffer
+
+        /**
+         * The current range and the lines before and after it that are needed to align it on lines.
+         */
+        char *buffer;
+        uint32_t offset; // of the buffer in the file
+        size_t length;
+        size_t end;      // of the range in the buffer, lines starting from here belong to the next range
+        size_t position; // of the next line in the buffer
+
+        /**
+         * The batches are passed to the calling task in turn, the calling task parses its batch itself.
+         */
+        Batch batches[2];
+        uint8_t produced = 0;
+        uint8_t consumed = 0;
+        SemaphoreHandle_t empty = nullptr; // given for every batch the calling task has processed
+        SemaphoreHandle_t ready = nullptr; // given for every batch parsed
+        volatile bool waiting = false;     // if the calling task waits for the next batch
+    };
+
+    Parser _parser;
+
+    uint32_t _start;
+    uint32_t _size;
+
+    Worker _workers[PARSER_MAX_WORKERS];
+    File _files[PARSER_MAX_WORKERS]; // of the worker tasks
+    uint8_t _workerCount = 1;
+
+    /**
+     * The batch of the current range and the next line of it.
+     */
+    uint8_t _current = 0;
+    Batch *_batch = nullptr;
+    uint16_t _next = 0;
+    bool _eof = false;
+
+    volatile bool _stop = false;
+
+    /**
+     * Given by every worker task when it ends.
+     */
+    SemaphoreHandle_t _finished;
+
+    static volatile bool &getBackoff() {
+        static volatile bool backoff = false;
+        return backoff;
+    }
+
+    void begin(Worker &worker, uint8_t index, File *file) {
+        worker.parser = this;
+        worker.file = file;
+        worker.range = index;
+        worker.loaded = false;
+        worker.buffer = (char *)malloc(1 + PARSER_CHUNK_SIZE + PARSER_MAX_LINE + 1);
+        for (uint8_t b = 0; b < (index > 0 ? 2 : 1); b++) {
+            worker.batches[b].lines = new Line[PARSER_BATCH_LINES];
+        }
+        if (index > 0) {
+            worker.empty = xSemaphoreCreateCounting(2, 0);
+            worker.ready = xSemaphoreCreateCounting(2, 0);
+        }
+    }
+
+    void end(Worker &worker) {
+        free(worker.buffer);
+        for (uint8_t b = 0; b < (worker.empty ? 2 : 1); b++) {
+            delete[] worker.batches[b].lines;
+        }
+        if (worker.empty) {
+            vSemaphoreDelete(worker.empty);
+            vSemaphoreDelete(worker.ready);
+            worker.file->close();
+        }
+    }
+
+    static void workerTask(void *parameter) {
+        Worker &worker = *(Worker *)parameter;
+        QEMSParallelParser &parser = *worker.parser;
+
+        bool eof = false;
+        while (!eof && xSemaphoreTake(worker.empty, portMAX_DELAY) == pdTRUE && !parser._stop) {
+            while (getBackoff() && !worker.waiting && !parser._stop) {
+                delay(10);
+            }
+
+            Batch &batch = worker.batches[worker.produced];
+            worker.produced = (worker.produced + 1) % 2;
+            parser.parseBatch(worker, batch);
+            eof = batch.eof;
+            xSemaphoreGive(worker.ready);
+        }
+
+        xSemaphoreGive(parser._finished);
+        vTaskDelete(NULL);
+    }
+
+    /**
+     * @brief releases the processed batch and gets the next one, from the worker of the next range if the current range ends with the batch.
+     * @return false at the end of the file
+     */
+    bool nextBatch() {
+        if (_batch) {
+            // the flags are read before the batch is passed back to its worker
+            bool last = _batch->last;
+            _eof = _batch->eof;
+            if (_current > 0) {
+                Worker &worker = _workers[_current];
+                worker.consumed = (worker.consumed + 1) % 2;
+                xSemaphoreGive(worker.empty);
+            }
+            if (last) {
+                _current = (_current + 1) % _workerCount;
+            }
+            _batch = nullptr;
+        }
+        if (_eof) {
+            return false;
+        }
+
+        Worker &worker = _workers[_current];
+        if (_current == 0) {
+            parseBatch(worker, worker.batches[0]);
+            _batch = &worker.batches[0];
+        } else {
+            worker.waiting = true;
+            xSemaphoreTake(worker.ready, portMAX_DELAY);
+            worker.waiting = false;
+            _batch = &worker.batches[worker.consumed];
+        }
+        _next = 0;
+        return true;
+    }
+
+    /**
+     * @brief reads the current range of the worker into its buffer.
+     * @return false if the range is beyond the end of the file
+     */
+    bool loadRange(Worker &worker) {
+        uint32_t start = _start + worker.range * PARSER_CHUNK_SIZE;
+        if (start >= _size) {
+            return false;
+        }
+
+        // the byte before the range tells if a line starts with the range, a line starting before belongs to the previous range
+        worker.offset = start > _start ? start - 1 : start;
+        size_t size = start - worker.offset + PARSER_CHUNK_SIZE + PARSER_MAX_LINE;
+        worker.file->seek(worker.offset);
+        worker.length = worker.file->read((uint8_t *)worker.buffer, size);
+        if (worker.length > size) {
+            worker.length = 0;
+        }
+        worker.end = min((size_t)(start - worker.offset + PARSER_CHUNK_SIZE), worker.length);
+        worker.position = 0;
+
+        if (worker.offset < start) {
+            char *end = (char *)memchr(worker.buffer, '\n', worker.length);
+            worker.position = end ? end - worker.buffer + 1 : worker.length;
+        }
+
+        worker.loaded = true;
+        return true;
+    }
+
+    /**
+     * @brief splits the next lines of the current range of the worker into the batch and parses them.
+     */
+    void parseBatch(Worker &worker, Batch &batch) {
+        batch.count = 0;
+        batch.last = false;
+        batch.eof = false;
+
+        if (!worker.loaded && !loadRange(worker)) {
+            batch.last = true;
+            batch.eof = true;
+            return;
+        }
+
+        while (worker.position < worker.end && batch.count < PARSER_BATCH_LINES) {
+            char *end = (char *)memchr(worker.buffer + worker.position, '\n', worker.length - worker.position);
+            size_t next = end ? end - worker.buffer : worker.length;
+            worker.buffer[next] = '\0';
+
+            Line &line = batch.lines[batch.count++];
+            line.text = worker.buffer + worker.position;
+            line.text.trim();
+            line.offset = worker.offset + worker.position;
+            line.timed = false;
+            line.valid = false;
+            if (line.text.length() > 0) {
+                _parser(line);
+            }
+            worker.position = next + 1;
+        }
+
+        if (worker.position >= worker.end) {
+            batch.last = true;
+            worker.loaded = false;
+            worker.range += _workerCount;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,347 @@
+#ifndef QEMS_RECORD_CACHE_H_
+#define QEMS_RECORD_CACHE_H_
+
+#include <LittleFS.h>
+#include <QEMSCompressedSeries.h>
+#include <QEMSCsvIndex.h>
+#include <QEMSCsvParser.h>
+#include <QEMSDataSource.h>
+#include <new>
+
+/**
+ * Number of pages kept by the record cache. Can be set as build flag, e.g. -DRECORD_CACHE_PAGES=32 if RAM is available.
+ */
+#ifndef RECORD_CACHE_PAGES
+#define RECORD_CACHE_PAGES 8
+#endif
+
+/**
+ * Maximum number of records of a page: CSV_INDEX_STRIDE records of a CSV data file or a block of SERIES_BLOCK_RECORDS records of a compressed one.
+ */
+#define RECORD_PAGE_SIZE 128
+
+/**
+ * @brief counters of the record cache.
+ */
+struct QEMSCacheStatistics {
+    uint32_t hits;       // pages found in the cache
+    uint32_t misses;     // pages read from the data file for a query
+    uint32_t prefetches; // pages read ahead of sequential queries
+    uint32_t evictions;  // pages dropped to make room for another one
+    uint32_t pages;      // pages currently cached
+};
+
+/**
+ * @brief cache of pages of records read directly from the data files, used to answer queries for records that are not loaded into RAM, e.g. of the past or
+ * beyond the loaded window. A page of a CSV data file holds the records between two entries of its index, a page of a compressed data file is one of its
+ * blocks, so a page is read without parsing anything before it. Data files without index are not cached.
+ *
+ * The least recently used page is replaced when a page is missing. If a query starts where the last one ended, e.g. while the history chart advances, the
+ * page after the last one read is loaded ahead, so the next query is answered from RAM. All pages of a file are dropped with clear() when it changes.
+ */
+class QEMSRecordCache {
+
+    /**
+     * The records of a page, the values of all columns of the data file in hundredth of a percent.
+     */
+    struct Page {
+        String path;                                    // the data file, empty for unused pages
+        uint32_t number;                                // the number of the index entry or block the page starts with
+        uint32_t lastUse;                               // value of the use counter at the last access
+        uint16_t count;                                 // number of records
+        uint32_t times[RECORD_PAGE_SIZE];               // timestamps of the records
+        uint16_t values[RECORD_PAGE_SIZE][MAX_CHANNELS]; // values per record and column
+    };
+
+    /**
+     * The data file pages are read from, opened on the first miss of a query.
+     */
+    struct Source {
+        String path;
+        File csv;
+        File index;
+        QEMSSeriesReader series;
+        bool compressed = false;
+        bool open = false;
+    };
+
+  public:
+    QEMSRecordCache() { _mutex = xSemaphoreCreateMutex(); }
+
+    ~QEMSRecordCache() {
+        delete[] _pages;
+        vSemaphoreDelete(_mutex);
+    }
+
+    /**
+     * @brief reads the records of one column of a data file in a time range.
+     * @param path the data file
+     * @param column the value column, starting with 1
+     * @param from the start of the range (inclusive)
+     * @param to the end of the range (exclusive)
+     * @param times receives the timestamps of the records
+     * @param values receives the values of the records in percent
+     * @param maxCount the size of the arrays
+     * @return the number of records stored in the arrays
+     */
+    uint16_t read(String path, uint8_t column, time_t from, time_t to, time_t *times, float *values, uint16_t maxCount) {
+        if (column == 0 || column > MAX_CHANNELS || from >= to) {
+            return 0;
+        }
+
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        if (!allocate()) {
+            xSemaphoreGive(_mutex);
+            return 0;
+        }
+
+        Source source;
+        source.path = path;
+        Page *page = findCached(path, from);
+        uint32_t number = page ? page->number : 0;
+        if (!page && !(openSource(source) && findPage(source, from, number))) {
+            closeSource(source);
+            xSemaphoreGive(_mutex);
+            return 0;
+        }
+
+        bool sequential = path == _lastPath && (number == _lastNumber || number == _lastNumber + 1);
+        uint16_t count = 0;
+        bool end = false;
+        for (; !end && count < maxCount && (page = getPage(source, number, false)); number++) {
+            for (uint16_t i = 0; i < page->count && count < maxCount; i++) {
+                if ((time_t)page->times[i] >= to) {
+                    end = true;
+                    break;
+                }
+                if ((time_t)page->times[i] >= from) {
+                    times[count] = page->times[i];
+                    values[count++] = page->values[i][column - 1] * 100.0f / QEMSFixedPoint<uint16_t>::SCALE;
+                }
+            }
+        }
+
+        // number is the page after the last one read
+        _lastPath = path;
+        _lastNumber = number - 1;
+        if (sequential) {
+            getPage(source, number, true);
+        }
+
+        closeSource(source);
+        xSemaphoreGive(_mutex);
+        return count;
+    }
+
+    /**
+     * @brief drops the pages of a data file, has to be called whenever the file changes.
+     * @param path the data file, an empty String drops all pages
+     */
+    void clear(String path = "") {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        for (uint8_t p = 0; _pages && p < RECORD_CACHE_PAGES; p++) {
+            if (path.length() == 0 || _pages[p].path == path) {
+                _pages[p].path = "";
+            }
+        }
+        _lastPath = "";
+        xSemaphoreGive(_mutex);
+    }
+
+    QEMSCacheStatistics getStatistics() {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        QEMSCacheStatistics statistics = _statistics;
+        statistics.pages = 0;
+        for (uint8_t p = 0; _pages && p < RECORD_CACHE_PAGES; p++) {
+            statistics.pages += _pages[p].path.length() > 0;
+        }
+        xSemaphoreGive(_mutex);
+        return statistics;
+    }
+
+  private:
+    /**
+     * The pages, allocated on the first query.
+     */
+    Page *_pages = nullptr;
+
+    /**
+     * Incremented with every page access, the page with the lowest lastUse is replaced.
+     */
+    uint32_t _uses = 0;
+
+    /**
+     * The last page read by the last query, used to detect sequential queries.
+     */
+    String _lastPath;
+    uint32_t _lastNumber = 0;
+
+    QEMSCacheStatistics _statistics = {0, 0, 0, 0, 0};
+
+    SemaphoreHandle_t _mutex;
+
+    bool allocate() {
+        if (!_pages) {
+            _pages = new (std::nothrow) Page[RECORD_CACHE_PAGES];
+            for (uint8_t p = 0; _pages && p < RECORD_CACHE_PAGES; p++) {
+                _pages[p].lastUse = 0;
+                _pages[p].count = 0;
+            }
+            Serial.printf("Allocated %d bytes for the record cache\n", RECORD_CACHE_PAGES * sizeof(Page));
+        }
+        return _pages != nullptr;
+    }
+
+    /**
+     * @brief returns a cached page of the data file that contains the passed time, so a query needs no access to the file to find its first page.
+     */
+    Page *findCached(String &path, time_t time) {
+        for (uint8_t p = 0; p < RECORD_CACHE_PAGES; p++) {
+            Page &page = _pages[p];
+            if (page.count > 0 && page.path == path && (time_t)page.times[0] <= time && time <= (time_t)page.times[page.count - 1]) {
+                return &page;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief returns a page of the data file, reads it if it is not cached.
+     * @param source the data file, opened if needed
+     * @param number the number of the page
+     * @param prefetch if the page is read ahead of a query
+     * @return nullptr if there is no such page
+     */
+    Page *getPage(Source &source, uint32_t number, bool prefetch) {
+        Page *victim = &_pages[0];
+        for (uint8_t p = 0; p < RECORD_CACHE_PAGES; p++) {
+            Page &page = _pages[p];
+            if (page.path == source.path && page.number == number) {
+                _statistics.hits += !prefetch;
+                page.lastUse = ++_uses;
+                return &page;
+            }
+
+            // unused pages are taken first
+            if (victim->path.length() > 0 && (page.path.length() == 0 || page.lastUse < victim->lastUse)) {
+                victim = &page;
+            }
+        }
+
+        if (!openSource(source)) {
+            return nullptr;
+        }
+
+        _statistics.evictions += victim->path.length() > 0;
+        victim->path = "";
+        if (!loadPage(source, number, *victim)) {
+            return nullptr;
+        }
+
+        (prefetch ? _statistics.prefetches : _statistics.misses)++;
+        victim->path = source.path;
+        victim->number = number;
+        victim->lastUse = ++_uses;
+        return victim;
+    }
+
+    /**
+     * @brief opens the data file and its index, if not done before for the current query.
+     * @return false if the file cannot be read page by page
+     */
+    bool openSource(Source &source) {
+        if (source.open) {
+            return true;
+        }
+
+        source.csv = LittleFS.open(source.path.c_str());
+        source.compressed = source.csv && QEMSCompressedSeries::isCompressed(source.csv);
+        if (source.compressed) {
+            source.csv.close();
+            source.open = source.series.open(source.path);
+        } else {
+            source.open = source.csv && QEMSCsvIndex::open(source.index, source.path, source.csv.size());
+        }
+        return source.open;
+    }
+
+    void closeSource(Source &source) {
+        source.csv.close();
+        source.index.close();
+        source.series.close();
+    }
+
+    /**
+     * @brief finds the page of the data file containing the first record with a timestamp of at least the passed time.
+     */
+    bool findPage(Source &source, time_t time, uint32_t &number) {
+        if (source.compressed) {
+            return source.series.findBlock(time, number);
+        }
+
+        // the records before the first entry not older than the time belong to the page of the entry before
+        if (!QEMSCsvIndex::find(source.index, time, number)) {
+            return false;
+        }
+        number = number > 0 ? number - 1 : 0;
+        return true;
+    }
+
+    /**
+     * @brief reads the records of a page.
+     * @return false if there is no such page or it cannot be read
+     */
+    bool loadPage(Source &source, uint32_t number, Page &page) {
+        page.count = 0;
+
+        if (source.compressed) {
+            if (!source.series.seekBlockNumber(number)) {
+                return false;
+            }
+
+            time_t time;
+            uint16_t values[MAX_CHANNELS] = {0};
+            while (page.count < RECORD_PAGE_SIZE && source.series.next(time, values)) {
+                page.times[page.count] = time;
+                memcpy(page.values[page.count++], values, sizeof(values));
+
+                if (source.series.isBlockEnd()) {
+                    break;
+                }
+            }
+            return page.count > 0;
+        }
+
+        time_t time;
+        uint32_t offset;
+        uint32_t end;
+        if (number >= QEMSCsvIndex::getEntryCount(source.index) || !QEMSCsvIndex::getEntry(source.index, number, time, offset)) {
+            return false;
+        }
+        if (!QEMSCsvIndex::getEntry(source.index, number + 1, time, end)) {
+            end = source.csv.size();
+        }
+
+        source.csv.seek(offset);
+        while (source.csv.position() < end && page.count < RECORD_PAGE_SIZE) {
+            String line = source.csv.readStringUntil('\n');
+            line.trim();
+
+            time_t recordTime;
+            if (line.length() < 19 || !QEMSCsvParser::parseTime(line, recordTime)) {
+                continue;
+            }
+
+            page.times[page.count] = recordTime;
+            for (uint8_t c = 0; c < MAX_CHANNELS; c++) {
+                int value = 0;
+                QEMSCsvParser::parseValue(line, c + 1, QEMSFixedPoint<uint16_t>::SCALE, value);
+                page.values[page.count][c] = value;
+            }
+            page.count++;
+        }
+        return page.count > 0;
+    }
+};
+
+#endif
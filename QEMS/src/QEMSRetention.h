@@ -0,0 +1,121 @@
+#ifndef QEMS_RETENTION_H_
+#define QEMS_RETENTION_H_
+
+#include <LittleFS.h>
+#include <QEMSAggregates.h>
+#include <QEMSBlockWriter.h>
+#include <QEMSCompressedSeries.h>
+#include <QEMSCsvIndex.h>
+#include <QEMSCsvParser.h>
+
+/**
+ * Records older than this number of seconds are dropped from the data files, their hour and day aggregates are kept. Can be set as build flag, e.g.
+ * -DRETENTION_HORIZON=604800 to keep a week.
+ */
+#ifndef RETENTION_HORIZON
+#define RETENTION_HORIZON 172800
+#endif
+
+/**
+ * Interval of the retention in seconds.
+ */
+#define RETENTION_INTERVAL 3600
+
+/**
+ * @brief drops the records older than the retention horizon from a CSV data file, so the file does not grow without bounds when records are appended and
+ * a load does not parse records of the past. The records are dropped in whole UTC days, their hour and day buckets are moved to the archive of the
+ * aggregates first (see QEMSAggregates::archive()), so queries and the history chart still cover them.
+ *
+ * The remaining records are copied to a temporary file that replaces the data file atomically. The index and aggregates of the data file are outdated
+ * afterwards, the data manager recreates them with a validating reload.
+ */
+class QEMSRetention {
+
+  public:
+    /**
+     * @brief drops the records before the passed time from the data file.
+     * @param csvPath the data file
+     * @param before the time, rounded down to the start of the day
+     * @param written the size of the shortened data file
+     * @param crc the CRC32 of the shortened data file
+     * @return true if records were dropped, false if there are none to drop, the data file is compressed or its aggregates are outdated
+     */
+    static bool dropRecords(String csvPath, time_t before, size_t &written, uint32_t &crc) {
+        unsigned long start = millis();
+        before -= before % 86400;
+
+        File csv = LittleFS.open(csvPath.c_str());
+        size_t size = csv ? csv.size() : 0;
+        if (!csv || QEMSCompressedSeries::isCompressed(csv) || !QEMSAggregates::exists(csvPath, size)) {
+            csv.close();
+            return false;
+        }
+
+        uint32_t offset = findRecord(csv, csvPath, before);
+        csv.close();
+
+        if (offset == 0 || offset >= size || !QEMSAggregates::archive(csvPath, before)) {
+            return false;
+        }
+
+        String temp = csvPath + String(".tmp");
+        if (!copy(csvPath, offset, temp, written, crc) || !LittleFS.rename(temp.c_str(), csvPath.c_str())) {
+            LittleFS.remove(temp.c_str());
+            return false;
+        }
+
+        Serial.printf("Dropped %d of %d bytes from [%s] in %lu ms\n", offset, size, csvPath.c_str(), millis() - start);
+        return true;
+    }
+
+  private:
+    /**
+     * @brief finds the first record of the data file that is not older than the passed time, starting at the indexed record before it.
+     * @return the offset of the record, 0 if there is no older record and the size of the file if all records are older
+     */
+    static uint32_t findRecord(File &csv, String csvPath, time_t time) {
+        QEMSCsvIndex::seek(csv, csvPath, time);
+
+        while (csv.available()) {
+            uint32_t offset = csv.position();
+            String line = csv.readStringUntil('\n');
+            line.trim();
+
+            time_t recordTime;
+            if (line.length() >= 19 && QEMSCsvParser::parseTime(line, recordTime) && recordTime >= time) {
+                return offset;
+            }
+        }
+
+        return csv.size();
+    }
+
+    /**
+     * @brief copies the data file from the passed offset on to the target file.
+     * @param written the size of the target file
+     * @param crc the CRC32 of the target file
+     */
+    static bool copy(String csvPath, uint32_t offset, String target, size_t &written, uint32_t &crc) {
+        File csv = LittleFS.open(csvPath.c_str());
+        QEMSBlockWriter writer;
+        if (!csv || !csv.seek(offset) || !writer.open(target)) {
+            csv.close();
+            return false;
+        }
+
+        uint8_t buffer[512];
+        size_t length;
+        bool copied = true;
+        while (copied && (length = csv.read(buffer, sizeof(buffer))) > 0) {
+            copied = writer.write(buffer, length) == length;
+        }
+        csv.close();
+
+        bool closed = writer.close();
+        written = writer.getWrittenBytes();
+        crc = writer.getCrc();
+        return closed && copied;
+    }
+};
+
+#endif
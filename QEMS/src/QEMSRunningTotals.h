@@ -0,0 +1,164 @@
+#ifndef QEMS_RUNNING_TOTALS_H_
+#define QEMS_RUNNING_TOTALS_H_
+
+#include <QEMSAggregates.h>
+#include <QEMSDataSource.h>
+#include <time.h>
+
+/**
+ * Distance between two records of the data files in seconds, used to accumulate the savings of the records, see QEMSRunningTotals::getPercentHours(). Can
+ * be set as build flag, e.g. -DRECORD_INTERVAL=60 for data files with a record per minute.
+ */
+#ifndef RECORD_INTERVAL
+#define RECORD_INTERVAL 15
+#endif
+
+/**
+ * @brief aggregates of the records of all channels from the start of the current day and week (local time, weeks start on monday) up to the current time,
+ * e.g. the mean savings so far today. The data managers add every record once the clock passed it, so keeping the totals costs O(1) per record and reading
+ * them O(1) per tick.
+ *
+ * The totals are started from the aggregates of the data files, see QEMSAggregates, which cover the records before the loaded ones, and restarted by the
+ * data task whenever other records were loaded or the clock jumped, see QEMSDataSource::restartTotals(). The aggregates are reduced to full minutes, the
+ * records of the current minute are added from the loaded records.
+ */
+class QEMSRunningTotals {
+
+  public:
+    QEMSRunningTotals() { _mutex = xSemaphoreCreateMutex(); }
+
+    ~QEMSRunningTotals() { vSemaphoreDelete(_mutex); }
+
+    /**
+     * @brief starts the totals of all channels of a data source from the aggregates of its data files.
+     * @param source the data source
+     * @param now the current time
+     * @return the time the totals cover the records up to (exclusive), the records from this time on have to be passed to add()
+     */
+    time_t restart(QEMSDataSource *source, time_t now) {
+        time_t until = now / 60 * 60;
+
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        setPeriod(now);
+        _channelCount = source->getChannelCount();
+        _time = until;
+
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            if (!source->getAggregate(c, _dayStart, until, _today[c])) {
+                _today[c] = {0, 0, 0, 0, 0};
+            }
+            if (!source->getAggregate(c, _weekStart, until, _week[c])) {
+                _week[c] = {0, 0, 0, 0, 0};
+            }
+        }
+        Serial.printf("Started running totals at %ld with %d records of today and %d of this week\n", (long)until, _today[0].count, _week[0].count);
+        xSemaphoreGive(_mutex);
+        return until;
+    }
+
+    /**
+     * @brief adds a record the clock passed, the records have to be added in order of their timestamps.
+     * @param time the timestamp of the record
+     * @param values the values of all channels in percent
+     */
+    void add(time_t time, const float *values) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        if (time >= _nextDay) {
+            bool newWeek = time >= _nextWeek;
+            setPeriod(time);
+            for (uint8_t c = 0; c < _channelCount; c++) {
+                _today[c] = {0, 0, 0, 0, 0};
+                if (newWeek) {
+                    _week[c] = {0, 0, 0, 0, 0};
+                }
+            }
+        }
+
+        for (uint8_t c = 0; c < _channelCount; c++) {
+            add(_today[c], values[c]);
+            add(_week[c], values[c]);
+        }
+        _time = time;
+        xSemaphoreGive(_mutex);
+    }
+
+    /**
+     * @brief returns the totals of a channel.
+     * @param channel the channel
+     * @param now the current time, the totals of a day or week that ended are empty
+     * @param today the aggregated values of the records of the current day up to now
+     * @param week the aggregated values of the records of the current week up to now
+     * @return false if the totals were not started yet
+     */
+    bool get(uint8_t channel, time_t now, QEMSAggregate &today, QEMSAggregate &week) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        bool started = channel < _channelCount;
+        today = started && now < _nextDay ? _today[channel] : QEMSAggregate{0, 0, 0, 0, 0};
+        week = started && now < _nextWeek ? _week[channel] : QEMSAggregate{0, 0, 0, 0, 0};
+        xSemaphoreGive(_mutex);
+        return started;
+    }
+
+    /**
+     * @brief returns the savings accumulated by the records of a total in percent hours, every record saves its percentage for RECORD_INTERVAL seconds. 100
+     * percent hours are a full hour of savings, e.g. a day with a mean of 25% accumulates 600 percent hours.
+     */
+    static float getPercentHours(const QEMSAggregate &total) { return total.sum * RECORD_INTERVAL / 3600.0f; }
+
+    /**
+     * @brief returns the timestamp of the last record added, the totals have to be restarted if the clock is set before it.
+     */
+    time_t getTime() { return _time; }
+
+  private:
+    QEMSAggregate _today[MAX_CHANNELS];
+    QEMSAggregate _week[MAX_CHANNELS];
+    uint8_t _channelCount = 0;
+
+    /**
+     * Start of the current day and week and start of the next ones.
+     */
+    time_t _dayStart = 0;
+    time_t _nextDay = 0;
+    time_t _weekStart = 0;
+    time_t _nextWeek = 0;
+
+    time_t _time = 0;
+
+    SemaphoreHandle_t _mutex;
+
+    static void add(QEMSAggregate &total, float value) {
+        total.min = total.count == 0 ? value : min(total.min, value);
+        total.max = total.count == 0 ? value : max(total.max, value);
+        total.count++;
+        total.sum += value;
+        total.mean = total.sum / total.count;
+    }
+
+    /**
+     * @brief sets the day and week containing the passed time, in local time so the periods follow the daylight saving time.
+     */
+    void setPeriod(time_t time) {
+        struct tm ts;
+        localtime_r(&time, &ts);
+        ts.tm_hour = 0;
+        ts.tm_min = 0;
+        ts.tm_sec = 0;
+        ts.tm_isdst = -1;
+
+        int weekday = (ts.tm_wday + 6) % 7; // days since monday
+        struct tm day = ts;
+        _dayStart = mktime(&day);
+        day = ts;
+        day.tm_mday++;
+        _nextDay = mktime(&day);
+        day = ts;
+        day.tm_mday -= weekday;
+        _weekStart = mktime(&day);
+        day = ts;
+        day.tm_mday += 7 - weekday;
+        _nextWeek = mktime(&day);
+    }
+};
+
+#endif
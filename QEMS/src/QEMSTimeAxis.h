@@ -0,0 +1,174 @@
+#ifndef QEMS_TIME_AXIS_H_
+#define QEMS_TIME_AXIS_H_
+
+#include <Arduino.h>
+#include <time.h>
+
+/**
+ * Maximum number of records sharing one base timestamp.
+ */
+#define TIME_BLOCK_SIZE 256
+
+/**
+ * @brief time axis of a data window with a fixed sampling interval known at compile time. Only the timestamp of the first record is stored, the timestamp
+ * of every other record and the record for a given time are calculated. The axis ends at the first record that does not match the interval.
+ * @tparam Capacity maximum number of records
+ * @tparam Interval distance between two records in seconds
+ */
+template <uint16_t Capacity, uint16_t Interval> class QEMSTimeAxis {
+
+  public:
+    void clear() { _count = 0; }
+
+    uint16_t size() { return _count; }
+
+    /**
+     * @brief appends a timestamp to the axis.
+     * @return false if the axis is full or the timestamp does not match the interval
+     */
+    bool append(time_t time) {
+        if (_count == 0) {
+            _base = time;
+        } else if (_count >= Capacity || time != get(_count)) {
+            return false;
+        }
+
+        _count++;
+        return true;
+    }
+
+    /**
+     * @brief returns the timestamp of the record with the passed index.
+     */
+    time_t get(uint16_t index) { return _base + (time_t)index * Interval; }
+
+    /**
+     * @brief returns the index of the first record with a timestamp after the passed time or size() if there is none.
+     */
+    uint16_t findNext(time_t time) {
+        if (time < _base) {
+            return 0;
+        }
+
+        uint32_t index = (time - _base) / Interval + 1;
+        return index < _count ? index : _count;
+    }
+
+    /**
+     * @brief removes all records starting with the passed index.
+     */
+    void truncate(uint16_t count) { _count = min(count, _count); }
+
+  private:
+    time_t _base = 0;
+    uint16_t _count = 0;
+};
+
+/**
+ * @brief time axis of a data window with arbitrary timestamps. The records are grouped into blocks of up to TIME_BLOCK_SIZE records sharing a base timestamp,
+ * for every record only the 16 bit offset to the base is stored. A new block is started early if the gap between two records does not fit into an offset.
+ * @tparam Capacity maximum number of records
+ */
+template <uint16_t Capacity> class QEMSTimeAxis<Capacity, 0> {
+
+    /**
+     * Number of time blocks. Additional blocks are needed when the gap between two records exceeds the range of an offset.
+     */
+    static const uint16_t BLOCK_CNT = Capacity / TIME_BLOCK_SIZE + 16;
+
+    /**
+     * Base timestamp for a range of records.
+     */
+    struct TimeBlock {
+        time_t base;    // epoch timestamp the offsets of the block refer to
+        uint16_t start; // index of the first record of the block
+    };
+
+  public:
+    void clear() {
+        _count = 0;
+        _blockCount = 0;
+    }
+
+    uint16_t size() { return _count; }
+
+    /**
+     * @brief appends a timestamp to the axis.
+     * @return false if the axis is full
+     */
+    bool append(time_t time) {
+        if (_count >= Capacity) {
+            return false;
+        }
+
+        TimeBlock *block = _blockCount > 0 ? &_blocks[_blockCount - 1] : nullptr;
+
+        // start a new block if the current one is full or the offset does not fit
+        if (!block || _count - block->start >= TIME_BLOCK_SIZE || time < block->base || time - block->base > UINT16_MAX) {
+            if (_blockCount >= BLOCK_CNT) {
+                return false;
+            }
+
+            block = &_blocks[_blockCount++];
+            block->base = time;
+            block->start = _count;
+        }
+
+        _offsets[_count++] = time - block->base;
+        return true;
+    }
+
+    /**
+     * @brief returns the timestamp of the record with the passed index.
+     */
+    time_t get(uint16_t index) {
+        // last block starting at or before the index
+        uint16_t lo = 0;
+        uint16_t hi = _blockCount - 1;
+        while (lo < hi) {
+            uint16_t mid = (lo + hi + 1) / 2;
+            if (_blocks[mid].start <= index) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+
+        return _blocks[lo].base + _offsets[index];
+    }
+
+    /**
+     * @brief returns the index of the first record with a timestamp after the passed time or size() if there is none.
+     */
+    uint16_t findNext(time_t time) {
+        uint16_t lo = 0;
+        uint16_t hi = _count;
+        while (lo < hi) {
+            uint16_t mid = (lo + hi) / 2;
+            if (get(mid) > time) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        return lo;
+    }
+
+    /**
+     * @brief removes all records starting with the passed index.
+     */
+    void truncate(uint16_t count) {
+        _count = min(count, _count);
+        while (_blockCount > 0 && _blocks[_blockCount - 1].start >= _count) {
+            _blockCount--;
+        }
+    }
+
+  private:
+    TimeBlock _blocks[BLOCK_CNT];
+    uint16_t _blockCount = 0;
+    uint16_t _offsets[Capacity];
+    uint16_t _count = 0;
+};
+
+#endif
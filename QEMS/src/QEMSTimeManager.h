@@ -2,21 +2,137 @@
 #define QEMS_TIME_MANAGER_H_
 
 #include <Arduino.h>
+#include <Preferences.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <sys/time.h>
 #include <time.h>
 
 /**
- * @brief utility class to handle time related stuff based on an ntp server. The class MUST be instantiated after the connection to a WiFi network was
- * established, otherwise the time cannot be retrieved
+ * Timestamps before this one (01.01.2023) are not a valid clock, e.g. the clock after boot before it was set.
+ */
+#define MIN_VALID_TIME 1672531200
+
+/**
+ * Seconds between two updates of the persisted clock estimate, limits the writes to the NVS.
+ */
+#define CLOCK_ESTIMATE_INTERVAL 900
+
+/**
+ * Speed of the replay clock, e.g. 60 runs an hour of data in a minute. If QEMS_REPLAY_START is set to an epoch timestamp, the device starts in replay mode
+ * and shows the data from this time on instead of the current one. Both can be set as build flag, e.g. -DQEMS_REPLAY_START=1680040800
+ */
+#ifndef QEMS_REPLAY_SPEED
+#define QEMS_REPLAY_SPEED 1
+#endif
+
+/**
+ * @brief utility class to handle time related stuff based on an ntp server. The time is synchronized as soon as a WiFi connection is established. Until then
+ * the clock is set to the estimate persisted in the NVS before the last reboot, so the data can be shown without waiting for the network.
+ *
+ * In replay mode now() returns a virtual clock instead, which starts at an arbitrary time and runs at a multiple of the real speed or stands still, e.g. to
+ * show a day of data in minutes. The system clock, its synchronization and the persisted estimate are not affected by the replay.
  */
 class QEMSTimeManager {
 
   public:
-    QEMSTimeManager() { configTime(gmtOffset_sec, daylightOffset_sec, ntpServer); }
+    QEMSTimeManager() {
+        configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
+        sntp_set_time_sync_notification_cb([](struct timeval *tv) { getSynchronized() = true; });
+        restoreEstimate();
+
+#ifdef QEMS_REPLAY_START
+        startReplay(QEMS_REPLAY_START, QEMS_REPLAY_SPEED);
+#endif
+    }
+
+    /**
+     * @brief returns true if the clock is set, either synchronized, from the persisted estimate or by the replay
+     */
+    bool isValid() { return isReplay() || time(nullptr) >= MIN_VALID_TIME; }
+
+    /**
+     * @brief returns true if the clock was synchronized with the ntp server since boot
+     */
+    bool isSynchronized() { return getSynchronized(); }
+
+    /**
+     * @brief persists the current time as estimate for the next boot, at most every CLOCK_ESTIMATE_INTERVAL seconds. Has to be called periodically.
+     */
+    void saveEstimate() {
+        time_t current = time(nullptr);
+        if (current < MIN_VALID_TIME || current - _savedEstimate < CLOCK_ESTIMATE_INTERVAL) {
+            return;
+        }
+
+        Preferences preferences;
+        if (preferences.begin("qems")) {
+            preferences.putULong64("clock", current);
+            preferences.end();
+        }
+        _savedEstimate = current;
+    }
+
+    /**
+     * @brief starts the replay clock or changes its time and speed.
+     * @param start the time the replay clock is set to
+     * @param speed the multiple of the real speed the replay clock runs at, 0 stops it
+     */
+    void startReplay(time_t start, uint16_t speed) {
+        setReplay(true, (int64_t)start * 1000, speed);
+        Serial.printf("Replay clock set to %ld with speed %d\n", (long)start, speed);
+    }
+
+    /**
+     * @brief changes the speed of the replay clock without changing its time, starts it at the current time if it is not running.
+     */
+    void setReplaySpeed(uint16_t speed) { setReplay(true, nowMillis(), speed); }
+
+    /**
+     * @brief moves the replay clock forward, e.g. to step through the records while it is stopped. This is no jump, the loaded records cover the new time
+     * or the data source runs out of records and reloads.
+     */
+    void advanceReplay(time_t seconds) { setReplay(true, nowMillis() + (int64_t)seconds * 1000, getReplaySpeed()); }
+
+    /**
+     * @brief switches back to the system clock.
+     */
+    void stopReplay() {
+        setReplay(false, 0, 1);
+        Serial.println("Replay clock stopped");
+    }
+
+    bool isReplay() { return _replays[_replay].active; }
+
+    uint16_t getReplaySpeed() { return _replays[_replay].speed; }
+
+    /**
+     * @brief returns a counter that is incremented whenever the clock was set back, i.e. the time jumped before the loaded records. Setting the clock forward
+     * is no jump, the data source reloads once the clock passed its records.
+     */
+    uint32_t getJumps() { return _jumps; }
+
+    /**
+     * @brief converts a duration of the clock returned by now() into real milliseconds, used to wait for a time.
+     * @param seconds the duration
+     * @return the real duration in milliseconds, 0 for durations that already passed and INT32_MAX if the replay clock is stopped
+     */
+    uint32_t toRealMillis(time_t seconds) {
+        uint16_t speed = isReplay() ? getReplaySpeed() : 1;
+        if (seconds <= 0) {
+            return 0;
+        }
+        return speed > 0 ? min((int64_t)seconds * 1000 / speed, (int64_t)INT32_MAX) : INT32_MAX;
+    }
 
     /**
      * @brief returns the current epoch time
      */
     time_t now() {
+        if (isReplay()) {
+            return getReplayMillis() / 1000;
+        }
+
         struct tm timeinfo;
         if (!getLocalTime(&timeinfo)) {
             Serial.println("Failed to obtain time");
@@ -24,15 +140,26 @@ class QEMSTimeManager {
         return mktime(&timeinfo);
     }
 
+    /**
+     * @brief returns the current time in milliseconds since epoch, used to sample values between two records
+     */
+    int64_t nowMillis() {
+        if (isReplay()) {
+            return getReplayMillis();
+        }
+
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    }
+
     /**
      * @brief stores the current time as character array in format HH:mm
      * @param timeBuf the buffer to store the time
      */
     void getTime(char *timeBuf) {
         struct tm timeinfo;
-        if (!getLocalTime(&timeinfo)) {
-            Serial.println("Failed to obtain time");
-        }
+        getTimeInfo(timeinfo);
         strftime(timeBuf, 10, "%H:%M:%S", &timeinfo);
     }
 
@@ -42,13 +169,85 @@ class QEMSTimeManager {
      */
     void getDate(char *dateBuf) {
         struct tm timeinfo;
-        if (!getLocalTime(&timeinfo)) {
-            Serial.println("Failed to obtain time");
-        }
+        getTimeInfo(timeinfo);
         strftime(dateBuf, 11, "%d.%m.%Y", &timeinfo);
     }
 
   private:
+    /**
+     * State of the replay clock, it shows startMillis at the real time anchorMicros and runs with speed from there.
+     */
+    struct Replay {
+        bool active;
+        int64_t startMillis;
+        int64_t anchorMicros;
+        uint16_t speed;
+    };
+
+    /**
+     * The replay clock is set by another task than the one reading it, so the new state is written to the unused entry before it is activated.
+     */
+    Replay _replays[2] = {{false, 0, 0, 1}, {false, 0, 0, 1}};
+    volatile uint8_t _replay = 0;
+    volatile uint32_t _jumps = 0;
+
+    /**
+     * Time of the last persisted estimate.
+     */
+    time_t _savedEstimate = 0;
+
+    void setReplay(bool active, int64_t startMillis, uint16_t speed) {
+        int64_t previous = nowMillis();
+        uint8_t next = 1 - _replay;
+        _replays[next] = {active, startMillis, esp_timer_get_time(), speed};
+        _replay = next;
+
+        // the time passing while the clock is set, e.g. to change the speed, is no jump
+        if (nowMillis() < previous - 1000) {
+            _jumps++;
+        }
+    }
+
+    int64_t getReplayMillis() {
+        const Replay &replay = _replays[_replay];
+        return replay.startMillis + (esp_timer_get_time() - replay.anchorMicros) * replay.speed / 1000;
+    }
+
+    void getTimeInfo(struct tm &timeinfo) {
+        if (isReplay()) {
+            time_t current = now();
+            localtime_r(&current, &timeinfo);
+        } else if (!getLocalTime(&timeinfo)) {
+            Serial.println("Failed to obtain time");
+        }
+    }
+
+    static volatile bool &getSynchronized() {
+        static volatile bool synchronized = false;
+        return synchronized;
+    }
+
+    /**
+     * @brief sets the clock to the persisted estimate if it is not set yet. The estimate is behind the real time by the time the device was off, the data
+     * is shown for this time until the clock is synchronized.
+     */
+    void restoreEstimate() {
+        Preferences preferences;
+        if (isValid() || !preferences.begin("qems", true)) {
+            return;
+        }
+
+        time_t estimate = preferences.getULong64("clock", 0);
+        preferences.end();
+
+        if (estimate >= MIN_VALID_TIME) {
+            struct timeval tv = {estimate, 0};
+            settimeofday(&tv, NULL);
+            _savedEstimate = estimate;
+            Serial.printf("Clock set to the persisted estimate %ld\n", (long)estimate);
+        }
+    }
+
     const char *ntpServer = "pool.ntp.org";
     const long gmtOffset_sec = 3600;
     const int daylightOffset_sec = 3600;
@@ -3,7 +3,12 @@
 #define UI_METER_H_
 
 #include <LittleFS.h>
+#include <QEMSAggregates.h>
+#include <QEMSDataSource.h>
 #include <QEMSDisplay.h>
+#include <QEMSJobQueue.h>
+#include <QEMSLttb.h>
+#include <QEMSRunningTotals.h>
 #include <QEMSWiFiManager.h>
 #include <ui/ui.h>
 
@@ -19,6 +24,49 @@ static lv_obj_t *ui_meter;
 static lv_meter_indicator_t *co2Indicator;
 static lv_meter_indicator_t *costIndicator;
 
+static lv_obj_t *ui_S2L_CO2_Totals;
+static lv_obj_t *ui_S2L_Cost_Totals;
+
+static lv_obj_t *ui_Screen_History;
+static lv_obj_t *ui_S6_Chart;
+static lv_obj_t *ui_S6L_Header;
+
+/**
+ * Hours before and after the current time shown on the history screen.
+ */
+#define HISTORY_HOURS 6
+
+/**
+ * Maximum number of records per chart point considered for the downsampling.
+ */
+#define HISTORY_BUCKET_SIZE 64
+
+/**
+ * @brief a channel shown on the history screen. Every point of the chart covers a fixed time span (bucket), the record shown for a bucket is selected
+ * with the Largest-Triangle-Three-Buckets algorithm, so the chart never holds more points than it has pixels.
+ */
+struct HistorySeries {
+    lv_chart_series_t *series;
+    uint8_t channel;
+    QEMSLttb::Point previous; // the record selected for the last bucket
+    bool hasPrevious;
+};
+
+static HistorySeries historySeries[2];
+
+/**
+ * The timestamp the x coordinates of the records are relative to, the length of a bucket in seconds and the start of the next bucket appended on the
+ * right side of the chart.
+ */
+static time_t historyStart;
+static uint32_t historySpan;
+static time_t historyEnd;
+
+/**
+ * Generation of the data source the chart was built for, the chart is rebuilt when other records were loaded.
+ */
+static uint32_t historyGeneration;
+
 /**
  * @brief the next screen that should be rendered. Managed here due to the refresh problems seen when the screen is changend in different tasks, i.e. when there
  * is a running call to handle the UI while changes are made.
@@ -30,6 +78,11 @@ static lv_obj_t *nextScreen;
  */
 static QEMSWiFiManager *wifiManager;
 
+/**
+ * Executes long running operations, e.g. the factory reset, outside of the UI task.
+ */
+static QEMSJobQueue *jobQueue;
+
 // ------------------------------------------------------------------------------------------------------------------
 // EVENTS
 // ------------------------------------------------------------------------------------------------------------------
@@ -55,9 +108,16 @@ void ui_event_S3B_Factory_Reset(lv_event_t *e) {
     lv_obj_t *target = lv_event_get_target(e);
 
     if (event_code == LV_EVENT_LONG_PRESSED) {
-        LittleFS.format();
-        wifiManager->erase();
-        ESP.restart();
+        lv_label_set_text(ui_S1L_Info, "Werkseinstellungen werden\nwiederhergestellt...");
+        nextScreen = ui_Screen_Loading;
+
+        jobQueue->enqueue("factory reset", [](QEMSJobQueue::Job &job) {
+            LittleFS.format();
+            job.progress = 50;
+            wifiManager->erase();
+            ESP.restart();
+            return true;
+        });
     }
 }
 
@@ -69,6 +129,22 @@ void ui_event_S2P_Header(lv_event_t *e) {
     }
 }
 
+void ui_event_S2P_Content(lv_event_t *e) {
+    lv_event_code_t event_code = lv_event_get_code(e);
+    lv_obj_t *target = lv_event_get_target(e);
+    if (event_code == LV_EVENT_CLICKED) {
+        nextScreen = ui_Screen_History;
+    }
+}
+
+void ui_event_S6_History(lv_event_t *e) {
+    lv_event_code_t event_code = lv_event_get_code(e);
+    lv_obj_t *target = lv_event_get_target(e);
+    if (event_code == LV_EVENT_CLICKED) {
+        nextScreen = ui_Screen_Data;
+    }
+}
+
 void ui_event_S3B_Back(lv_event_t *e) {
     lv_event_code_t event_code = lv_event_get_code(e);
     lv_obj_t *target = lv_event_get_target(e);
@@ -132,6 +208,41 @@ void ui_create_meter() {
     lv_meter_set_indicator_end_value(ui_meter, costIndicator, 0);
 }
 
+/**
+ * @brief creates a label for the accumulated savings of today and the current week below the current value of a channel on the data screen.
+ */
+lv_obj_t *ui_create_totals_label(lv_obj_t *valueLabel) {
+    lv_obj_t *label = lv_label_create(ui_S2P_Content);
+    lv_obj_set_align(label, LV_ALIGN_RIGHT_MID);
+    lv_obj_set_x(label, lv_obj_get_x_aligned(valueLabel));
+    lv_obj_set_y(label, lv_obj_get_y_aligned(valueLabel) + 22);
+    lv_label_set_text(label, "");
+    lv_obj_set_style_text_color(label, lv_color_hex(0x808080), LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_set_style_text_font(label, &ui_font_Raleway16, LV_PART_MAIN | LV_STATE_DEFAULT);
+    return label;
+}
+
+/**
+ * @brief shows the savings accumulated today and in the current week in percent hours, see QEMSRunningTotals::getPercentHours(). The values are read from
+ * the running totals of the data source without accessing any records.
+ */
+void ui_totals_update(QEMSDataSource *source, uint8_t co2Channel, uint8_t costChannel) {
+    lv_obj_t *labels[] = {ui_S2L_CO2_Totals, ui_S2L_Cost_Totals};
+    uint8_t channels[] = {co2Channel, costChannel};
+
+    for (uint8_t i = 0; i < 2; i++) {
+        QEMSAggregate today;
+        QEMSAggregate week;
+        if (!source->getRunningTotals(channels[i], today, week)) {
+            lv_label_set_text(labels[i], "");
+            continue;
+        }
+        int todayHours = roundf(QEMSRunningTotals::getPercentHours(today));
+        int weekHours = roundf(QEMSRunningTotals::getPercentHours(week));
+        lv_label_set_text(labels[i], (String("Heute ") + todayHours + String(" %h / Woche ") + weekHours + String(" %h")).c_str());
+    }
+}
+
 /**
  * @brief animates the value change of the meter for the main data screen.
  *
@@ -153,6 +264,131 @@ void ui_animate_meter_value(lv_meter_indicator_t *indicator, int start, int end)
     lv_anim_start(&a);
 }
 
+/**
+ * @brief creates the history screen with a chart of both channels for the last and next HISTORY_HOURS hours. The screen is opened by clicking the content
+ * of the data screen and closed by clicking it.
+ */
+void ui_create_history_screen() {
+    ui_Screen_History = lv_obj_create(NULL);
+    lv_obj_clear_flag(ui_Screen_History, LV_OBJ_FLAG_SCROLLABLE);
+
+    ui_S6L_Header = lv_label_create(ui_Screen_History);
+    lv_obj_set_x(ui_S6L_Header, 10);
+    lv_obj_set_y(ui_S6L_Header, 8);
+    lv_label_set_text(ui_S6L_Header, (String("Verlauf -/+ ") + HISTORY_HOURS + String(" Stunden")).c_str());
+    lv_obj_set_style_text_font(ui_S6L_Header, &ui_font_Raleway16, LV_PART_MAIN | LV_STATE_DEFAULT);
+
+    ui_S6_Chart = lv_chart_create(ui_Screen_History);
+    lv_obj_set_size(ui_S6_Chart, 310, 200);
+    lv_obj_set_y(ui_S6_Chart, 15);
+    lv_obj_set_align(ui_S6_Chart, LV_ALIGN_CENTER);
+    lv_obj_clear_flag(ui_S6_Chart, LV_OBJ_FLAG_CLICKABLE); // clicks close the screen
+    lv_obj_set_style_radius(ui_S6_Chart, 0, LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_set_style_bg_color(ui_S6_Chart, lv_color_hex(0x2B2B2B), LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_set_style_border_color(ui_S6_Chart, lv_color_hex(0x00A39B), LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_set_style_line_color(ui_S6_Chart, lv_color_hex(0x3b3b3b), LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_set_style_size(ui_S6_Chart, 0, LV_PART_INDICATOR); // no dots on the points
+
+    // the middle of the three vertical division lines marks the current time
+    lv_chart_set_type(ui_S6_Chart, LV_CHART_TYPE_LINE);
+    lv_chart_set_update_mode(ui_S6_Chart, LV_CHART_UPDATE_MODE_SHIFT);
+    lv_chart_set_range(ui_S6_Chart, LV_CHART_AXIS_PRIMARY_Y, 0, 100);
+    lv_chart_set_div_line_count(ui_S6_Chart, 5, 3);
+
+    // one point per pixel
+    lv_obj_update_layout(ui_S6_Chart);
+    lv_chart_set_point_count(ui_S6_Chart, lv_obj_get_content_width(ui_S6_Chart));
+
+    historySeries[0].series = lv_chart_add_series(ui_S6_Chart, lv_color_hex(0xff5269), LV_CHART_AXIS_PRIMARY_Y);
+    historySeries[1].series = lv_chart_add_series(ui_S6_Chart, lv_color_hex(0xb88d00), LV_CHART_AXIS_PRIMARY_Y);
+    lv_chart_set_all_value(ui_S6_Chart, historySeries[0].series, LV_CHART_POINT_NONE);
+    lv_chart_set_all_value(ui_S6_Chart, historySeries[1].series, LV_CHART_POINT_NONE);
+}
+
+/**
+ * @brief reads the records of a channel in the bucket starting at the passed time.
+ */
+static uint16_t ui_history_read(QEMSDataSource *source, uint8_t channel, time_t start, QEMSLttb::Point *points) {
+    time_t times[HISTORY_BUCKET_SIZE];
+    float values[HISTORY_BUCKET_SIZE];
+
+    uint16_t count = source->getRecords(channel, start, start + historySpan, times, values, HISTORY_BUCKET_SIZE);
+    for (uint16_t i = 0; i < count; i++) {
+        points[i] = {(float)(times[i] - historyStart), values[i]};
+    }
+    return count;
+}
+
+/**
+ * @brief appends the point for the bucket starting at the passed time on the right side of the chart, the chart shifts all other points to the left.
+ */
+static void ui_history_append(QEMSDataSource *source, HistorySeries &history, time_t start) {
+    QEMSLttb::Point points[HISTORY_BUCKET_SIZE];
+    QEMSLttb::Point next[HISTORY_BUCKET_SIZE];
+
+    uint16_t count = ui_history_read(source, history.channel, start, points);
+    if (count == 0) {
+        // records that are not loaded, e.g. from before the last load or dropped by the retention, are shown with the mean of their aggregates
+        QEMSAggregate aggregate;
+        if (!source->getAggregate(history.channel, start, start + historySpan, aggregate)) {
+            lv_chart_set_next_value(ui_S6_Chart, history.series, LV_CHART_POINT_NONE);
+            return;
+        }
+
+        history.previous = {(float)(start + historySpan / 2 - historyStart), aggregate.mean};
+        history.hasPrevious = true;
+        lv_chart_set_next_value(ui_S6_Chart, history.series, (lv_coord_t)lroundf(aggregate.mean));
+        return;
+    }
+
+    // the last bucket with data has no successor, its own average is used instead
+    uint16_t nextCount = ui_history_read(source, history.channel, start + historySpan, next);
+    QEMSLttb::Point average = nextCount > 0 ? QEMSLttb::average(next, nextCount) : QEMSLttb::average(points, count);
+
+    uint16_t selected = history.hasPrevious ? QEMSLttb::select(history.previous, points, count, average) : 0;
+    history.previous = points[selected];
+    history.hasPrevious = true;
+
+    lv_chart_set_next_value(ui_S6_Chart, history.series, (lv_coord_t)lroundf(points[selected].y));
+}
+
+/**
+ * @brief updates the history chart for the passed time. Only the buckets that moved into the chart since the last update are appended, the complete chart
+ * is only built when it is shown the first time, the data source loaded other records or the time jumped.
+ * @param source the data source
+ * @param co2Channel the channel of the CO2 savings
+ * @param costChannel the channel of the cost savings
+ * @param now the current time
+ */
+void ui_history_update(QEMSDataSource *source, uint8_t co2Channel, uint8_t costChannel, time_t now) {
+    unsigned long start = micros();
+
+    uint16_t width = lv_chart_get_point_count(ui_S6_Chart);
+    time_t end = now + HISTORY_HOURS * 3600;
+
+    if (historyEnd == 0 || source->getGeneration() != historyGeneration || end - historyEnd > (time_t)historySpan * width || end < historyEnd - historySpan) {
+        historySpan = max(2 * HISTORY_HOURS * 3600 / width, 1);
+        historyStart = (now - HISTORY_HOURS * 3600) / historySpan * historySpan;
+        historyEnd = historyStart;
+        historyGeneration = source->getGeneration();
+        historySeries[0] = {historySeries[0].series, co2Channel, {0, 0}, false};
+        historySeries[1] = {historySeries[1].series, costChannel, {0, 0}, false};
+    }
+
+    uint16_t appended = 0;
+    for (; historyEnd < end; historyEnd += historySpan, appended++) {
+        for (HistorySeries &history : historySeries) {
+            ui_history_append(source, history, historyEnd);
+        }
+    }
+
+    if (appended > 0) {
+        unsigned long computed = micros();
+        lv_refr_now(NULL);
+        Serial.printf("History chart: %d points computed in %lu us, rendered in %lu us\n", appended, computed - start, micros() - computed);
+    }
+}
+
 /**
  * @brief initializes the UI through a combination of the SquareLine studio generated code and the manual extensions done in this class.
  */
@@ -161,11 +397,17 @@ void ui_qems_init() {
     // initialize the SquareLine studio generated part
     ui_init();
 
-    // create the ui_meter, that is not supported in SquareLine studio
+    // create the ui_meter, the labels of the running totals and the history screen, that are not supported in SquareLine studio
     ui_create_meter();
+    ui_create_history_screen();
+    ui_S2L_CO2_Totals = ui_create_totals_label(ui_S2L_CO2_Save);
+    ui_S2L_Cost_Totals = ui_create_totals_label(ui_S2L_Cost_Save);
 
     // Add custome events
     lv_obj_add_event_cb(ui_S2P_Header, ui_event_S2P_Header, LV_EVENT_ALL, NULL);
+    lv_obj_add_event_cb(ui_S2P_Content, ui_event_S2P_Content, LV_EVENT_ALL, NULL);
+    lv_obj_add_event_cb(ui_meter, ui_event_S2P_Content, LV_EVENT_ALL, NULL);
+    lv_obj_add_event_cb(ui_Screen_History, ui_event_S6_History, LV_EVENT_ALL, NULL);
     lv_obj_add_event_cb(ui_S3B_Back, ui_event_S3B_Back, LV_EVENT_ALL, NULL);
     lv_obj_add_event_cb(ui_S3B_Reboot, ui_event_S3B_Reboot, LV_EVENT_ALL, NULL);
     lv_obj_add_event_cb(ui_S3B_WiFi_Reset, ui_event_S3B_WiFi_Reset, LV_EVENT_ALL, NULL);
@@ -2,8 +2,24 @@
 #define QEMS_WEB_SERVER_H_
 
 #include <LittleFS.h>
-#include <QEMSDataManager.h>
+#include <QEMSAggregates.h>
+#include <QEMSBlockWriter.h>
+#include <QEMSCompressedSeries.h>
+#include <QEMSCsvIndex.h>
+#include <QEMSDataSource.h>
+#include <QEMSFileIndex.h>
+#include <QEMSGzipInflater.h>
+#include <QEMSJobQueue.h>
+#include <QEMSRecordCache.h>
+#include <QEMSRunningTotals.h>
+#include <QEMSTimeManager.h>
 #include <WebServer.h>
+#include <uri/UriBraces.h>
+
+/**
+ * Maximum number of records returned by a single request of /api/records.
+ */
+#define API_MAX_RECORDS 128
 
 /**
  * Utility class to handle file related operations via web browser to provide fake data to the display.
@@ -16,25 +32,123 @@ class QEMSWebServer {
      * @brief Creates a new ESP32 web server and configures the methods to handle incoming HTTP request.
      *
      */
-    QEMSWebServer(QEMSDataManager *costManager, QEMSDataManager *co2Manager) : _co2Manager(co2Manager), _costManager(costManager) {
+    QEMSWebServer(QEMSDataSource *dataManager, QEMSTimeManager *timeManager, QEMSJobQueue *jobQueue)
+        : _dataManager(dataManager), _timeManager(timeManager), _jobQueue(jobQueue) {
         webServer = new WebServer(80);
 
+        // the index is built once, afterwards it is updated with the files written by the uploads and the data source
+        _indexAvailable = _fileIndex.build();
+        _dataManager->setFileListener([this](String path, size_t size, uint32_t crc) { _fileIndex.put(path.substring(1), size, time(nullptr), crc); });
+
         webServer->on("/", [this]() { webServer->send(200, "text/html", createWebPage()); });
 
         webServer->on("/favicon.ico", [this]() { webServer->send(404, "text/plain", ""); });
 
         webServer->on("/delete", [this]() {
-            deleteFile(webServer->arg(0));
-            webServer->sendHeader("Location", String("/"), true);
-            webServer->send(302, "text/plain", "");
+            String name = webServer->arg(0);
+            sendJobRedirect(_jobQueue->enqueue(String("delete ") + name, [this, name](QEMSJobQueue::Job &job) { return deleteFile(name); }));
         });
 
         webServer->on("/format", [this]() {
-            format();
-            webServer->sendHeader("Location", String("/"), true);
-            webServer->send(302, "text/plain", "");
+            sendJobRedirect(_jobQueue->enqueue("format", [this](QEMSJobQueue::Job &job) {
+                format();
+                return true;
+            }));
+        });
+
+        webServer->on("/reindex", [this]() { sendJobRedirect(_jobQueue->enqueue("reindex", [this](QEMSJobQueue::Job &job) { return reindex(job); })); });
+
+        webServer->on("/jobs", [this]() { webServer->send(200, "application/json", _jobQueue->getJobsStatus()); });
+
+        webServer->on("/job", [this]() {
+            String status = _jobQueue->getJobStatus(webServer->arg("id").toInt());
+            if (status.length() > 0) {
+                webServer->send(200, "application/json", status);
+            } else {
+                webServer->send(404, "application/json", "{}");
+            }
+        });
+
+        // aggregated values of a channel, e.g. /api/aggregate?channel=0&from=1679958000&to=1680044400
+        webServer->on("/api/aggregate", [this]() {
+            QEMSAggregate result;
+            uint8_t channel = webServer->arg("channel").toInt();
+            if (channel >= _dataManager->getChannelCount() ||
+                !_dataManager->getAggregate(channel, webServer->arg("from").toInt(), webServer->arg("to").toInt(), result)) {
+                webServer->send(404, "application/json", "{}");
+                return;
+            }
+
+            webServer->send(200, "application/json", toJson(result));
         });
 
+        // aggregated values of a channel of today and the current week up to now and their accumulated savings in percent hours, e.g. /api/totals?channel=0
+        webServer->on("/api/totals", [this]() {
+            QEMSAggregate today;
+            QEMSAggregate week;
+            uint8_t channel = webServer->arg("channel").toInt();
+            if (channel >= _dataManager->getChannelCount() || !_dataManager->getRunningTotals(channel, today, week)) {
+                webServer->send(404, "application/json", "{}");
+                return;
+            }
+
+            webServer->send(200, "application/json",
+                            String("{\"today\":") + toJson(today) + String(",\"week\":") + toJson(week) + String(",\"todayPercentHours\":") +
+                                QEMSRunningTotals::getPercentHours(today) + String(",\"weekPercentHours\":") + QEMSRunningTotals::getPercentHours(week) +
+                                String("}"));
+        });
+
+        // records of a channel in a time range, e.g. /api/records?channel=0&from=1679958000&to=1679961600, at most API_MAX_RECORDS per request
+        webServer->on("/api/records", [this]() {
+            uint8_t channel = webServer->arg("channel").toInt();
+            if (channel >= _dataManager->getChannelCount()) {
+                webServer->send(404, "application/json", "{}");
+                return;
+            }
+
+            time_t times[API_MAX_RECORDS];
+            float values[API_MAX_RECORDS];
+            uint16_t count = _dataManager->getRecords(channel, webServer->arg("from").toInt(), webServer->arg("to").toInt(), times, values, API_MAX_RECORDS);
+
+            String response = "{\"records\":[";
+            for (uint16_t i = 0; i < count; i++) {
+                response += (i > 0 ? String(",[") : String("[")) + (uint32_t)times[i] + String(",") + String(values[i], 2) + String("]");
+            }
+            webServer->send(200, "application/json", response + String("]}"));
+        });
+
+        // counters of the cache for records that are not loaded
+        webServer->on("/api/cache", [this]() {
+            QEMSCacheStatistics statistics;
+            if (!_dataManager->getCacheStatistics(statistics)) {
+                webServer->send(404, "application/json", "{}");
+                return;
+            }
+
+            webServer->send(200, "application/json",
+                            String("{\"hits\":") + statistics.hits + String(",\"misses\":") + statistics.misses + String(",\"prefetches\":") +
+                                statistics.prefetches + String(",\"evictions\":") + statistics.evictions + String(",\"pages\":") + statistics.pages +
+                                String("}"));
+        });
+
+        // sets the replay clock, e.g. /replay?start=29.03.2023 06:00:00&speed=60, /replay?speed=0 to pause it or /replay?stop to return to the real time
+        webServer->on("/replay", [this]() { replay(); });
+
+        // the time the data is shown for
+        webServer->on("/api/clock", [this]() { sendClock(); });
+
+        // resources of the device, the minimum free heap since boot shows the peak memory usage, e.g. of loading a large data file
+        webServer->on("/api/status", [this]() {
+            webServer->send(200, "application/json",
+                            String("{\"uptime\":") + millis() + String(",\"heap\":") + ESP.getFreeHeap() + String(",\"minHeap\":") + ESP.getMinFreeHeap() +
+                                String(",\"maxAlloc\":") + ESP.getMaxAllocHeap() + String(",\"fsUsed\":") + LittleFS.usedBytes() +
+                                String(",\"fsTotal\":") + LittleFS.totalBytes() + String(",\"ready\":") + (_dataManager->isReady() ? "true" : "false") +
+                                String("}"));
+        });
+
+        // appends records to the data file of a channel, e.g. POST /api/series/0/append with the lines "dd.mm.yyyy HH:MM:SS;value" as body
+        webServer->on(UriBraces("/api/series/{}/append"), HTTP_POST, [this]() { append(webServer->pathArg(0)); });
+
         webServer->on(
             "/upload", HTTP_POST, [this]() { webServer->sendHeader("Connection", "close"); }, [this]() { upload(); });
 
@@ -52,15 +166,36 @@ class QEMSWebServer {
     bool isUploadInProgress() { return uploadInProgress; };
 
   private:
-    QEMSDataManager *_costManager;
+    /**
+     * Provides the data of all channels, updated when one of its files is uploaded.
+     */
+    QEMSDataSource *_dataManager;
 
-    QEMSDataManager *_co2Manager;
+    /**
+     * Provides the time the data is shown for, set to a replay clock by /replay.
+     */
+    QEMSTimeManager *_timeManager;
+
+    /**
+     * Executes the long running file system operations in the background.
+     */
+    QEMSJobQueue *_jobQueue;
 
     /**
      * The actual webserver.
      */
     WebServer *webServer;
 
+    /**
+     * Index of the available files, used to render the file list and to resolve requested files without accessing the file system.
+     */
+    QEMSFileIndex _fileIndex;
+
+    /**
+     * If the file system could be read to build the index, the page shows an error until it was rebuilt by /reindex.
+     */
+    bool _indexAvailable = false;
+
     /**
      * Tries to stream the passed path as a plain text file to the client.
      */
@@ -68,6 +203,11 @@ class QEMSWebServer {
 
         path.toLowerCase();
 
+        if (!_fileIndex.exists(path.substring(1))) { // file was not found
+            webServer->send(404, "text/plain", "");
+            return;
+        }
+
         File dataFile = LittleFS.open(path.c_str());
 
         if (!dataFile) // file was not found, do nothing
@@ -86,23 +226,181 @@ class QEMSWebServer {
     void format() {
         Serial.print("Format FS");
         LittleFS.format();
+        _fileIndex.clear();
 
         File initFile = LittleFS.open(String("/version.txt").c_str(), FILE_WRITE);
         initFile.write((const uint8_t *)String("1.0.0").c_str(), 5);
         initFile.close();
+        _fileIndex.put("version.txt", 5, time(nullptr), esp_rom_crc32_le(0, (const uint8_t *)"1.0.0", 5));
+        _indexAvailable = true;
     }
 
     /**
      * Deletes a file from the file System
      */
-    void deleteFile(String name) {
+    bool deleteFile(String name) {
         Serial.print("Delete ");
         Serial.println(name);
-        LittleFS.remove((String("/") + name).c_str());
+        if (!LittleFS.remove((String("/") + name).c_str())) {
+            return false;
+        }
+
+        for (const char *suffix : SIDECAR_SUFFIXES) {
+            LittleFS.remove((String("/") + name + suffix).c_str());
+        }
+
+        _fileIndex.remove(name);
+
+        // the records of a deleted data file must not be shown any longer, the reload fails and the upload screen is shown
+        if (_dataManager->usesFile(String("/") + name)) {
+            _dataManager->loadDataFromFile();
+        }
+        return true;
+    }
+
+    /**
+     * Rebuilds the file index and reloads the data manager from its files without interrupting the display.
+     */
+    bool reindex(QEMSJobQueue::Job &job) {
+        _indexAvailable = _fileIndex.build();
+        job.progress = 50;
+
+        if (!_dataManager->prepareUpdate("", "")) {
+            return false;
+        }
+
+        _dataManager->commitUpdate();
+        return _indexAvailable;
+    }
+
+    /**
+     * Sets the replay clock to the passed start, either an epoch timestamp or in the format of the data files, and speed. Without start the replay clock
+     * continues from the time currently shown, without speed it runs in real time.
+     */
+    void replay() {
+        if (webServer->hasArg("stop")) {
+            _timeManager->stopReplay();
+            sendClock();
+            return;
+        }
+
+        String startArg = webServer->arg("start");
+        time_t start = _timeManager->now();
+        bool valid = true;
+        if (startArg.indexOf('.') >= 0) {
+            valid = QEMSCsvParser::parseTime(startArg, start);
+        } else if (startArg.length() > 0) {
+            start = startArg.toInt();
+            valid = start >= MIN_VALID_TIME;
+        }
+        if (!valid) {
+            webServer->send(400, "text/plain", "Invalid start, expected epoch timestamp or dd.mm.yyyy HH:MM:SS");
+            return;
+        }
+
+        long speed = webServer->hasArg("speed") ? webServer->arg("speed").toInt() : 1;
+        if (speed < 0 || speed > UINT16_MAX) {
+            webServer->send(400, "text/plain", "Invalid speed");
+            return;
+        }
+
+        _timeManager->startReplay(start, speed);
+        sendClock();
+    }
+
+    static String toJson(QEMSAggregate &aggregate) {
+        return String("{\"count\":") + aggregate.count + String(",\"min\":") + aggregate.min + String(",\"max\":") + aggregate.max +
+               String(",\"mean\":") + aggregate.mean + String(",\"sum\":") + aggregate.sum + String("}");
+    }
+
+    /**
+     * Sends the time the data is shown for and the state of the replay clock.
+     */
+    void sendClock() {
+        webServer->send(200, "application/json",
+                        String("{\"now\":") + (uint32_t)_timeManager->now() + String(",\"replay\":") + (_timeManager->isReplay() ? "true" : "false") +
+                            String(",\"speed\":") + _timeManager->getReplaySpeed() + String("}"));
+    }
+
+    /**
+     * Appends the records of the request body to the segment of the data file of a channel. The segment is merged into the data file in the background once
+     * it exceeds SEGMENT_COMPACT_SIZE.
+     */
+    void append(String channelArg) {
+        uint8_t channel = channelArg.toInt();
+        String records = webServer->arg("plain");
+
+        if (channelArg.length() == 0 || !isDigit(channelArg.charAt(0)) || channel >= _dataManager->getChannelCount()) {
+            webServer->send(404, "application/json", "{}");
+            return;
+        }
+
+        // an upload or a background job, e.g. a running compaction, may replace the data file
+        if (uploadInProgress || _jobQueue->isBusy()) {
+            webServer->send(503, "text/plain", "Data file is being updated");
+            return;
+        }
+
+        if (!_dataManager->appendRecords(channel, records)) {
+            webServer->send(400, "text/plain", "Invalid records");
+            return;
+        }
+
+        String path = _dataManager->getFileName(channel) + SEGMENT_SUFFIX;
+        File segment = LittleFS.open(path.c_str());
+        size_t size = segment ? segment.size() : 0;
+        segment.close();
+
+        uint32_t jobId = 0;
+        if (size >= SEGMENT_COMPACT_SIZE) {
+            jobId = _jobQueue->enqueue(String("compact ") + path.substring(1), [this, channel](QEMSJobQueue::Job &job) {
+                return _dataManager->compactSegment(channel);
+            });
+        }
+
+        webServer->send(200, "application/json", String("{\"segment\":") + size + String(",\"job\":") + jobId + String("}"));
+    }
+
+    /**
+     * Answers a request that started a background job with a redirect to the file list, the job id is passed as header.
+     */
+    void sendJobRedirect(uint32_t jobId) {
+        if (jobId == 0) {
+            webServer->send(503, "text/plain", "Too many pending jobs");
+            return;
+        }
+
+        webServer->sendHeader("X-Job-Id", String(jobId));
+        webServer->sendHeader("Location", String("/"), true);
+        webServer->send(302, "text/plain", "");
     }
 
     bool uploadInProgress = false;
-    File uploadFile;
+
+    /**
+     * Write combining buffer for the file that is currently uploaded.
+     */
+    QEMSBlockWriter uploadWriter;
+
+    /**
+     * Decompresses gzip compressed uploads (*.gz) on the fly into the upload writer.
+     */
+    QEMSGzipInflater uploadInflater;
+
+    /**
+     * If the current upload is gzip compressed.
+     */
+    bool uploadCompressed = false;
+
+    /**
+     * Start of the current upload, used to log the upload throughput.
+     */
+    unsigned long uploadStart = 0;
+
+    /**
+     * The file that is replaced by the current upload. The data is written to a temporary file next to it and only renamed when the upload is complete.
+     */
+    String uploadPath;
 
     /**
      * Handles the upload of a new data file.
@@ -110,91 +408,229 @@ class QEMSWebServer {
     void upload() {
         HTTPUpload &upload = webServer->upload();
 
-        if (uploadInProgress == false) {
-            uploadInProgress = true;
+        if (upload.status == UPLOAD_FILE_START) {
             String name = String(upload.filename);
             name.toLowerCase();
-            uploadFile = LittleFS.open((String("/") + name).c_str(), FILE_WRITE);
+            Serial.printf("Started file upload of [%s]...\n", name.c_str());
 
-            if (!uploadFile) {
-                Serial.println("failed to open file for writing");
+            // a running job may format the file system or reload the data managers
+            if (_jobQueue->isBusy()) {
+                Serial.println("Background job in progress, reject upload");
                 uploadInProgress = false;
                 return;
             }
+
+            // LittleFS cannot preallocate files, so at least reject uploads that will not fit before anything is written. The usage is read from the file
+            // system, the file index is not updated by jobs and appends that changed files since it was built. The content length of a compressed upload is
+            // less than the file it is decompressed to, so the decompressed bytes are limited to the free space while they are written.
+            size_t expectedBytes = webServer->clientContentLength();
+            size_t usedBytes = LittleFS.usedBytes();
+            size_t totalBytes = LittleFS.totalBytes();
+            if (usedBytes > totalBytes || expectedBytes > totalBytes - usedBytes) {
+                Serial.printf("Upload of %d bytes does not fit into the file system\n", expectedBytes);
+                uploadInProgress = false;
+                return;
+            }
+
+            // compressed files are stored decompressed without the .gz extension
+            uploadCompressed = name.endsWith(".gz");
+            uploadPath = String("/") + (uploadCompressed ? name.substring(0, name.length() - 3) : name);
+            uploadInProgress = uploadWriter.open(getTempPath(uploadPath));
+            uploadStart = millis();
+
+            if (!uploadInProgress) {
+                Serial.println("failed to open file for writing");
+            } else if (uploadCompressed && !uploadInflater.begin(&uploadWriter, totalBytes - usedBytes)) {
+                uploadWriter.abort();
+                LittleFS.remove(getTempPath(uploadPath).c_str());
+                uploadInProgress = false;
+            }
+            return;
         }
 
-        /*
-                Serial.print("Try to store: ");
-                Serial.print(upload.currentSize);
-                Serial.print(" of ");
-                Serial.print(upload.totalSize);
-                Serial.print(" bytes; status = ");
-                Serial.print(upload.status);
-                Serial.print(" -> ");
-                */
+        if (!uploadInProgress) { // the upload failed before, ignore the remaining data
+            if (upload.status == UPLOAD_FILE_END) {
+                webServer->send(500, "text/plain", "Upload failed");
+            }
+            return;
+        }
 
         if (upload.status == UPLOAD_FILE_WRITE) {
-            size_t writtenBytes = uploadFile.write(upload.buf, upload.currentSize);
-
-            if (writtenBytes != upload.currentSize) {
-                Serial.printf("%d - failed to write\n", writtenBytes);
+            bool written = uploadCompressed ? uploadInflater.write(upload.buf, upload.currentSize)
+                                            : uploadWriter.write(upload.buf, upload.currentSize) == upload.currentSize;
+
+            if (!written) {
+                if (uploadCompressed) {
+                    uploadInflater.end();
+                }
+                uploadWriter.abort();
+                LittleFS.remove(getTempPath(uploadPath).c_str());
                 uploadInProgress = false;
                 return;
             }
 
         } else if (upload.status == UPLOAD_FILE_END) {
-            uploadFile.close();
-            Serial.printf("End file upload, remaining usage %d / %d bytes\n", LittleFS.usedBytes(), LittleFS.totalBytes());
+            bool complete = !uploadCompressed || uploadInflater.end();
+
+            if (!uploadWriter.close() || !complete) {
+                LittleFS.remove(getTempPath(uploadPath).c_str());
+                uploadInProgress = false;
+                webServer->send(500, "text/plain", "Upload failed");
+                return;
+            }
+
+            // bytes per millisecond converted to KB per second
+            unsigned long duration = max(millis() - uploadStart, 1UL);
+            uint32_t throughput = (uint64_t)upload.totalSize * 1000 / 1024 / duration;
+            Serial.printf("End file upload, %d bytes received, %d bytes in %d blocks with %d KB/s, remaining usage %d / %d bytes\n", upload.totalSize,
+                          uploadWriter.getWrittenBytes(), uploadWriter.getBlockCount(), throughput, LittleFS.usedBytes(), LittleFS.totalBytes());
+
+            String path = uploadPath;
+            size_t size = uploadWriter.getWrittenBytes();
+            uint32_t crc = uploadWriter.getCrc();
+            uploadInProgress = false;
+
+            // data files are validated and loaded in the background, the client follows the job id. Further uploads are rejected while the job is pending.
+            if (_dataManager->usesFile(path)) {
+                uint32_t jobId = _jobQueue->enqueue(String("activate ") + path.substring(1), [this, path, size, crc](QEMSJobQueue::Job &job) {
+                    return activateUpload(path, size, crc);
+                });
+                if (jobId == 0) {
+                    removeUpload(path);
+                }
+                sendJobRedirect(jobId);
+                return;
+            }
+
+            if (!activateUpload(path, size, crc)) {
+                webServer->send(500, "text/plain", "Upload failed");
+                return;
+            }
 
             webServer->sendHeader("Location", String("/"), true);
             webServer->send(302, "text/plain", "");
+        } else if (upload.status == UPLOAD_FILE_ABORTED) {
+            Serial.println("File upload aborted");
+            if (uploadCompressed) {
+                uploadInflater.end();
+            }
+            uploadWriter.abort();
+            LittleFS.remove(getTempPath(uploadPath).c_str());
+            uploadInProgress = false;
+        }
+    }
+
+    /**
+     * Returns the temporary file an upload for the passed path is written to.
+     */
+    String getTempPath(String path) { return path + String(".tmp"); }
+
+    /**
+     * Removes the temporary file of an upload that was not activated together with the index and aggregates created during its validation.
+     */
+    void removeUpload(String path) {
+        LittleFS.remove(getTempPath(path).c_str());
+        for (const char *suffix : SIDECAR_SUFFIXES) {
+            LittleFS.remove((getTempPath(path) + suffix).c_str());
+        }
+    }
+
+    /**
+     * Replaces the target file of a finished upload with the temporary file, an invalid upload is removed. Data files are validated and loaded by the data
+     * manager before, the manager switches to the new records only after the file was replaced, so it never reads a partial file.
+     * @param path the uploaded file
+     * @param size the size of the written file
+     * @param crc the checksum of the written file
+     */
+    bool activateUpload(String path, size_t size, uint32_t crc) {
+        if (!replaceUpload(path, size, crc)) {
+            removeUpload(path);
+            return false;
+        }
+        return true;
+    }
 
-            if ((String("/") + String(upload.filename)) == _co2Manager->getFileName()) {
-                _co2Manager->loadDataFromFile();
+    /**
+     * Validates the temporary file of an upload and renames it to the target file, see activateUpload().
+     */
+    bool replaceUpload(String path, size_t size, uint32_t crc) {
+        String tempPath = getTempPath(path);
+        bool dataFile = _dataManager->usesFile(path);
+
+#ifdef QEMS_COMPRESS_DATA
+        // CSV data files are stored as compressed series, already compressed uploads are kept as they are
+        QEMSSeriesWriter series;
+        File uploaded = LittleFS.open(tempPath.c_str());
+        bool compressed = uploaded && QEMSCompressedSeries::isCompressed(uploaded);
+        uploaded.close();
+        if (dataFile && !compressed) {
+            if (!series.convert(tempPath)) {
+                return false;
             }
+            size = series.getWrittenBytes();
+            crc = series.getCrc();
+        }
+#endif
 
-            if ((String("/") + String(upload.filename)) == _costManager->getFileName()) {
-                _costManager->loadDataFromFile();
+        if (dataFile && !_dataManager->prepareUpdate(path, tempPath)) {
+            return false;
+        }
+
+        // LittleFS replaces an existing target atomically, so either the old or the new file is available after a power loss.
+        if (!LittleFS.rename(tempPath.c_str(), path.c_str())) {
+            Serial.printf("Cannot rename [%s] to [%s]\n", tempPath.c_str(), path.c_str());
+            if (dataFile) {
+                _dataManager->discardUpdate();
             }
+            return false;
+        }
 
-            uploadInProgress = false;
-        } else {
-            Serial.printf("Started file upload of [%s]...\n", String(upload.filename));
+        if (dataFile) {
+            // the index and aggregates created during the validation are renamed after the data file, files that do not match their data file are
+            // ignored on load.
+            for (const char *suffix : SIDECAR_SUFFIXES) {
+                if (!LittleFS.rename((tempPath + suffix).c_str(), (path + suffix).c_str())) {
+                    LittleFS.remove((path + suffix).c_str());
+                }
+            }
+            _dataManager->commitUpdate();
         }
+
+        _fileIndex.put(path.substring(1), size, time(nullptr), crc);
+        return true;
     }
 
     /**
      * Creates the web page that is rendered when the server receives a GET to the root /. The page displays available files and allows to upload new ones.
      */
     String createWebPage() {
-        File root = LittleFS.open("/");
-
-        if (!root) {
-            Serial.println("ERROR: Cannot open file system...try to perform a format !!!");
-            LittleFS.format();
-            return "ERROR: Cannot open file system...try to perform a format !!!";
+        // the data is kept, the index is rebuilt by the reindex job or the file system is formatted on request
+        if (!_indexAvailable) {
+            Serial.println("ERROR: File index unavailable");
+            return "<b>ERROR: File index unavailable.</b></br></br>&nbsp&nbsp&nbsp&nbsp<a href='reindex'>[reindex]</a>&nbsp&nbsp<a href='format'>[format]</a>"
+                   "&nbsp&nbsp(all data will be deleted)&nbsp&nbsp<a href='jobs'>[jobs]</a>";
         }
 
         String response = "";
 
-        // no support for directories in this simple demo application
-        while (true) {
-            File entry = root.openNextFile();
-            if (!entry) {
-                // no more files
-                break;
-            }
+        for (const QEMSFileIndex::Entry &entry : _fileIndex.getEntries()) {
+            char modified[20];
+            struct tm ts;
+            localtime_r(&entry.modified, &ts);
+            strftime(modified, sizeof(modified), "%d.%m.%Y %H:%M:%S", &ts);
 
-            response += String("&nbsp&nbsp&nbsp&nbsp&nbsp*&nbsp<a href='") + String(entry.name()) + String("'>") + String(entry.name()) +
-                        String("</a>&nbsp&nbsp&nbsp&nbsp");
-            response += String("<a href='delete?file=") + String(entry.name()) + String("'>[delete]</a>") + String("</br>");
+            char crc[9];
+            snprintf(crc, sizeof(crc), "%08x", entry.crc);
 
-            entry.close();
+            response += String("&nbsp&nbsp&nbsp&nbsp&nbsp*&nbsp<a href='") + entry.name + String("'>") + entry.name + String("</a>&nbsp&nbsp") + entry.size +
+                        String(" bytes, ") + modified + String(", crc ") + crc + String("&nbsp&nbsp&nbsp&nbsp");
+            response += String("<a href='delete?file=") + entry.name + String("'>[delete]</a>") + String("</br>");
         }
 
-        String s = String("<b>Available files </b>:</br>") + response + String("</br></br><b>Usage:</b></br></br>&nbsp&nbsp&nbsp&nbsp") + LittleFS.usedBytes() +
-                   String(" / ") + LittleFS.totalBytes() +
-                   String("&nbsp&nbsp&nbsp&nbsp<a href='format'>[format]</a>&nbsp&nbsp(all data will be deleted)</br></br>") +
+        String s = String("<b>Available files </b>:</br>") + response + String("</br></br><b>Usage:</b></br></br>&nbsp&nbsp&nbsp&nbsp") +
+                   _fileIndex.getUsedBytes() + String(" / ") + _fileIndex.getTotalBytes() +
+                   String("&nbsp&nbsp&nbsp&nbsp<a href='format'>[format]</a>&nbsp&nbsp(all data will be deleted)&nbsp&nbsp<a href='reindex'>[reindex]</a>") +
+                   String("&nbsp&nbsp<a href='jobs'>[jobs]</a></br></br>") + replayForm +
                    String("<b>Upload file:</b> </br>&nbsp&nbsp&nbsp&nbsp") + uploadScript;
 
         Serial.print("Generated Response: ");
@@ -202,6 +638,13 @@ class QEMSWebServer {
         return s;
     }
 
+    /**
+     * Form to set the replay clock, see replay().
+     */
+    String replayForm = "<b>Replay:</b></br>&nbsp&nbsp&nbsp&nbsp<form action='replay' style='display:inline'>"
+                        "start <input name='start' placeholder='dd.mm.yyyy HH:MM:SS'> speed (0 pauses) <input name='speed' value='60' size='5'> "
+                        "<input type='submit' value='Start'></form>&nbsp&nbsp<a href='replay?stop'>[real time]</a>&nbsp&nbsp<a href='api/clock'>[clock]</a></br></br>";
+
     /**
      * JS script for the file upload.
      */
@@ -212,7 +655,7 @@ class QEMSWebServer {
                           "</form>"
                           "<div id='prg'>progress: 0%</div>"
                           "<script>"
-                          "$('form').submit(function(e){"
+                          "$('#upload_form').submit(function(e){"
                           "e.preventDefault();"
                           "var form = $('#upload_form')[0];"
                           "var data = new FormData(form);"
@@ -12,11 +12,11 @@ QEMSWiFiManager::QEMSWiFiManager(char const *apName, std::function<void(WiFiMana
     const char *menu[] = {"wifi", "exit"};
 
     setHostname("qems");
-    // setConfigPortalBlocking(false);
+    setConfigPortalBlocking(false);
     //   wifiManager.setConfigPortalTimeout(300);
     //  setCaptivePortalEnable(true);
-    setConnectTimeout(20);
-    setSaveConnectTimeout(20);
+    setConnectTimeout(WIFI_CONNECT_TIMEOUT);
+    setSaveConnectTimeout(WIFI_CONNECT_TIMEOUT);
     setDarkMode(true);
     setShowInfoUpdate(false);
     setMenu(menu, 2);
@@ -29,17 +29,41 @@ QEMSWiFiManager::QEMSWiFiManager(char const *apName, std::function<void(WiFiMana
 };
 
 void QEMSWiFiManager::connect() {
-    bool res = autoConnect(_apName);
+    WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info) { _connected = true; }, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info) { _connected = false; }, ARDUINO_EVENT_WIFI_STA_LOST_IP);
 
-    if (res) {
+    _connectStart = millis();
+    if (getWiFiIsSaved()) {
+        WiFi.begin();
+    } else {
+        _connectStart -= WIFI_CONNECT_TIMEOUT * 1000; // start the portal right away
+    }
+};
+
+void QEMSWiFiManager::update() {
+    if (_connected && !_notified) {
+        if (_portalActive) {
+            stopConfigPortal();
+            _portalActive = false;
+        }
 
         Serial.println("");
         Serial.println("WiFi connected");
         Serial.println("IP address: ");
         Serial.println(WiFi.localIP());
+        _notified = true;
         _connectedCallback(this);
-    } else {
+    }
+
+    // the portal is only started once, it keeps running until the device is configured
+    if (!_connected && !_portalActive && !_notified && millis() - _connectStart > WIFI_CONNECT_TIMEOUT * 1000) {
         Serial.println("");
-        Serial.println("CANNOT connect to WiFi");
+        Serial.println("CANNOT connect to WiFi, start configuration portal");
+        startConfigPortal(_apName);
+        _portalActive = true;
     }
-};
+
+    if (_portalActive) {
+        process();
+    }
+};
\ No newline at end of file
@@ -3,6 +3,11 @@
 
 #include <WiFiManager.h>
 
+/**
+ * Seconds to wait for the connection to the stored network before the configuration portal is started.
+ */
+#define WIFI_CONNECT_TIMEOUT 20
+
 /**
  * Extension to the WiFiManager class with some default configuration used in multiple projects.
  *
@@ -20,10 +25,26 @@ class QEMSWiFiManager : public WiFiManager {
     QEMSWiFiManager(char const *apName, std::function<void(WiFiManager *)> configCallback, std::function<void(WiFiManager *)> connectedCallback);
 
     /**
-     * Performs the connection or starts a network to configure the device
+     * Starts connecting to the stored WiFi network, returns immediately. The connection is established in the background, see update().
      */
     void connect();
 
+    /**
+     * Drives the connection, has to be called periodically. Starts the non-blocking configuration portal if the connection could not be established within
+     * the connect timeout and triggers the connected callback once the device got an IP address.
+     */
+    void update();
+
+    /**
+     * Returns true when the device is connected and got an IP address.
+     */
+    bool isConnected() { return _connected; }
+
+    /**
+     * Returns true while the configuration portal is running.
+     */
+    bool isPortalActive() { return _portalActive; }
+
   private:
     /**
      * The access point name to use for the portal in case no connection could be established
@@ -34,6 +55,26 @@ class QEMSWiFiManager : public WiFiManager {
      * Callback triggered, when the connection was successfully established.
      */
     std::function<void(WiFiManager *)> _connectedCallback;
+
+    /**
+     * Set by the WiFi event handler when the device got an IP address.
+     */
+    volatile bool _connected = false;
+
+    /**
+     * If the connected callback was triggered for the current connection.
+     */
+    bool _notified = false;
+
+    /**
+     * If the configuration portal is running.
+     */
+    bool _portalActive = false;
+
+    /**
+     * Start of the connection attempt in ms.
+     */
+    unsigned long _connectStart = 0;
 };
 
 
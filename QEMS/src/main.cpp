@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include <QEMSDataManager.h>
 #include <QEMSDisplay.h>
+#include <QEMSMappedDataManager.h>
 #include <QEMSTimeManager.h>
 #include <QEMSUI.h>
 #include <QEMSWebServer.h>
@@ -8,8 +9,11 @@
 
 #define FORMAT_LITTLEFS_IF_FAILED true
 
-QEMSDataManager *dataManagerCO2;
-QEMSDataManager *dataManagerCost;
+#if defined(QEMS_COMPRESS_DATA) && defined(QEMS_MMAP_PARTITION)
+#error "The memory mapped data manager reads CSV data files only"
+#endif
+
+QEMSDataSource *dataManager;
 QEMSTimeManager *timeManager;
 QEMSWebServer *webServer;
 
@@ -17,43 +21,66 @@ TaskHandle_t uiTask;
 TaskHandle_t loadDataTask;
 TaskHandle_t webServerTask;
 
+uint8_t co2Channel;
+uint8_t costChannel;
+
 int lastCo2Value = 0;
 int currentCo2Value = 0;
 int lastCostValue = 0;
 int currentCostValue = 0;
+unsigned long lastHistoryUpdate = 0;
+unsigned long lastRetention = 0;
+bool firstValueShown = false;
+bool clockSynchronized = false;
+uint32_t clockJumps = 0;
+
+/**
+ * @brief logs the end of a boot phase with the time since boot, used to measure the startup.
+ */
+void logBootPhase(const char *phase) { Serial.printf("Boot phase [%s] finished after %lu ms\n", phase, millis()); }
 
 void loadDataTaskCode(void *parameter) {
     for (;;) {
 
-        if (!dataManagerCO2 || !dataManagerCost) {
+        if (!dataManager) {
             delay(1000);
             continue;
         }
 
-        // if no data is available, the upload screen is shown
-        if (!dataManagerCO2->isFileAvailable() || !dataManagerCost->isFileAvailable()) {
+        // if no data is available, the upload screen is shown, or the portal information while the WiFi is not configured
+        if (!dataManager->isFileAvailable()) {
             // Serial.println("No valid file available, switch to upload mode...");
-            nextScreen = ui_Screen_Upload;
+            nextScreen = wifiManager && wifiManager->isPortalActive() ? ui_Screen_WiFi : ui_Screen_Upload;
             delay(1000);
             continue;
         }
 
+        // the records to show depend on the current time, without a persisted estimate the first SNTP synchronization is awaited
+        if (!timeManager->isValid()) {
+            delay(100);
+            continue;
+        }
+
+        // the loaded records may not cover the time the replay clock jumped to, e.g. when it was set back before the first one
+        bool jumped = timeManager->getJumps() != clockJumps;
+        clockJumps = timeManager->getJumps();
+
         // perform the reload of new data values, this is done here to avoid blocking the UI task.
-        if (!dataManagerCO2->isReady() || !dataManagerCost->isReady()) {
+        if (!dataManager->isReady() || jumped) {
             // Serial.println("Data manager not ready, try to reload data...");
 
-            lv_label_set_text(ui_S1L_Info, "Lade CO2 Daten...");
+            lv_label_set_text(ui_S1L_Info, "Lade CO2 und Kostendaten...");
             nextScreen = ui_Screen_Loading;
 
-            dataManagerCO2->loadDataFromFile();
-
-            lv_label_set_text(ui_S1L_Info, "Lade Kostendaten...");
-            dataManagerCost->loadDataFromFile();
+            dataManager->loadDataFromFile();
 
             nextScreen = ui_Screen_Data;
             delay(200);
         }
 
+        // the running totals read the aggregates of the data files after other records were loaded or committed, the UI task only adds the passed records
+        dataManager->restartTotals();
+
         delay(1000);
     }
 }
@@ -64,7 +91,7 @@ void loadDataTaskCode(void *parameter) {
 void uiTaskCode(void *parameter) {
     for (;;) {
 
-        if (webServer && timeManager && dataManagerCO2 && dataManagerCost) { // ensure that the pointers were initialized
+        if (timeManager && dataManager && timeManager->isValid()) { // ensure that the pointers were initialized and the clock is set
 
             // Update the time values on the display
 
@@ -78,10 +105,17 @@ void uiTaskCode(void *parameter) {
             lv_label_set_text(ui_S2L_Date, date);
 
             // The UI is already used during startup. To avoid access to uninitialized classes we need to check them here beforee updating anything
-            if (dataManagerCO2->isReady() && dataManagerCost->isReady()) {
+            // The values are only read again when the active record ended or new records were loaded.
+            if (dataManager->isReady() && dataManager->waitForChange(0)) {
+
+                int values[MAX_CHANNELS];
+                if (dataManager->getActiveValues(values) && !firstValueShown) {
+                    firstValueShown = true;
+                    logBootPhase("first value");
+                }
 
                 lastCo2Value = currentCo2Value;
-                currentCo2Value = dataManagerCO2->getActiveValue();
+                currentCo2Value = values[co2Channel];
 
                 if (lastCo2Value != currentCo2Value) {
                     ui_animate_meter_value(co2Indicator, lastCo2Value, currentCo2Value);
@@ -90,7 +124,7 @@ void uiTaskCode(void *parameter) {
                 }
 
                 lastCostValue = currentCostValue;
-                currentCostValue = dataManagerCost->getActiveValue();
+                currentCostValue = values[costChannel];
 
                 if (lastCostValue != currentCostValue) {
                     ui_animate_meter_value(costIndicator, lastCostValue, currentCostValue);
@@ -98,10 +132,22 @@ void uiTaskCode(void *parameter) {
                     Serial.printf("Change Cost Meter from [%d] to [%d]\n", lastCostValue, currentCostValue);
                 }
 
+                // the totals were advanced by getActiveValues(), reading them needs no access to the records
+                ui_totals_update(dataManager, co2Channel, costChannel);
+
                 // lv_meter_set_indicator_end_value(meter, co2Indicator, dataManager->getActiveValue());
             }
         }
 
+        // The history chart only changes when a chart point moved into the displayed range, so it is checked once per second.
+        if (lv_scr_act() == ui_Screen_History && dataManager && dataManager->isReady() && millis() - lastHistoryUpdate >= 1000) {
+            ui_history_update(dataManager, co2Channel, costChannel, timeManager->now());
+            lastHistoryUpdate = millis();
+        }
+
+        // loading data in parallel to a running animation would let the animation stutter
+        QEMSParallelParser::setBackoff(lv_anim_count_running() > 0);
+
         if (nextScreen && lv_scr_act() != nextScreen) {
             lv_scr_load_anim(nextScreen, LV_SCR_LOAD_ANIM_NONE, 0, 0, false);
         }
@@ -144,39 +190,79 @@ void setup() {
     } else {
         Serial.printf("File system mounted %d / %d ...\n", LittleFS.usedBytes(), LittleFS.totalBytes());
     }
+    logBootPhase("file system");
 
     // Display and UI setup
     // ----------------------------------------------------------------------------------------------------------------
 
+    jobQueue = new QEMSJobQueue();
+
     ui_disp_init();
     ui_qems_init();
     xTaskCreatePinnedToCore(uiTaskCode, "UItask", 10000, NULL, 2, NULL, tskNO_AFFINITY);
 
-    // WiFi Setup
-    // ----------------------------------------------------------------------------------------------------------------
-
     lv_label_set_text(ui_S1L_Info, "Verbindung zum WiFI Netzwerk\nwird hergestellt...");
-    wifiManager = new QEMSWiFiManager(
-        "QEMS Demo", [](WiFiManager *wm) { nextScreen = ui_Screen_WiFi; }, [](WiFiManager *wm) {});
-    lv_label_set_text(ui_S3L_IP_Data, WiFi.localIP().toString().c_str());
-    lv_label_set_text(ui_S5L_IP, WiFi.localIP().toString().c_str());
-    lv_label_set_text(ui_S3L_WiFi_Data, WiFi.SSID().c_str());
     nextScreen = ui_Screen_Loading;
+    logBootPhase("ui");
 
     // Service Setup
     // ----------------------------------------------------------------------------------------------------------------
 
+    // the data is shown from the local files with the persisted clock estimate, the network is not needed for it
     timeManager = new QEMSTimeManager();
-    dataManagerCO2 = new QEMSDataManager(timeManager, "/co2.csv");
-    dataManagerCost = new QEMSDataManager(timeManager, "/costs.csv");
-    webServer = new QEMSWebServer(dataManagerCost, dataManagerCO2);
+#ifdef QEMS_MMAP_PARTITION
+    QEMSDataSource *manager = new QEMSMappedDataManager(timeManager);
+#else
+    QEMSDataSource *manager = new QEMSDataManager<>(timeManager);
+#endif
+    co2Channel = manager->addChannel("/co2.csv");
+    costChannel = manager->addChannel("/costs.csv");
+    dataManager = manager;
 
     xTaskCreatePinnedToCore(loadDataTaskCode, "dataTask", 10000, NULL, 1, NULL, tskNO_AFFINITY);
-    xTaskCreatePinnedToCore(webServerTaskCode, "webServerTask", 10000, NULL, 3, NULL, tskNO_AFFINITY);
+    logBootPhase("data source");
+
+    // WiFi Setup
+    // ----------------------------------------------------------------------------------------------------------------
+
+    // the connection is established in the background by loop(), the web server is started once the network is up
+    wifiManager = new QEMSWiFiManager(
+        "QEMS Demo", [](WiFiManager *wm) { nextScreen = ui_Screen_WiFi; },
+        [](WiFiManager *wm) {
+            lv_label_set_text(ui_S3L_IP_Data, WiFi.localIP().toString().c_str());
+            lv_label_set_text(ui_S5L_IP, WiFi.localIP().toString().c_str());
+            lv_label_set_text(ui_S3L_WiFi_Data, WiFi.SSID().c_str());
+            logBootPhase("network");
+
+            webServer = new QEMSWebServer(dataManager, timeManager, jobQueue);
+            xTaskCreatePinnedToCore(webServerTaskCode, "webServerTask", 10000, NULL, 3, NULL, tskNO_AFFINITY);
+            logBootPhase("web server");
+        });
 }
 
 void loop() {
-    // nothing to do here, relies on the tasks managed by ESP.
-    delay(60000);
-}
+    // setup() returns before the managers are created if the file system cannot be mounted, the WiFi manager is created last
+    if (!wifiManager) {
+        delay(1000);
+        return;
+    }
 
+    // drives the WiFi connection and the configuration portal, the other work is done by the tasks.
+    wifiManager->update();
+    timeManager->saveEstimate();
+
+    if (!clockSynchronized && timeManager->isSynchronized()) {
+        clockSynchronized = true;
+        logBootPhase("clock synchronized");
+    }
+
+    // records older than the retention horizon are dropped in the background, so the data files stay bounded while records are appended. Not during a
+    // replay, its clock may run far ahead of the real time and the records dropped for it would be missing afterwards.
+    if (dataManager->isReady() && !timeManager->isReplay() && (lastRetention == 0 || millis() - lastRetention >= RETENTION_INTERVAL * 1000UL)) {
+        lastRetention = millis();
+        time_t before = timeManager->now() - RETENTION_HORIZON;
+        jobQueue->enqueue("retention", [before](QEMSJobQueue::Job &job) { return dataManager->dropHistory(before); });
+    }
+
+    delay(50);
+}
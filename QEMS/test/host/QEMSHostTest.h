@@ -0,0 +1,237 @@
+#ifndef QEMS_HOST_TEST_H_
+#define QEMS_HOST_TEST_H_
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <QEMSDataSource.h>
+#include <WebServer.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <vector>
+#include <zlib.h>
+
+/**
+ * @brief helpers of the host tests and benchmarks: a file system root per program with copies of the fixture files in assets/, the clock, records read
+ * directly from a CSV file for reference values, synthetic data files, checks and the jobs of the web server.
+ */
+namespace QEMSHostTest {
+
+/**
+ * A record of a data file, read without the parsers of the firmware.
+ */
+struct Record {
+    time_t time;
+    float values[MAX_CHANNELS]; // in percent
+};
+
+inline int &failures() {
+    static int count = 0;
+    return count;
+}
+
+inline bool check(bool condition, const char *expression, const char *file, int line) {
+    if (!condition) {
+        printf("FAILED %s:%d: %s\n", file, line, expression);
+        failures()++;
+    }
+    return condition;
+}
+
+#define CHECK(condition) QEMSHostTest::check((condition), #condition, __FILE__, __LINE__)
+
+/**
+ * @brief prints the result of the checks.
+ * @return the exit code of the program
+ */
+inline int finish() {
+    printf("%s, %d failed checks\n", failures() == 0 ? "PASSED" : "FAILED", failures());
+    return failures() == 0 ? 0 : 1;
+}
+
+/**
+ * @brief returns a monotonic time in microseconds with sub microsecond resolution.
+ */
+inline double nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * @brief sets the time returned by the clock of the firmware.
+ */
+inline void setNow(time_t now) { g_hostNow = now; }
+
+/**
+ * @brief converts a local time "dd.mm.yyyy HH:MM:SS" of the device time zone, see QEMSTimeManager, to an epoch timestamp. Like the timestamps of the data
+ * files are parsed by QEMSCsvParser, the time is taken as standard time.
+ */
+inline time_t at(const char *time) {
+    struct tm ts = {};
+    strptime(time, "%d.%m.%Y %H:%M:%S", &ts);
+    return mktime(&ts);
+}
+
+/**
+ * @brief formats a timestamp like the data files "dd.mm.yyyy HH:MM:SS" in standard time, the inverse of at().
+ */
+inline std::string stamp(time_t time) {
+    time_t local = time - timezone;
+    struct tm ts;
+    gmtime_r(&local, &ts);
+    char result[24];
+    strftime(result, sizeof(result), "%d.%m.%Y %H:%M:%S", &ts);
+    return result;
+}
+
+/**
+ * @brief copies a file of the host file system.
+ */
+inline bool copyFile(const std::string &from, const std::string &to) {
+    std::ifstream in(from, std::ios::binary);
+    std::ofstream out(to, std::ios::binary);
+    out << in.rdbuf();
+    return in.good() && out.good();
+}
+
+/**
+ * @brief empties the file system root "fs" in the working directory and copies the passed fixture files of assets/ into it. The device time zone is set,
+ * the tests run at the time of the fixture data.
+ */
+inline void useFileSystem(std::initializer_list<const char *> assets = {"co2.csv", "costs.csv"}) {
+    configTime(3600, 3600, "");
+    g_hostFsRoot = "fs";
+    ::mkdir(g_hostFsRoot.c_str(), 0755);
+    LittleFS.format();
+    for (const char *asset : assets) {
+        copyFile(std::string(QEMS_ASSETS_DIR) + "/" + asset, g_hostFsRoot + "/" + asset);
+    }
+}
+
+/**
+ * @brief reads the records of a data file "dd.mm.yyyy HH:MM:SS;value[;value...]" with values from 0 to 1.
+ * @param path the path in the file system
+ */
+inline std::vector<Record> readCsv(const char *path) {
+    std::vector<Record> records;
+    std::ifstream in(g_hostFsRoot + path);
+    for (std::string line; std::getline(in, line);) {
+        if (line.size() < 21) {
+            continue;
+        }
+        Record record = {at(line.substr(0, 19).c_str()), {0}};
+        std::stringstream values(line.substr(20));
+        std::string value;
+        for (uint8_t c = 0; c < MAX_CHANNELS && std::getline(values, value, ';'); c++) {
+            std::replace(value.begin(), value.end(), ',', '.');
+            record.values[c] = strtod(value.c_str(), nullptr) * 100;
+        }
+        records.push_back(record);
+    }
+    return records;
+}
+
+/**
+ * @brief writes a synthetic data file with a daily course of the values, like tools/qems_generate_csv.py with its default shape.
+ * @param path the path in the file system
+ * @param records the number of records
+ * @param start the timestamp of the first record
+ * @param interval the seconds between two records
+ * @param columns the number of value columns
+ * @return the size of the file
+ */
+inline size_t writeCsv(const char *path, uint32_t records, time_t start, uint16_t interval = 15, uint8_t columns = 1) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> noise(-0.1, 0.1);
+    FILE *out = fopen((g_hostFsRoot + path).c_str(), "w");
+    for (uint32_t i = 0; i < records; i++) {
+        time_t time = start + (time_t)i * interval;
+        fputs(stamp(time).c_str(), out);
+        for (uint8_t c = 0; c < columns; c++) {
+            double value = 0.5 + 0.4 * sin(2 * M_PI * ((time % 86400) / 86400.0 + c / 7.0)) + noise(rng);
+            fprintf(out, ";%.8f", constrain(value, 0.0, 1.0));
+        }
+        fputc('\n', out);
+    }
+    size_t size = ftell(out);
+    fclose(out);
+    return size;
+}
+
+/**
+ * @brief compresses data to a gzip stream like the gzip tool, with the name of the file in the header if passed.
+ */
+inline std::string gzip(const std::string &data, const char *name = nullptr) {
+    z_stream stream = {};
+    deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY);
+    gz_header header = {};
+    header.name = (Bytef *)name;
+    deflateSetHeader(&stream, &header);
+    std::string result(deflateBound(&stream, data.size()) + (name ? strlen(name) + 1 : 0), '\0');
+    stream.next_in = (Bytef *)data.data();
+    stream.avail_in = data.size();
+    stream.next_out = (Bytef *)&result[0];
+    stream.avail_out = result.size();
+    deflate(&stream, Z_FINISH);
+    result.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result;
+}
+
+/**
+ * @brief reads a file of the host file system.
+ */
+inline std::string readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+/**
+ * @brief returns the value of a "--name=value" argument or the default.
+ */
+inline long argument(int argc, char **argv, const char *name, long defaultValue) {
+    std::string prefix = std::string("--") + name + "=";
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], prefix.c_str(), prefix.size()) == 0) {
+            return atol(argv[i] + prefix.size());
+        }
+    }
+    return defaultValue;
+}
+
+/**
+ * @brief returns the value of a "--name=value" argument or the default.
+ */
+inline std::string argument(int argc, char **argv, const char *name, const char *defaultValue) {
+    std::string prefix = std::string("--") + name + "=";
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], prefix.c_str(), prefix.size()) == 0) {
+            return argv[i] + prefix.size();
+        }
+    }
+    return defaultValue;
+}
+
+/**
+ * @brief waits for the job started by the last request of the web server and returns its final status, empty if it did not finish within 10 s.
+ * @param polls the number of polls every 10 ms
+ */
+inline String waitForJob(WebServer &server, int polls = 1000) {
+    String id = server.getHeader("X-Job-Id");
+    for (int i = 0; i < polls; i++) {
+        server.request(HTTP_GET, "/job", {{"id", id}});
+        String status = server.getContent();
+        if (status.indexOf("\"done\"") >= 0 || status.indexOf("\"failed\"") >= 0) {
+            return status;
+        }
+        delay(10);
+    }
+    return "";
+}
+
+} // namespace QEMSHostTest
+
+#endif
@@ -0,0 +1,87 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+#include <random>
+
+/**
+ * Compares aggregate queries of random ranges over the fixture files, answered from the minute, hour and day buckets of QEMSAggregates, with scanning the
+ * records: once for ranges in the records held in RAM and once for ranges over the complete files, which are partly read through the record cache. Both
+ * must give the same count, minimum, maximum and mean. Arguments: --queries=<number of random ranges per kind>
+ */
+
+using namespace QEMSHostTest;
+
+static time_t records[10000];
+static float values[10000];
+
+/**
+ * @brief aggregates the records of a channel in the range reduced to full minutes, like QEMSAggregates::query().
+ */
+static QEMSAggregate scan(QEMSDataSource &manager, uint8_t channel, time_t from, time_t to) {
+    QEMSAggregate result = {0, 100, 0, 0, 0};
+    uint16_t count = manager.getRecords(channel, (from + 59) / 60 * 60, to / 60 * 60, records, values, 10000);
+    for (uint16_t i = 0; i < count; i++) {
+        result.min = min(result.min, values[i]);
+        result.max = max(result.max, values[i]);
+        result.sum += values[i];
+    }
+    result.count = count;
+    result.mean = count > 0 ? result.sum / count : 0;
+    return result;
+}
+
+/**
+ * @brief queries and scans random ranges between the passed times.
+ */
+static void compare(QEMSDataSource &manager, const char *name, time_t first, time_t last, long queries) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<time_t> time(first, last);
+    double queryUs = 0;
+    double scanUs = 0;
+    uint32_t matched = 0;
+    for (long q = 0; q < queries; q++) {
+        time_t from = time(rng);
+        time_t to = time(rng);
+        if (from > to) {
+            std::swap(from, to);
+        }
+        uint8_t channel = q % 2;
+
+        double start = nowUs();
+        QEMSAggregate aggregate;
+        bool found = manager.getAggregate(channel, from, to, aggregate);
+        queryUs += nowUs() - start;
+
+        start = nowUs();
+        QEMSAggregate expected = scan(manager, channel, from, to);
+        scanUs += nowUs() - start;
+
+        if (expected.count == 0) {
+            continue;
+        }
+        matched += CHECK(found) && CHECK(aggregate.count == expected.count) && CHECK(fabs(aggregate.min - expected.min) < 0.006) &&
+                   CHECK(fabs(aggregate.max - expected.max) < 0.006) && CHECK(fabs(aggregate.mean - expected.mean) < 0.006);
+    }
+
+    printf("RESULT %-6s %ld ranges, %d matched, query %6.1f us, scan %7.1f us\n", name, queries, matched, queryUs / queries, scanUs / queries);
+}
+
+int main(int argc, char **argv) {
+    long queries = argument(argc, argv, "queries", 500);
+
+    useFileSystem();
+    // the window holds the first day of the files, values with a resolution of 0.01% like the aggregates
+    setNow(at("28.03.2023 08:44:00"));
+    QEMSTimeManager timeManager;
+    QEMSDataManager<uint16_t> manager(&timeManager);
+    manager.addChannel("/co2.csv");
+    manager.addChannel("/costs.csv");
+    manager.loadDataFromFile();
+    CHECK(manager.isReady());
+
+    uint16_t loaded = manager.getRecords(0, 0, INT32_MAX, records, values, 5760);
+    std::vector<Record> co2 = readCsv("/co2.csv");
+    compare(manager, "window", records[0], records[loaded - 1], queries);
+    compare(manager, "files", co2.front().time, co2.back().time, queries);
+
+    return finish();
+}
@@ -0,0 +1,82 @@
+#include <QEMSBlockWriter.h>
+#include <QEMSHostTest.h>
+#include <WebServer.h>
+
+/**
+ * Compares writing an upload chunk by chunk, as received by the web server, with staging it in the block sized buffer of QEMSBlockWriter. Prints the
+ * number of write calls that reached the file system and the throughput, once with the page cache of the host and once with every write call synced to the
+ * disk, which is closer to a flash file system programming the data of every call. Arguments: --size=<bytes of the upload> --runs=<repetitions, the best is
+ * shown>
+ */
+
+using namespace QEMSHostTest;
+
+struct Result {
+    size_t writes;
+    double us;
+};
+
+static Result writeChunks(const std::string &data, bool blocks) {
+    size_t writes = g_hostFsWrites;
+    double start = nowUs();
+
+    QEMSBlockWriter writer;
+    File file;
+    if (blocks) {
+        writer.open("/upload.tmp");
+    } else {
+        file = LittleFS.open("/upload.tmp", FILE_WRITE);
+    }
+
+    for (size_t position = 0; position < data.size(); position += HTTP_UPLOAD_BUFLEN) {
+        size_t length = min((size_t)HTTP_UPLOAD_BUFLEN, data.size() - position);
+        if (blocks) {
+            writer.write((const uint8_t *)data.data() + position, length);
+        } else {
+            file.write((const uint8_t *)data.data() + position, length);
+        }
+    }
+
+    if (blocks) {
+        CHECK(writer.close());
+        CHECK(writer.getWrittenBytes() == data.size());
+        CHECK(writer.getBlockCount() == (data.size() + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE);
+        CHECK(writer.getCrc() == esp_rom_crc32_le(0, (const uint8_t *)data.data(), data.size()));
+    } else {
+        file.close();
+    }
+
+    Result result = {g_hostFsWrites - writes, nowUs() - start};
+    File written = LittleFS.open("/upload.tmp");
+    CHECK(written.size() == data.size());
+    CHECK(written.readString().s == data);
+    written.close();
+    return result;
+}
+
+int main(int argc, char **argv) {
+    size_t size = argument(argc, argv, "size", 4 * 1024 * 1024);
+    int runs = argument(argc, argv, "runs", 5);
+
+    useFileSystem({});
+    writeCsv("/source.csv", size / 30 + 1, at("28.03.2023 00:00:00"));
+    File source = LittleFS.open("/source.csv");
+    std::string data = source.readString().s.substr(0, size);
+    source.close();
+
+    printf("%zu bytes in upload chunks of %d bytes, best of %d runs\n", data.size(), HTTP_UPLOAD_BUFLEN, runs);
+    for (bool sync : {false, true}) {
+        g_hostFsSync = sync;
+        for (bool blocks : {false, true}) {
+            Result best = {0, 1e18};
+            for (int run = 0; run < runs; run++) {
+                Result result = writeChunks(data, blocks);
+                best = result.us < best.us ? result : best;
+            }
+            printf("RESULT %-12s %-7s %6zu write calls %9.1f ms %9.0f KB/s\n", blocks ? "block writer" : "per chunk", sync ? "synced" : "cached", best.writes,
+                   best.us / 1000, data.size() / 1024.0 / (best.us / 1e6));
+        }
+    }
+
+    return finish();
+}
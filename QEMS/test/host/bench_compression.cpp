@@ -0,0 +1,104 @@
+#include <QEMSCompressedSeries.h>
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+
+/**
+ * Converts the fixture files to compressed series and prints the compression ratio, the decode speed and the window load time compared to the CSV files,
+ * once with the index and aggregates of the files and once without them. The series must hold the records of the CSV files without loss at 0.01%, and
+ * both windows must show the same values. Arguments: --runs=<repetitions, the best is shown>
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief loads the window without the checkpoint of the previous load and returns the time in microseconds.
+ * @param sidecars if false, the index and aggregates are removed before, so they are recreated from the complete files
+ */
+static double load(QEMSDataManager<uint16_t> &manager, bool sidecars) {
+    for (uint8_t c = 0; c < manager.getChannelCount(); c++) {
+        String file = manager.getFileName(c);
+        LittleFS.remove((file + CHECKPOINT_SUFFIX).c_str());
+        if (!sidecars) {
+            LittleFS.remove((file + CSV_INDEX_SUFFIX).c_str());
+            LittleFS.remove((file + AGGREGATE_SUFFIX).c_str());
+        }
+    }
+
+    double start = nowUs();
+    manager.loadDataFromFile();
+    return nowUs() - start;
+}
+
+int main(int argc, char **argv) {
+    int runs = argument(argc, argv, "runs", 10);
+
+    useFileSystem();
+    setNow(at("28.03.2023 09:00:07"));
+    for (const char *name : {"co2", "costs"}) {
+        std::string csv = std::string("/") + name + ".csv";
+        std::string series = std::string("/") + name + ".qts.csv";
+        copyFile(g_hostFsRoot + csv, g_hostFsRoot + series);
+        size_t csvSize = LittleFS.open(csv.c_str()).size();
+
+        QEMSSeriesWriter writer;
+        CHECK(writer.convert(series.c_str()));
+        size_t seriesSize = LittleFS.open(series.c_str()).size();
+
+        // lossless at the resolution of the series and decoded as fast as possible
+        std::vector<Record> records = readCsv(csv.c_str());
+        double decode = 1e18;
+        for (int run = 0; run < runs; run++) {
+            QEMSSeriesReader reader;
+            CHECK(reader.open(series.c_str()));
+            size_t count = 0;
+            bool lossless = true;
+            time_t time;
+            uint16_t values[MAX_CHANNELS];
+            double start = nowUs();
+            while (reader.next(time, values)) {
+                lossless = lossless && count < records.size() && time == records[count].time && abs(values[0] - lround(records[count].values[0] * 100)) <= 1;
+                count++;
+            }
+            decode = min(decode, nowUs() - start);
+            CHECK(lossless && count == records.size());
+        }
+
+        printf("RESULT %-5s %6zu -> %5zu bytes (%.1fx), decode %.1f M records/s\n", name, csvSize, seriesSize, (double)csvSize / seriesSize,
+               records.size() / decode);
+    }
+
+    QEMSTimeManager timeManager;
+    QEMSDataManager<uint16_t> csvManager(&timeManager);
+    csvManager.addChannel("/co2.csv");
+    csvManager.addChannel("/costs.csv");
+    QEMSDataManager<uint16_t> seriesManager(&timeManager);
+    seriesManager.addChannel("/co2.qts.csv");
+    seriesManager.addChannel("/costs.qts.csv");
+
+    for (bool sidecars : {false, true}) {
+        double csvLoad = 1e18;
+        double seriesLoad = 1e18;
+        for (int run = 0; run < runs; run++) {
+            csvLoad = min(csvLoad, load(csvManager, sidecars));
+            seriesLoad = min(seriesLoad, load(seriesManager, sidecars));
+        }
+        CHECK(csvManager.isReady() && seriesManager.isReady());
+
+        // both windows show the same values over the loaded day
+        time_t now = g_hostNow;
+        bool equal = true;
+        for (time_t time = now; time < now + 86400 - 3600; time += 60) {
+            setNow(time);
+            int csvValues[MAX_CHANNELS];
+            int seriesValues[MAX_CHANNELS];
+            equal = equal && csvManager.getActiveValues(csvValues) && seriesManager.getActiveValues(seriesValues) && csvValues[0] == seriesValues[0] &&
+                    csvValues[1] == seriesValues[1];
+        }
+        setNow(now);
+        CHECK(equal);
+
+        printf("RESULT window load %-18s csv %6.1f ms series %6.1f ms\n", sidecars ? "with sidecars" : "without sidecars", csvLoad / 1000, seriesLoad / 1000);
+    }
+
+    return finish();
+}
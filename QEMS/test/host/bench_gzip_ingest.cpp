@@ -0,0 +1,62 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+#include <QEMSWebServer.h>
+
+/**
+ * Uploads the fixture files through the web server once as they are and once gzip compressed (*.gz) and prints the transferred bytes and the time of the
+ * upload and the job that validates and loads the file. Both uploads must result in the same data file. The times do not include the network, so they show
+ * the cost of the decompression, the transfer time on the device scales with the bytes. Arguments: --runs=<repetitions, the best is shown>
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief uploads a data file and waits for its job.
+ * @return the time in milliseconds, a negative time if the upload failed
+ */
+static double ingest(WebServer &server, const char *name, const std::string &content) {
+    double start = nowUs();
+    if (server.upload("/upload", name, content) != 302 || waitForJob(server).indexOf("\"done\"") < 0) {
+        return -1;
+    }
+    return (nowUs() - start) / 1000;
+}
+
+int main(int argc, char **argv) {
+    int runs = argument(argc, argv, "runs", 5);
+
+    useFileSystem();
+    setNow(at("28.03.2023 09:00:07"));
+    QEMSTimeManager timeManager;
+    QEMSDataManager<> dataManager(&timeManager);
+    dataManager.addChannel("/co2.csv");
+    dataManager.addChannel("/costs.csv");
+    dataManager.loadDataFromFile();
+    QEMSJobQueue jobQueue;
+    QEMSWebServer webServer(&dataManager, &timeManager, &jobQueue);
+    WebServer &server = *WebServer::current();
+
+    for (const char *name : {"co2.csv", "costs.csv"}) {
+        std::string path = g_hostFsRoot + "/" + name;
+        std::string data = readFile(path);
+        std::string compressed = gzip(data, name);
+        std::string compressedName = std::string(name) + ".gz";
+
+        double rawMs = 1e9, gzipMs = 1e9;
+        for (int run = 0; run < runs; run++) {
+            double ms = ingest(server, name, data);
+            CHECK(ms >= 0 && readFile(path) == data);
+            rawMs = min(rawMs, ms);
+
+            ms = ingest(server, compressedName.c_str(), compressed);
+            CHECK(ms >= 0 && readFile(path) == data);
+            gzipMs = min(gzipMs, ms);
+        }
+
+        printf("RESULT %-9s raw %7zu bytes %7.1f ms, gzip %6zu bytes (%4.1f%%) %7.1f ms\n", name, data.size(), rawMs, compressed.size(),
+               100.0 * compressed.size() / data.size(), gzipMs);
+    }
+    CHECK(dataManager.isReady());
+
+    return finish();
+}
@@ -0,0 +1,60 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+
+/**
+ * Compares loading the window at the end of growing data files with and without the sparse timestamp index: without the index the whole file is parsed,
+ * with it the load seeks to the last indexed record before the current time. Both loads must show the same values. Arguments: --records=<records of the
+ * largest file, the files grow by a factor of 4 from 10000 records> --runs=<repetitions, the best is shown>
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief loads the data file without the checkpoint of the previous load and returns the time in microseconds.
+ */
+static double load(QEMSDataManager<> &manager, bool index) {
+    LittleFS.remove("/data.csv" CHECKPOINT_SUFFIX);
+    if (!index) {
+        LittleFS.remove("/data.csv" CSV_INDEX_SUFFIX);
+        LittleFS.remove("/data.csv" AGGREGATE_SUFFIX);
+    }
+
+    double start = nowUs();
+    manager.loadDataFromFile();
+    return nowUs() - start;
+}
+
+int main(int argc, char **argv) {
+    long maxRecords = argument(argc, argv, "records", 640000);
+    int runs = argument(argc, argv, "runs", 3);
+
+    useFileSystem({});
+    for (long records = 10000; records <= maxRecords; records *= 4) {
+        time_t start = at("01.01.2023 00:00:00");
+        size_t size = writeCsv("/data.csv", records, start);
+
+        // a day of records after the current time is loaded
+        setNow(start + (records - 5760) * 15 + 7);
+        QEMSTimeManager timeManager;
+        QEMSDataManager<> manager(&timeManager);
+        manager.addChannel("/data.csv");
+
+        double scan = 1e18;
+        double seek = 1e18;
+        int scanned[MAX_CHANNELS];
+        int sought[MAX_CHANNELS];
+        for (int run = 0; run < runs; run++) {
+            scan = min(scan, load(manager, false));
+            CHECK(manager.isReady() && manager.getActiveValues(scanned));
+            CHECK(LittleFS.exists("/data.csv" CSV_INDEX_SUFFIX));
+
+            seek = min(seek, load(manager, true));
+            CHECK(manager.isReady() && manager.getActiveValues(sought));
+            CHECK(scanned[0] == sought[0]);
+        }
+
+        printf("RESULT %7ld records %9zu bytes full scan %8.1f ms index seek %6.1f ms\n", records, size, scan / 1000, seek / 1000);
+    }
+
+    return finish();
+}
@@ -0,0 +1,68 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+
+/**
+ * Compares the reload of both fixture files in a single lockstep pass with loading them one after the other. A manager with a single data file always
+ * parses it with the serial path, so the serial reload is measured as the loads of one manager per file. The index and aggregates of the files exist, like
+ * after the first load. Both must show the same values. Arguments: --runs=<repetitions, the best is shown>
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief reloads the records without the checkpoint of the previous load and returns the time in microseconds.
+ */
+static double reload(QEMSDataManager<> &manager) {
+    LittleFS.remove((manager.getFileName(0) + CHECKPOINT_SUFFIX).c_str());
+    double start = nowUs();
+    manager.loadDataFromFile();
+    return nowUs() - start;
+}
+
+int main(int argc, char **argv) {
+    int runs = argument(argc, argv, "runs", 10);
+
+    useFileSystem();
+    setNow(at("28.03.2023 09:00:07"));
+    QEMSTimeManager timeManager;
+    QEMSDataManager<> lockstep(&timeManager);
+    lockstep.addChannel("/co2.csv");
+    lockstep.addChannel("/costs.csv");
+    QEMSDataManager<> co2(&timeManager);
+    co2.addChannel("/co2.csv");
+    QEMSDataManager<> costs(&timeManager);
+    costs.addChannel("/costs.csv");
+
+    // the first load creates the index and aggregates
+    reload(lockstep);
+
+    double lockstepUs = 1e18;
+    double serialUs = 1e18;
+    for (int run = 0; run < runs; run++) {
+        lockstepUs = min(lockstepUs, reload(lockstep));
+        serialUs = min(serialUs, reload(co2) + reload(costs));
+    }
+    CHECK(lockstep.isReady() && co2.isReady() && costs.isReady());
+
+    // the costs file starts a minute earlier, its records are merged into the time axis of the co2 file, so its values are compared at the times of the
+    // co2 records
+    time_t now = g_hostNow;
+    uint32_t lookups = 0;
+    uint32_t equal = 0;
+    for (time_t time = now; time < now + 86400 - 3600; time += 97, lookups++) {
+        setNow(time);
+        int values[MAX_CHANNELS];
+        int co2Value[MAX_CHANNELS];
+        time_t validUntil;
+        lockstep.getActiveValues(values, &validUntil);
+        co2.getActiveValues(co2Value);
+        float costValue[MAX_CHANNELS];
+        costs.sampleValues((int64_t)validUntil * 1000, costValue);
+        equal += values[0] == co2Value[0] && abs(values[1] - (int)costValue[0]) <= 1;
+    }
+    setNow(now);
+    CHECK(equal == lookups);
+
+    printf("RESULT reload of 2 files: serial %.1f ms, lockstep %.1f ms, %d of %d lookups equal\n", serialUs / 1000, lockstepUs / 1000, equal, lookups);
+    return finish();
+}
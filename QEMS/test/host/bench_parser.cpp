@@ -0,0 +1,105 @@
+#include <QEMSCsvParser.h>
+#include <QEMSHostTest.h>
+#include <QEMSParallelParser.h>
+#include <malloc.h>
+
+/**
+ * Parses a large synthetic data file with 1 to 8 workers, like the data managers parse the records of their window, and prints the time and the speedup
+ * compared to a single worker. Every number of workers must return the same lines in the same order, also when started in the middle of the file and while
+ * the workers back off. The speedup is limited by the cores of the host. Every parser creates its worker tasks and ends them, the cost of this and the heap
+ * of the buffers are printed per number of workers. Arguments: --records=<records of the file> --runs=<repetitions, the best is shown>
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief parses the file from the passed offset and returns the time in microseconds.
+ * @param checksum the checksum of the offsets, timestamps and values of the lines in file order
+ */
+static double parse(uint8_t workers, uint32_t offset, uint32_t &lines, uint64_t &checksum) {
+    File file = LittleFS.open("/data.csv");
+    file.seek(offset);
+    lines = 0;
+    checksum = 0;
+
+    double start = nowUs();
+    QEMSParallelParser parser(file, [](QEMSParallelParser::Line &line) {
+        line.timed = QEMSCsvParser::parseTime(line.text, line.time);
+        line.valid = true;
+        for (uint8_t c = 0; c < 2; c++) {
+            int value;
+            line.valid = QEMSCsvParser::parseValue(line.text, c + 1, QEMSFixedPoint<uint16_t>::SCALE, value) && line.valid;
+            line.values[c] = value;
+        }
+    }, workers);
+
+    QEMSParallelParser::Line *line;
+    while ((line = parser.next())) {
+        lines++;
+        checksum = checksum * 31 + line->offset + line->time * line->timed + line->values[0] * line->valid + line->values[1] * line->valid;
+    }
+    double us = nowUs() - start;
+    file.close();
+    return us;
+}
+
+int main(int argc, char **argv) {
+    long records = argument(argc, argv, "records", 400000);
+    int runs = argument(argc, argv, "runs", 3);
+
+    useFileSystem({});
+    size_t size = writeCsv("/data.csv", records, at("01.01.2023 00:00:00"), 15, 2);
+    printf("File of %ld records, %zu bytes\n", records, size);
+
+    uint32_t expectedLines;
+    uint64_t expected;
+    double serial = parse(1, 0, expectedLines, expected);
+    CHECK(expectedLines == records);
+
+    for (uint8_t workers = 1; workers <= PARSER_MAX_WORKERS; workers++) {
+        double best = 1e18;
+        uint32_t lines;
+        uint64_t checksum;
+        for (int run = 0; run < runs; run++) {
+            best = min(best, parse(workers, 0, lines, checksum));
+            CHECK(lines == expectedLines && checksum == expected);
+        }
+        serial = workers == 1 ? best : serial;
+        printf("RESULT %d workers %8.1f ms %6.1f MB/s speedup %.2f\n", workers, best / 1000, size / best, serial / best);
+    }
+
+    // the worker tasks are created by every parser, they end after parsing the first batches of their ranges
+    for (uint8_t workers = 1; workers <= PARSER_WORKERS; workers++) {
+        File file = LittleFS.open("/data.csv");
+        size_t used = mallinfo2().uordblks;
+        size_t heap = 0;
+        double start = nowUs();
+        for (int i = 0; i < 100; i++) {
+            file.seek(0);
+            QEMSParallelParser parser(file, [](QEMSParallelParser::Line &line) {}, workers);
+            heap = max(heap, mallinfo2().uordblks - used);
+        }
+        printf("RESULT setup %d workers %6.1f us per parser, %zu bytes heap\n", workers, (nowUs() - start) / 100, heap);
+        file.close();
+    }
+
+    // the data managers start at the record found in the index, in the middle of the file
+    File file = LittleFS.open("/data.csv");
+    file.seek(size / 2);
+    file.readStringUntil('\n');
+    uint32_t middle = file.position();
+    file.close();
+    uint32_t lines[2];
+    uint64_t checksums[2];
+    parse(1, middle, lines[0], checksums[0]);
+    parse(PARSER_MAX_WORKERS, middle, lines[1], checksums[1]);
+    CHECK(lines[0] == lines[1] && checksums[0] == checksums[1] && lines[0] < expectedLines);
+
+    // backing off only delays the workers
+    QEMSParallelParser::setBackoff(true);
+    parse(4, 0, lines[0], checksums[0]);
+    QEMSParallelParser::setBackoff(false);
+    CHECK(lines[0] == expectedLines && checksums[0] == expected);
+
+    return finish();
+}
@@ -0,0 +1,101 @@
+#include <QEMSCompressedSeries.h>
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+#include <QEMSRecordCache.h>
+#include <random>
+
+/**
+ * Compares queries of the record cache with and without cached pages over a large synthetic data file, once as CSV file with its index and once as
+ * compressed series: random ranges of an hour, random ranges of 10 minutes within 2 hours and consecutive ranges of 3 minutes, like the history chart
+ * advances. Without cache every query reads its pages from the file. All queries must return the records of the file. Arguments: --records=<records of the
+ * file> --queries=<number of queries per pattern>
+ */
+
+using namespace QEMSHostTest;
+
+static std::vector<Record> records;
+
+struct Pattern {
+    const char *name;
+    time_t span;   // of a query
+    time_t start;  // of the queries after the first record
+    time_t region; // the queries start at random times in this range after the start, 0 for consecutive queries
+};
+
+/**
+ * @brief runs the queries of a pattern and returns the time per query in microseconds.
+ * @param cached if false, the cache is cleared before every query
+ */
+static double run(QEMSRecordCache &cache, const char *path, const Pattern &pattern, bool cached, long queries, uint32_t &matched) {
+    time_t start = records.front().time + pattern.start;
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<time_t> offset(0, max(pattern.region - pattern.span, (time_t)0));
+
+    double us = 0;
+    matched = 0;
+    for (long q = 0; q < queries; q++) {
+        time_t from = pattern.region > 0 ? start + offset(rng) : start + q * pattern.span;
+        time_t to = from + pattern.span;
+        if (!cached) {
+            cache.clear();
+        }
+
+        static time_t times[512];
+        static float values[512];
+        double begin = nowUs();
+        uint16_t count = cache.read(path, 1, from, to, times, values, 512);
+        us += nowUs() - begin;
+
+        // the records of the file in the range
+        auto record = std::lower_bound(records.begin(), records.end(), from, [](const Record &record, time_t time) { return record.time < time; });
+        bool equal = true;
+        uint16_t expected = 0;
+        for (; record != records.end() && record->time < to; record++, expected++) {
+            equal = equal && expected < count && times[expected] == record->time && fabs(values[expected] - record->values[0]) < 0.0101;
+        }
+        matched += CHECK(equal && count == expected);
+    }
+    return us / queries;
+}
+
+int main(int argc, char **argv) {
+    long count = argument(argc, argv, "records", 1000000);
+    long queries = argument(argc, argv, "queries", 500);
+
+    useFileSystem({});
+    time_t start = at("01.01.2023 00:00:00");
+    size_t size = writeCsv("/data.csv", count, start);
+    copyFile(g_hostFsRoot + "/data.csv", g_hostFsRoot + "/data.qts.csv");
+    QEMSSeriesWriter writer;
+    CHECK(writer.convert("/data.qts.csv"));
+    records = readCsv("/data.csv");
+    printf("File of %ld records, CSV %zu bytes, compressed %zu bytes\n", count, size, (size_t)LittleFS.open("/data.qts.csv").size());
+
+    // the index of the CSV file is created by the first load, like on the device
+    setNow(start + 7);
+    QEMSTimeManager timeManager;
+    QEMSDataManager<uint16_t> manager(&timeManager);
+    manager.addChannel("/data.csv");
+    manager.loadDataFromFile();
+    CHECK(LittleFS.exists("/data.csv" CSV_INDEX_SUFFIX));
+
+    time_t length = records.back().time - records.front().time;
+    Pattern patterns[] = {{"random 1h", 3600, 0, length}, {"random 10 min in 2h", 600, length / 2, 7200}, {"sequential 3 min", 180, length / 3, 0}};
+    for (const char *path : {"/data.csv", "/data.qts.csv"}) {
+        for (const Pattern &pattern : patterns) {
+            QEMSRecordCache cache;
+            uint32_t matched[2];
+            double uncached = run(cache, path, pattern, false, queries, matched[0]);
+            cache.clear();
+            QEMSCacheStatistics before = cache.getStatistics();
+            double cached = run(cache, path, pattern, true, queries, matched[1]);
+            QEMSCacheStatistics after = cache.getStatistics();
+
+            printf("RESULT %-13s %-20s uncached %7.1f us cached %7.1f us, %d hits %d misses %d prefetches, %d of %ld queries matched\n", path + 1,
+                   pattern.name, uncached, cached, after.hits - before.hits, after.misses - before.misses, after.prefetches - before.prefetches,
+                   min(matched[0], matched[1]), queries);
+        }
+    }
+
+    return finish();
+}
@@ -0,0 +1,115 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+#include <QEMSWebServer.h>
+#include <atomic>
+#include <thread>
+
+/**
+ * Host side of tools/qems_scale.py: uploads a data file through the web server, which includes parsing and loading it, then queries records and
+ * aggregates of random ranges and renders the page, like the tool measures a device. The file system reports the size of the LittleFS partition, uploads
+ * that do not fit are rejected like on the device. Prints the results as JSON line with the keys of qems_scale.py. The heap is the one of the shim, the
+ * allocations of the process subtracted from the heap of the ESP32, sampled every millisecond during the upload. Arguments: --records=<records of a
+ * synthetic file> or --file=<data file written by qems_generate_csv.py, .gz is uploaded compressed> --first=<timestamp of its first record>
+ * --last=<timestamp of its last record>, --history=<hours of records before the current time> --lookups=<number of queried ranges> --lookup-span=<seconds of
+ * a range> --seed=<seed of the ranges> --fs-bytes=<size of the file system>
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief returns the median and the 95th percentile of the passed times.
+ */
+static std::pair<double, double> percentiles(std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    if (times.empty()) {
+        return {0, 0};
+    }
+    return {times[times.size() / 2], times[min(times.size() * 95 / 100, times.size() - 1)]};
+}
+
+int main(int argc, char **argv) {
+    long records = argument(argc, argv, "records", 10000);
+    std::string path = argument(argc, argv, "file", "");
+    long history = argument(argc, argv, "history", 1);
+    long lookups = argument(argc, argv, "lookups", 50);
+    long span = argument(argc, argv, "lookup-span", 3600);
+    long seed = argument(argc, argv, "seed", 1);
+    g_hostFsTotalBytes = argument(argc, argv, "fs-bytes", (long)g_hostFsTotalBytes);
+
+    useFileSystem({});
+    std::string name = path.empty() ? "co2.csv" : path.substr(path.find_last_of('/') + 1);
+    std::string data = "/" + name.substr(0, name.size() - (name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0 ? 3 : 0));
+    time_t first = path.empty() ? at("01.01.2023 00:00:00") : argument(argc, argv, "first", 0L);
+    time_t last = path.empty() ? first + (records - 1) * 15 : argument(argc, argv, "last", 0L);
+    if (path.empty()) {
+        path = g_hostFsRoot + "/upload.csv";
+        writeCsv("/upload.csv", records, first);
+    }
+    std::ifstream upload(path, std::ios::binary | std::ios::ate);
+    size_t bytes = upload.tellg();
+    upload.seekg(0);
+    LittleFS.remove("/upload.csv");
+
+    // the device holds a day of records of the file before the upload
+    setNow(first + history * 3600 + 7);
+    writeCsv(data.c_str(), 5760, first);
+    QEMSTimeManager timeManager;
+    QEMSDataManager<> dataManager(&timeManager);
+    uint8_t channel = dataManager.addChannel(data.c_str());
+    dataManager.loadDataFromFile();
+    QEMSJobQueue jobQueue;
+    QEMSWebServer webServer(&dataManager, &timeManager, &jobQueue);
+    WebServer &server = *WebServer::current();
+
+    // the upload and the job that validates and loads the file, the heap sampled meanwhile
+    uint32_t before = ESP.getFreeHeap();
+    std::atomic<bool> sampling(true);
+    std::atomic<uint32_t> minHeap(before);
+    std::thread sampler([&]() {
+        while (sampling) {
+            minHeap = min(minHeap.load(), ESP.getFreeHeap());
+            delay(1);
+        }
+    });
+    double start = nowUs();
+    int status = server.upload("/upload", name.c_str(), upload, bytes);
+    String job = status == 302 ? waitForJob(server, 360000) : "";
+    double uploadUs = nowUs() - start;
+    sampling = false;
+    sampler.join();
+    uint32_t after = ESP.getFreeHeap();
+
+    printf("RESULT {\"records\": %ld, \"bytes\": %zu, \"upload_status\": %d, \"upload_s\": %.3f, \"job\": \"%s\", \"heap_before\": %u, \"heap_after\": %u, "
+           "\"min_heap\": %u, \"max_alloc\": %u, \"fs_used\": %zu, \"fs_total\": %zu, \"ready\": %s",
+           records, bytes, status, uploadUs / 1e6, job.indexOf("\"done\"") >= 0 ? "done" : job.indexOf("\"failed\"") >= 0 ? "failed" : "none", before,
+           after, minHeap.load(), ESP.getMaxAllocHeap(), LittleFS.usedBytes(), LittleFS.totalBytes(), dataManager.isReady() ? "true" : "false");
+
+    if (status == 302) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<time_t> offset(0, max(last - first - span, (time_t)0));
+        std::vector<double> recordTimes, aggregateTimes;
+        for (long i = 0; i < lookups; i++) {
+            time_t from = first + offset(rng);
+            std::vector<std::pair<String, String>> query = {{"channel", String(channel)}, {"from", String(from)}, {"to", String(from + span)}};
+            double begin = nowUs();
+            server.request(HTTP_GET, "/api/records", query);
+            recordTimes.push_back((nowUs() - begin) / 1000);
+            begin = nowUs();
+            server.request(HTTP_GET, "/api/aggregate", query);
+            aggregateTimes.push_back((nowUs() - begin) / 1000);
+        }
+        std::pair<double, double> recordMs = percentiles(recordTimes), aggregateMs = percentiles(aggregateTimes);
+
+        double begin = nowUs();
+        server.request(HTTP_GET, "/");
+        double pageMs = (nowUs() - begin) / 1000;
+        printf(", \"records_ms\": %.1f, \"records_p95_ms\": %.1f, \"aggregate_ms\": %.1f, \"aggregate_p95_ms\": %.1f, \"page_ms\": %.1f, \"page_bytes\": %u",
+               recordMs.first, recordMs.second, aggregateMs.first, aggregateMs.second, pageMs, (unsigned)server.getContent().length());
+    }
+    printf("}\n");
+
+    // the file of the registered test fits into the partition and is loaded
+    CHECK(status == 302 || bytes * 2 > g_hostFsTotalBytes);
+    CHECK(status != 302 || job.indexOf("\"done\"") >= 0);
+    return finish();
+}
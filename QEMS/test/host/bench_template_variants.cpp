@@ -0,0 +1,67 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+
+/**
+ * Compares the template variants of QEMSDataManager on the fixture files: the object size, which holds the time axis of both windows, the load time and the
+ * time of value lookups. All variants must return the values of the records read directly from the files. Arguments: --lookups=<number of lookups>
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief returns the value shown at the load time in percent: the window starts with the first record after the load time and its first record is never
+ * shown, see getActiveValues().
+ */
+static int shownValue(const std::vector<Record> &records, time_t loaded) {
+    size_t index = 1;
+    while (index < records.size() && records[index - 1].time <= loaded) {
+        index++;
+    }
+    return records[index].values[0];
+}
+
+template <typename Manager> static void run(const char *name, const std::vector<Record> &co2, const std::vector<Record> &costs, long lookups) {
+    setNow(at("28.03.2023 09:00:07"));
+    QEMSTimeManager timeManager;
+    Manager *manager = new Manager(&timeManager);
+    uint8_t co2Channel = manager->addChannel("/co2.csv");
+    uint8_t costChannel = manager->addChannel("/costs.csv");
+
+    double start = nowUs();
+    manager->loadDataFromFile();
+    double load = nowUs() - start;
+    CHECK(manager->isReady());
+
+    time_t now = g_hostNow;
+    int values[MAX_CHANNELS];
+    CHECK(manager->getActiveValues(values));
+    CHECK(abs(values[co2Channel] - shownValue(co2, now)) <= 1);
+    CHECK(abs(values[costChannel] - shownValue(costs, now)) <= 1);
+
+    // lookups spread over 15 hours of loaded records, the clock only advances like on the device
+    start = nowUs();
+    for (long i = 0; i < lookups; i++) {
+        setNow(now + i * 15 * 3600 / lookups);
+        manager->getActiveValues(values);
+    }
+    double lookup = (nowUs() - start) / lookups;
+    setNow(now);
+
+    printf("RESULT %-24s object %6zu bytes load %8.1f ms lookup %6.3f us\n", name, sizeof(Manager), load / 1000, lookup);
+    delete manager;
+}
+
+int main(int argc, char **argv) {
+    long lookups = argument(argc, argv, "lookups", 100000);
+
+    useFileSystem();
+    std::vector<Record> co2 = readCsv("/co2.csv");
+    std::vector<Record> costs = readCsv("/costs.csv");
+
+    run<QEMSDataManager<>>("<>", co2, costs, lookups);
+    run<QEMSDataManager<uint8_t, 5760, 15>>("<uint8_t, 5760, 15>", co2, costs, lookups);
+    run<QEMSDataManager<uint16_t, 5760>>("<uint16_t, 5760>", co2, costs, lookups);
+    run<QEMSDataManager<uint16_t, 9000, 15>>("<uint16_t, 9000, 15>", co2, costs, lookups);
+
+    return finish();
+}
@@ -0,0 +1,221 @@
+#ifndef QEMS_HOST_ARDUINO_H_
+#define QEMS_HOST_ARDUINO_H_
+
+/**
+ * Minimal Arduino core for building the QEMS headers on the host, see ../CMakeLists.txt. Only the parts used by the headers are provided, with the
+ * semantics of the ESP32 Arduino core.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+typedef uint8_t byte;
+
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define IRAM_ATTR
+
+inline bool isDigit(int c) { return isdigit(c); }
+
+/**
+ * @brief Arduino String on top of std::string.
+ */
+class String {
+
+  public:
+    String() {}
+    String(const char *c) : s(c ? c : "") {}
+    String(const std::string &c) : s(c) {}
+    String(char c) : s(1, c) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    String(long long v) : s(std::to_string(v)) {}
+    String(unsigned long long v) : s(std::to_string(v)) {}
+    String(float v, unsigned decimals = 2) : s(format(v, decimals)) {}
+    String(double v, unsigned decimals = 2) : s(format(v, decimals)) {}
+
+    const char *c_str() const { return s.c_str(); }
+    unsigned length() const { return s.size(); }
+    bool isEmpty() const { return s.empty(); }
+    void reserve(unsigned size) { s.reserve(size); }
+
+    String substring(unsigned from) const { return from > s.size() ? String() : String(s.substr(from)); }
+    String substring(unsigned from, unsigned to) const {
+        to = min(to, (unsigned)s.size());
+        return from > to ? String() : String(s.substr(from, to - from));
+    }
+
+    void replace(char from, char to) { std::replace(s.begin(), s.end(), from, to); }
+    void replace(const String &from, const String &to) {
+        for (size_t p = 0; (p = s.find(from.s, p)) != std::string::npos; p += to.s.size()) {
+            s.replace(p, from.s.size(), to.s);
+        }
+    }
+
+    float toFloat() const { return atof(s.c_str()); }
+    long toInt() const { return atol(s.c_str()); }
+    void toLowerCase() {
+        for (char &c : s) {
+            c = tolower(c);
+        }
+    }
+    void trim() {
+        size_t first = 0;
+        while (first < s.size() && isspace((unsigned char)s[first])) {
+            first++;
+        }
+        size_t last = s.size();
+        while (last > first && isspace((unsigned char)s[last - 1])) {
+            last--;
+        }
+        s = s.substr(first, last - first);
+    }
+
+    int indexOf(char c, unsigned from = 0) const { return position(s.find(c, from)); }
+    int indexOf(const String &c, unsigned from = 0) const { return position(s.find(c.s, from)); }
+    int lastIndexOf(char c) const { return position(s.rfind(c)); }
+    bool startsWith(const String &prefix) const { return s.rfind(prefix.s, 0) == 0; }
+    bool endsWith(const String &suffix) const { return s.size() >= suffix.s.size() && s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0; }
+    char charAt(unsigned i) const { return i < s.size() ? s[i] : 0; }
+    char operator[](unsigned i) const { return charAt(i); }
+    bool equals(const String &o) const { return s == o.s; }
+
+    bool concat(const String &o) { return s += o.s, true; }
+    bool concat(const char *o) { return s += o, true; }
+    bool concat(char o) { return s += o, true; }
+    String &operator+=(const String &o) { return s += o.s, *this; }
+    String &operator+=(const char *o) { return s += o, *this; }
+    String &operator+=(char o) { return s += o, *this; }
+
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator==(const char *o) const { return s == o; }
+    bool operator!=(const String &o) const { return s != o.s; }
+    bool operator!=(const char *o) const { return s != o; }
+    bool operator<(const String &o) const { return s < o.s; }
+
+    friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+    friend String operator+(const String &a, const char *b) { return String(a.s + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.s); }
+    friend String operator+(const String &a, char b) { return String(a.s + b); }
+    template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type> friend String operator+(const String &a, T b) {
+        return a + String(b);
+    }
+
+    std::string s;
+
+  private:
+    static int position(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+
+    static std::string format(double v, unsigned decimals) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimals, v);
+        return buffer;
+    }
+};
+
+/**
+ * @brief Serial console, printed to stdout unless muted by QEMS_HOST_QUIET, so benchmarks are not slowed down by the logging.
+ */
+class HardwareSerial {
+
+  public:
+    operator bool() { return true; }
+    void begin(unsigned long) {}
+
+    int printf(const char *format, ...) {
+        if (_quiet) {
+            return 0;
+        }
+        va_list args;
+        va_start(args, format);
+        int result = vprintf(format, args);
+        va_end(args);
+        return result;
+    }
+
+    void print(const char *c) { printf("%s", c); }
+    void print(const String &c) { printf("%s", c.c_str()); }
+    template <typename T> void print(const T &v) { print(String(v)); }
+    void println() { printf("\n"); }
+    void println(const char *c) { printf("%s\n", c); }
+    void println(const String &c) { printf("%s\n", c.c_str()); }
+    template <typename T> void println(const T &v) { println(String(v)); }
+
+    /**
+     * @brief mutes the output, e.g. while a benchmark runs.
+     */
+    void setQuiet(bool quiet) { _quiet = quiet; }
+
+  private:
+    bool _quiet = getenv("QEMS_HOST_QUIET") != nullptr;
+};
+
+extern HardwareSerial Serial;
+
+inline unsigned long millis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline unsigned long micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+/**
+ * The time returned by time() and getLocalTime() if set, the tests use it to run the data managers at the time of the fixture data.
+ */
+extern time_t g_hostNow;
+
+/**
+ * @brief sets the time zone like the ESP32 Arduino core does for the passed offsets, e.g. "UTC-1DST" for CET with the POSIX default DST rules.
+ */
+inline void configTime(long gmtOffset, int daylightOffset, const char *server) {
+    char tz[32];
+    snprintf(tz, sizeof(tz), "UTC%ld%s", -gmtOffset / 3600, daylightOffset == 3600 ? "DST" : "");
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+inline bool getLocalTime(struct tm *info, uint32_t ms = 5000) {
+    time_t now = g_hostNow ? g_hostNow : ::time(nullptr);
+    localtime_r(&now, info);
+    return true;
+}
+
+/**
+ * @brief heap statistics of the process, see shim.cpp.
+ */
+class EspClass {
+
+  public:
+    void restart() { exit(0); }
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+};
+
+extern EspClass ESP;
+
+inline int64_t esp_timer_get_time() { return micros(); }
+
+#include <freertos.h>
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef QEMS_HOST_FS_H_
+#define QEMS_HOST_FS_H_
+
+/**
+ * File system of the ESP32 Arduino core on top of a host directory, see g_hostFsRoot. Files opened for writing are unbuffered, so every write() is passed
+ * to the host file system like a LittleFS write, and the write calls are counted in g_hostFsWrites.
+ */
+
+#include <Arduino.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+/**
+ * Host directory that is the root of the file system.
+ */
+extern std::string g_hostFsRoot;
+
+/**
+ * Size of the file system reported by totalBytes(), the LittleFS partition of partitions_mmap.csv by default.
+ */
+extern size_t g_hostFsTotalBytes;
+
+/**
+ * Number of write calls that reached the file system.
+ */
+extern size_t g_hostFsWrites;
+
+/**
+ * If set, every write call is synced to the disk, like a flash file system that programs the written data right away.
+ */
+extern bool g_hostFsSync;
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+namespace fs {
+
+class File {
+
+  public:
+    File() {}
+
+    operator bool() const { return _file || _dir; }
+
+    size_t write(const uint8_t *buffer, size_t size) {
+        if (!_file || size == 0) {
+            return 0;
+        }
+        g_hostFsWrites++;
+        size_t written = fwrite(buffer, 1, size, _file);
+        if (g_hostFsSync) {
+            fdatasync(fileno(_file));
+        }
+        return written;
+    }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t println(const String &s) { return print(s) + print("\n"); }
+
+    int available() { return _file ? size() - position() : 0; }
+    int read() { return _file ? fgetc(_file) : -1; }
+    int peek() {
+        int c = read();
+        if (c != EOF) {
+            ungetc(c, _file);
+        }
+        return c;
+    }
+    size_t read(uint8_t *buffer, size_t size) { return _file ? fread(buffer, 1, size, _file) : 0; }
+    size_t readBytes(char *buffer, size_t length) { return read((uint8_t *)buffer, length); }
+
+    String readStringUntil(char terminator) {
+        std::string result;
+        for (int c; (c = read()) != EOF && c != terminator;) {
+            result += (char)c;
+        }
+        return String(result);
+    }
+    String readString() { return readStringUntil('\0'); }
+
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) { return _file && fseek(_file, pos, mode) == 0; }
+    size_t position() { return _file ? ftell(_file) : 0; }
+    size_t size() {
+        struct stat st;
+        return _file && fstat(fileno(_file), &st) == 0 ? st.st_size : 0;
+    }
+    void flush() {
+        if (_file) {
+            fflush(_file);
+        }
+    }
+    void close() {
+        if (_file) {
+            fclose(_file);
+        }
+        if (_dir) {
+            closedir(_dir);
+        }
+        _file = nullptr;
+        _dir = nullptr;
+    }
+
+    const char *path() const { return _path.c_str(); }
+    const char *name() const { return _name.c_str(); }
+    bool isDirectory() { return _dir != nullptr; }
+    time_t getLastWrite() {
+        struct stat st;
+        return stat((g_hostFsRoot + _path).c_str(), &st) == 0 ? st.st_mtime : 0;
+    }
+
+    File openNextFile(const char *mode = FILE_READ) {
+        for (struct dirent *entry; _dir && (entry = readdir(_dir));) {
+            if (entry->d_name[0] != '.') {
+                return open((_path == "/" ? "" : _path) + "/" + entry->d_name, mode);
+            }
+        }
+        return File();
+    }
+
+    static File open(const std::string &path, const char *mode) {
+        File file;
+        file._path = path;
+        file._name = path.substr(path.rfind('/') + 1);
+
+        std::string full = g_hostFsRoot + path;
+        struct stat st;
+        if (stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            file._dir = opendir(full.c_str());
+            return file;
+        }
+
+        bool reading = strcmp(mode, FILE_READ) == 0;
+        file._file = fopen(full.c_str(), reading ? "rb" : strcmp(mode, FILE_APPEND) == 0 ? "ab" : "wb");
+        if (file._file && !reading) {
+            setvbuf(file._file, nullptr, _IONBF, 0);
+        }
+        return file;
+    }
+
+  private:
+    FILE *_file = nullptr;
+    DIR *_dir = nullptr;
+    std::string _path;
+    std::string _name;
+};
+
+class FS {
+
+  public:
+    bool begin(bool formatOnFail = false) { return true; }
+
+    File open(const char *path, const char *mode = FILE_READ, bool create = false) { return File::open(path, mode); }
+    File open(const String &path, const char *mode = FILE_READ, bool create = false) { return open(path.c_str(), mode); }
+
+    bool exists(const char *path) {
+        struct stat st;
+        return stat((g_hostFsRoot + path).c_str(), &st) == 0;
+    }
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path) { return ::remove((g_hostFsRoot + path).c_str()) == 0; }
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *from, const char *to) { return ::rename((g_hostFsRoot + from).c_str(), (g_hostFsRoot + to).c_str()) == 0; }
+    bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char *path) { return ::mkdir((g_hostFsRoot + path).c_str(), 0755) == 0; }
+    bool mkdir(const String &path) { return mkdir(path.c_str()); }
+    bool rmdir(const char *path) { return ::rmdir((g_hostFsRoot + path).c_str()) == 0; }
+    bool rmdir(const String &path) { return rmdir(path.c_str()); }
+
+    /**
+     * @brief removes all files.
+     */
+    bool format();
+
+    /**
+     * @brief returns the size of all files rounded up to whole blocks, like LittleFS counts them.
+     */
+    size_t usedBytes();
+
+    size_t totalBytes() { return g_hostFsTotalBytes; }
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif
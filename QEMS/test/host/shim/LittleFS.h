@@ -0,0 +1,8 @@
+#ifndef QEMS_HOST_LITTLEFS_H_
+#define QEMS_HOST_LITTLEFS_H_
+
+#include <FS.h>
+
+extern fs::FS LittleFS;
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef QEMS_HOST_PREFERENCES_H_
+#define QEMS_HOST_PREFERENCES_H_
+
+#include <Arduino.h>
+#include <map>
+
+/**
+ * @brief NVS key value store, kept in memory for the lifetime of the process.
+ */
+class Preferences {
+
+  public:
+    bool begin(const char *name, bool readOnly = false) { return true; }
+    void end() {}
+
+    size_t putULong64(const char *key, uint64_t value) { return store()[key] = value, sizeof(value); }
+    uint64_t getULong64(const char *key, uint64_t defaultValue = 0) { return get(key, defaultValue); }
+    size_t putUInt(const char *key, uint32_t value) { return store()[key] = value, sizeof(value); }
+    uint32_t getUInt(const char *key, uint32_t defaultValue = 0) { return get(key, defaultValue); }
+
+  private:
+    static std::map<std::string, uint64_t> &store() {
+        static std::map<std::string, uint64_t> values;
+        return values;
+    }
+
+    static uint64_t get(const char *key, uint64_t defaultValue) {
+        auto entry = store().find(key);
+        return entry == store().end() ? defaultValue : entry->second;
+    }
+};
+
+#endif
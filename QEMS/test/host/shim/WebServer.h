@@ -0,0 +1,233 @@
+#ifndef QEMS_HOST_WEB_SERVER_H_
+#define QEMS_HOST_WEB_SERVER_H_
+
+/**
+ * Web server of the ESP32 Arduino core without network. The tests pass requests and uploads to the registered handlers with request() and upload() and
+ * read the response afterwards.
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+
+#define HTTP_UPLOAD_BUFLEN 1436
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+typedef struct {
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;
+    size_t currentSize;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+} HTTPUpload;
+
+/**
+ * @brief a path handled by a request handler.
+ */
+class Uri {
+
+  public:
+    Uri(const char *uri) : _uri(uri) {}
+    Uri(const String &uri) : _uri(uri) {}
+    virtual ~Uri() {}
+
+    virtual Uri *clone() const { return new Uri(_uri); }
+
+    /**
+     * @brief returns true if the request path matches, the values of path parameters are added to pathArgs.
+     */
+    virtual bool canHandle(const String &requestUri, std::vector<String> &pathArgs) { return requestUri == _uri; }
+
+  protected:
+    String _uri;
+};
+
+class WebServer {
+
+  public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    WebServer(int port = 80) { current() = this; }
+
+    /**
+     * @brief returns the server created last, the tests reach the server of QEMSWebServer through it.
+     */
+    static WebServer *&current() {
+        static WebServer *server = nullptr;
+        return server;
+    }
+
+    void begin() {}
+    void handleClient() {}
+
+    void on(const Uri &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const Uri &uri, HTTPMethod method, THandlerFunction handler) { on(uri, method, handler, nullptr); }
+    void on(const Uri &uri, HTTPMethod method, THandlerFunction handler, THandlerFunction uploadHandler) {
+        _handlers.push_back({std::shared_ptr<Uri>(uri.clone()), method, handler, uploadHandler});
+    }
+    void onNotFound(THandlerFunction handler) { _notFound = handler; }
+
+    String uri() { return _uri; }
+    HTTPMethod method() { return _method; }
+    size_t clientContentLength() { return _contentLength; }
+
+    String arg(String name) {
+        for (auto &arg : _args) {
+            if (arg.first == name) {
+                return arg.second;
+            }
+        }
+        return String();
+    }
+    String arg(int i) { return i < (int)_args.size() ? _args[i].second : String(); }
+    bool hasArg(String name) {
+        for (auto &arg : _args) {
+            if (arg.first == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+    String pathArg(unsigned i) { return i < _pathArgs.size() ? _pathArgs[i] : String(); }
+
+    HTTPUpload &upload() { return _upload; }
+
+    void sendHeader(const String &name, const String &value, bool first = false) { _responseHeaders[name.s] = value; }
+    void send(int code, const char *contentType = nullptr, const String &content = String()) {
+        _code = code;
+        _content = content;
+    }
+    void send(int code, const String &contentType, const String &content) { send(code, contentType.c_str(), content); }
+    void setContentLength(size_t length) {}
+    void sendContent(const String &content) { _content += content; }
+
+    template <typename T> size_t streamFile(T &file, const String &contentType, int code = 200) {
+        _code = code;
+        _content = file.readString();
+        return _content.length();
+    }
+
+    /**
+     * @brief passes a request to the matching handler.
+     * @param method the request method
+     * @param uri the path of the request
+     * @param args the query or form arguments, the body of a POST is passed as argument "plain"
+     * @return the status code of the response, 0 if no response was sent
+     */
+    int request(HTTPMethod method, const String &uri, std::vector<std::pair<String, String>> args = {}) {
+        begin(method, uri, args, 0);
+        Handler *handler = find();
+        if (handler) {
+            handler->handler();
+        } else if (_notFound) {
+            _notFound();
+        }
+        return _code;
+    }
+
+    /**
+     * @brief uploads a file as multipart form in chunks of HTTP_UPLOAD_BUFLEN bytes, like a browser through the upload form.
+     * @return the status code of the response, 0 if no response was sent
+     */
+    int upload(const String &uri, const String &filename, const std::string &content) {
+        std::istringstream in(content);
+        return upload(uri, filename, in, content.size());
+    }
+
+    /**
+     * @brief uploads a file like upload() above, the content is read in chunks from the stream, e.g. a file larger than the memory of the test.
+     * @param size the number of bytes read from the stream
+     */
+    int upload(const String &uri, const String &filename, std::istream &content, size_t size) {
+        begin(HTTP_POST, uri, {}, size + 200);
+        Handler *handler = find();
+        if (!handler || !handler->uploadHandler) {
+            return 404;
+        }
+
+        _upload.status = UPLOAD_FILE_START;
+        _upload.filename = filename;
+        _upload.name = "update";
+        _upload.totalSize = 0;
+        _upload.currentSize = 0;
+        handler->uploadHandler();
+
+        for (size_t position = 0; position < size; position += HTTP_UPLOAD_BUFLEN) {
+            _upload.status = UPLOAD_FILE_WRITE;
+            _upload.currentSize = min((size_t)HTTP_UPLOAD_BUFLEN, size - position);
+            content.read((char *)_upload.buf, _upload.currentSize);
+            _upload.totalSize += _upload.currentSize;
+            handler->uploadHandler();
+        }
+
+        _upload.status = UPLOAD_FILE_END;
+        _upload.currentSize = 0;
+        handler->uploadHandler();
+        handler->handler();
+        return _code;
+    }
+
+    /**
+     * @brief returns the body of the last response.
+     */
+    String getContent() { return _content; }
+
+    /**
+     * @brief returns a header of the last response.
+     */
+    String getHeader(const String &name) { return _responseHeaders.count(name.s) ? _responseHeaders[name.s] : String(); }
+
+  private:
+    struct Handler {
+        std::shared_ptr<Uri> uri;
+        HTTPMethod method;
+        THandlerFunction handler;
+        THandlerFunction uploadHandler;
+    };
+
+    std::vector<Handler> _handlers;
+    THandlerFunction _notFound;
+
+    String _uri;
+    HTTPMethod _method = HTTP_GET;
+    std::vector<std::pair<String, String>> _args;
+    std::vector<String> _pathArgs;
+    size_t _contentLength = 0;
+    HTTPUpload _upload;
+
+    int _code = 0;
+    String _content;
+    std::map<std::string, String> _responseHeaders;
+
+    void begin(HTTPMethod method, const String &uri, const std::vector<std::pair<String, String>> &args, size_t contentLength) {
+        _method = method;
+        _uri = uri;
+        _args = args;
+        _contentLength = contentLength;
+        _code = 0;
+        _content = String();
+        _responseHeaders.clear();
+    }
+
+    Handler *find() {
+        for (Handler &handler : _handlers) {
+            _pathArgs.clear();
+            if ((handler.method == HTTP_ANY || handler.method == _method) && handler.uri->canHandle(_uri, _pathArgs)) {
+                return &handler;
+            }
+        }
+        return nullptr;
+    }
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef QEMS_HOST_MINIZ_H_
+#define QEMS_HOST_MINIZ_H_
+
+/**
+ * The tinfl inflate API of the ESP32 ROM on top of zlib, for raw deflate streams as used by QEMSGzipInflater.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <zlib.h>
+
+typedef unsigned char mz_uint8;
+typedef uint32_t mz_uint32;
+
+#define TINFL_LZ_DICT_SIZE 32768
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+
+typedef enum { TINFL_STATUS_FAILED = -1, TINFL_STATUS_DONE = 0, TINFL_STATUS_NEEDS_MORE_INPUT = 1, TINFL_STATUS_HAS_MORE_OUTPUT = 2 } tinfl_status;
+
+/**
+ * Memory for the zlib state, the inflate state and the 32 KB window. Like the decompressor of the ROM holds its whole state, the zlib state is allocated
+ * from it, so releasing the decompressor with free() releases the state of the stream, also of a stream that was not finished.
+ */
+#define TINFL_ZLIB_ARENA_SIZE (TINFL_LZ_DICT_SIZE + 16384)
+
+typedef struct {
+    z_stream stream;
+    bool initialized;
+    size_t used;
+    alignas(16) unsigned char arena[TINFL_ZLIB_ARENA_SIZE];
+} tinfl_decompressor;
+
+inline voidpf tinfl_zalloc(voidpf opaque, uInt items, uInt size) {
+    tinfl_decompressor *r = (tinfl_decompressor *)opaque;
+    size_t bytes = ((size_t)items * size + 15) & ~(size_t)15;
+    if (bytes > TINFL_ZLIB_ARENA_SIZE - r->used) {
+        return Z_NULL;
+    }
+    voidpf result = r->arena + r->used;
+    r->used += bytes;
+    return result;
+}
+
+inline void tinfl_zfree(voidpf opaque, voidpf address) {}
+
+#define tinfl_init(r) ((r)->initialized = false)
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *in, size_t *inSize, mz_uint8 *outStart, mz_uint8 *out, size_t *outSize,
+                                     const mz_uint32 flags) {
+    if (!r->initialized) {
+        memset(&r->stream, 0, sizeof(r->stream));
+        r->stream.zalloc = tinfl_zalloc;
+        r->stream.zfree = tinfl_zfree;
+        r->stream.opaque = r;
+        r->used = 0;
+        if (inflateInit2(&r->stream, -15) != Z_OK) {
+            *inSize = *outSize = 0;
+            return TINFL_STATUS_FAILED;
+        }
+        r->initialized = true;
+    }
+
+    r->stream.next_in = (Bytef *)in;
+    r->stream.avail_in = *inSize;
+    r->stream.next_out = out;
+    r->stream.avail_out = *outSize;
+    int result = inflate(&r->stream, Z_NO_FLUSH);
+    *inSize -= r->stream.avail_in;
+    *outSize -= r->stream.avail_out;
+
+    if (result == Z_STREAM_END) {
+        return TINFL_STATUS_DONE;
+    }
+    if (result != Z_OK && result != Z_BUF_ERROR) {
+        return TINFL_STATUS_FAILED;
+    }
+    return r->stream.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef QEMS_HOST_ESP_ROM_CRC_H_
+#define QEMS_HOST_ESP_ROM_CRC_H_
+
+#include <cstdint>
+#include <zlib.h>
+
+/**
+ * The ROM function computes the same CRC32 as zlib.
+ */
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buffer, uint32_t length) { return crc32(crc, buffer, length); }
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef QEMS_HOST_ESP_SNTP_H_
+#define QEMS_HOST_ESP_SNTP_H_
+
+#include <sys/time.h>
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+
+/**
+ * The host clock is never synchronized by SNTP.
+ */
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) {}
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef QEMS_HOST_ESP_TIMER_H_
+#define QEMS_HOST_ESP_TIMER_H_
+
+// esp_timer_get_time() is provided by Arduino.h
+
+#include <Arduino.h>
+
+#endif
@@ -0,0 +1,181 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <condition_variable>
+#include <deque>
+#include <malloc.h>
+#include <mutex>
+#include <vector>
+
+HardwareSerial Serial;
+EspClass ESP;
+fs::FS LittleFS;
+
+time_t g_hostNow = 0;
+std::string g_hostFsRoot = ".";
+size_t g_hostFsTotalBytes = 0x110000;
+size_t g_hostFsWrites = 0;
+bool g_hostFsSync = false;
+
+/**
+ * Heap of the ESP32 available to the application, the allocations of the process are subtracted from it.
+ */
+static const uint32_t HOST_HEAP_SIZE = 320 * 1024;
+
+static uint32_t minFreeHeap = HOST_HEAP_SIZE;
+
+uint32_t EspClass::getFreeHeap() {
+    size_t used = mallinfo2().uordblks;
+    uint32_t free = used < HOST_HEAP_SIZE ? HOST_HEAP_SIZE - used : 0;
+    minFreeHeap = min(minFreeHeap, free);
+    return free;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    getFreeHeap();
+    return minFreeHeap;
+}
+
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap(); }
+
+namespace fs {
+
+bool FS::format() {
+    File root = File::open("/", FILE_READ);
+    for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+        std::string path = file.path();
+        file.close();
+        remove(path.c_str());
+    }
+    root.close();
+    return true;
+}
+
+size_t FS::usedBytes() {
+    // LittleFS allocates whole blocks per file and two blocks for the superblock
+    size_t used = 2 * 4096;
+    File root = File::open("/", FILE_READ);
+    for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+        used += (file.size() + 4095) / 4096 * 4096;
+        file.close();
+    }
+    root.close();
+    return used;
+}
+
+} // namespace fs
+
+// FreeRTOS tasks are threads, vTaskDelete(NULL) ends the thread of the calling task
+
+struct TaskDeleted {};
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack, void *parameter, UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core) {
+    std::thread([function, parameter]() {
+        try {
+            function(parameter);
+        } catch (TaskDeleted &) {
+        }
+    }).detach();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (!task) {
+        throw TaskDeleted();
+    }
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+TickType_t xTaskGetTickCount() { return millis(); }
+
+BaseType_t xPortGetCoreID() { return 0; }
+
+static std::chrono::milliseconds toTimeout(TickType_t ticks) { return std::chrono::milliseconds(ticks == portMAX_DELAY ? 1000000000 : ticks); }
+
+struct Queue {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    size_t length;
+    size_t itemSize;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    Queue *queue = new Queue;
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void *item, TickType_t timeout) {
+    Queue *queue = (Queue *)handle;
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (queue->items.size() >= queue->length &&
+        (timeout == 0 || !queue->changed.wait_for(lock, toTimeout(timeout), [queue] { return queue->items.size() < queue->length; }))) {
+        return pdFALSE;
+    }
+    queue->items.emplace_back((const uint8_t *)item, (const uint8_t *)item + queue->itemSize);
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void *item, TickType_t timeout) {
+    Queue *queue = (Queue *)handle;
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (queue->items.empty() && (timeout == 0 || !queue->changed.wait_for(lock, toTimeout(timeout), [queue] { return !queue->items.empty(); }))) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle) {
+    Queue *queue = (Queue *)handle;
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->items.size();
+}
+
+struct Semaphore {
+    std::mutex mutex;
+    std::condition_variable changed;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return xSemaphoreCreateCounting(1, 1); }
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return xSemaphoreCreateCounting(1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    Semaphore *semaphore = new Semaphore;
+    semaphore->count = initialCount;
+    semaphore->maxCount = maxCount;
+    return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t timeout) {
+    Semaphore *semaphore = (Semaphore *)handle;
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    // polling without a timeout must not enter a timed wait, it takes a system call
+    if (semaphore->count == 0 && (timeout == 0 || !semaphore->changed.wait_for(lock, toTimeout(timeout), [semaphore] { return semaphore->count > 0; }))) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle) {
+    Semaphore *semaphore = (Semaphore *)handle;
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->count >= semaphore->maxCount) {
+        return pdFALSE;
+    }
+    semaphore->count++;
+    semaphore->changed.notify_one();
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t handle) { delete (Semaphore *)handle; }
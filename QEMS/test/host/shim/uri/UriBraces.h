@@ -0,0 +1,40 @@
+#ifndef QEMS_HOST_URI_BRACES_H_
+#define QEMS_HOST_URI_BRACES_H_
+
+#include <WebServer.h>
+
+/**
+ * @brief a path with parameters in braces, e.g. "/api/series/{}/append". A parameter matches a single path segment.
+ */
+class UriBraces : public Uri {
+
+  public:
+    UriBraces(const char *uri) : Uri(uri) {}
+    UriBraces(const String &uri) : Uri(uri) {}
+
+    Uri *clone() const override { return new UriBraces(_uri); }
+
+    bool canHandle(const String &requestUri, std::vector<String> &pathArgs) override {
+        const std::string &pattern = _uri.s;
+        const std::string &path = requestUri.s;
+        size_t p = 0;
+        size_t r = 0;
+        while (p < pattern.size()) {
+            if (pattern.compare(p, 2, "{}") == 0) {
+                size_t end = path.find('/', r);
+                end = end == std::string::npos ? path.size() : end;
+                pathArgs.push_back(String(path.substr(r, end - r)));
+                r = end;
+                p += 2;
+            } else if (r < path.size() && pattern[p] == path[r]) {
+                p++;
+                r++;
+            } else {
+                return false;
+            }
+        }
+        return r == path.size();
+    }
+};
+
+#endif
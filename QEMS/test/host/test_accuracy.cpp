@@ -0,0 +1,188 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+#include <QEMSLttb.h>
+#include <QEMSMappedDataManager.h>
+#include <random>
+
+/**
+ * Compares the values the data sources provide with values computed directly from the records of assets/co2.csv: the interpolated samples, the aggregates
+ * of random ranges and the points the history chart keeps with LTTB. The RAM window and the memory mapped image hold the values with a resolution of 0.01%,
+ * the values are truncated to it, so they may differ from the file by less than that.
+ */
+
+using namespace QEMSHostTest;
+
+#define RESOLUTION 0.0101 // 0.01% and the rounding of float
+#define BUCKET_SPAN 300   // seconds of a bucket of the history chart
+#define BUCKET_SIZE 64    // HISTORY_BUCKET_SIZE of the history chart
+
+static std::vector<Record> co2;
+
+/**
+ * @brief returns the index of the first record after the passed time.
+ */
+static size_t findNext(time_t time) {
+    return std::upper_bound(co2.begin(), co2.end(), time, [](time_t time, const Record &record) { return time < record.time; }) - co2.begin();
+}
+
+/**
+ * @brief compares the samples at random times between the passed records, which the source holds, with the interpolation of the records.
+ */
+static void compareSamples(QEMSDataSource &source, const char *name, time_t first, time_t last) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int64_t> timeMs((int64_t)first * 1000, (int64_t)last * 1000 - 1);
+    uint32_t samples = 0;
+    uint32_t matched = 0;
+    double maxError = 0;
+    for (; samples < 10000; samples++) {
+        int64_t time = timeMs(rng);
+        size_t next = findNext(time / 1000);
+        double fraction = (time - co2[next - 1].time * 1000.0) / ((co2[next].time - co2[next - 1].time) * 1000.0);
+        double expected = co2[next - 1].values[0] + (co2[next].values[0] - co2[next - 1].values[0]) * fraction;
+
+        float sampled[MAX_CHANNELS];
+        if (CHECK(source.sampleValues(time, sampled))) {
+            maxError = max(maxError, fabs(sampled[0] - expected));
+            matched += fabs(sampled[0] - expected) < RESOLUTION;
+        }
+    }
+    CHECK(matched == samples);
+
+    printf("RESULT %-6s %d of %d samples within 0.01%%, max error %.4f%%\n", name, matched, samples, maxError);
+}
+
+/**
+ * @brief compares the aggregates of random ranges over the file with the aggregates of the records in the full minutes of the ranges.
+ */
+static void compareAggregates(QEMSDataSource &source, const char *name) {
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<time_t> time(co2.front().time, co2.back().time);
+    uint32_t ranges = 0;
+    uint32_t matched = 0;
+    for (int q = 0; q < 500; q++) {
+        time_t from = time(rng);
+        time_t to = time(rng);
+        if (from > to) {
+            std::swap(from, to);
+        }
+
+        QEMSAggregate expected = {0, 100, 0, 0, 0};
+        for (size_t i = findNext((from + 59) / 60 * 60 - 1); i < co2.size() && co2[i].time < to / 60 * 60; i++) {
+            expected.count++;
+            expected.min = min(expected.min, co2[i].values[0]);
+            expected.max = max(expected.max, co2[i].values[0]);
+            expected.sum += co2[i].values[0];
+        }
+        if (expected.count == 0) {
+            continue;
+        }
+        expected.mean = expected.sum / expected.count;
+
+        QEMSAggregate aggregate;
+        ranges++;
+        matched += CHECK(source.getAggregate(0, from, to, aggregate)) && CHECK(aggregate.count == expected.count) &&
+                   CHECK(fabs(aggregate.min - expected.min) < RESOLUTION) && CHECK(fabs(aggregate.max - expected.max) < RESOLUTION) &&
+                   CHECK(fabs(aggregate.mean - expected.mean) < RESOLUTION);
+    }
+
+    printf("RESULT %-6s %d of %d aggregates within 0.01%%\n", name, matched, ranges);
+}
+
+/**
+ * @brief reads the records of a bucket from the source like the history chart.
+ */
+static uint16_t readBucket(QEMSDataSource &source, time_t start, QEMSLttb::Point *points) {
+    time_t times[BUCKET_SIZE];
+    float values[BUCKET_SIZE];
+    uint16_t count = source.getRecords(0, start, start + BUCKET_SPAN, times, values, BUCKET_SIZE);
+    for (uint16_t i = 0; i < count; i++) {
+        points[i] = {(float)(times[i] - co2.front().time), values[i]};
+    }
+    return count;
+}
+
+/**
+ * @brief compares the points LTTB keeps of the buckets read from the source like the history chart with those kept of the records of the file, which are
+ * selected independently with the exact values in double precision. Each bucket must keep the same record.
+ */
+static void compareLttb(QEMSDataSource &source, const char *name, time_t first, time_t last) {
+    uint32_t buckets = 0;
+    uint32_t matched = 0;
+    double previousX = 0;
+    double previousY = 0;
+    QEMSLttb::Point previous = {0, 0};
+    for (time_t start = first; start + BUCKET_SPAN <= last; start += BUCKET_SPAN, buckets++) {
+        size_t begin = findNext(start - 1);
+        size_t end = findNext(start + BUCKET_SPAN - 1);
+        size_t nextEnd = findNext(start + 2 * BUCKET_SPAN - 1);
+
+        // the third corner is the average of the next bucket, or of the bucket itself for the last one
+        size_t averageBegin = nextEnd > end ? end : begin;
+        size_t averageEnd = nextEnd > end ? nextEnd : end;
+        double averageX = 0;
+        double averageY = 0;
+        for (size_t i = averageBegin; i < averageEnd; i++) {
+            averageX += co2[i].time - co2.front().time;
+            averageY += co2[i].values[0];
+        }
+        averageX /= averageEnd - averageBegin;
+        averageY /= averageEnd - averageBegin;
+
+        size_t expected = begin;
+        double maxArea = -1;
+        for (size_t i = begin; buckets > 0 && i < end; i++) {
+            double x = co2[i].time - co2.front().time;
+            double area = fabs((previousX - averageX) * (co2[i].values[0] - previousY) - (previousX - x) * (averageY - previousY));
+            if (area > maxArea) {
+                maxArea = area;
+                expected = i;
+            }
+        }
+        previousX = co2[expected].time - co2.front().time;
+        previousY = co2[expected].values[0];
+
+        QEMSLttb::Point points[BUCKET_SIZE];
+        QEMSLttb::Point next[BUCKET_SIZE];
+        uint16_t count = readBucket(source, start, points);
+        uint16_t nextCount = readBucket(source, start + BUCKET_SPAN, next);
+        if (!CHECK(count == end - begin)) {
+            continue;
+        }
+        QEMSLttb::Point average = nextCount > 0 ? QEMSLttb::average(next, nextCount) : QEMSLttb::average(points, count);
+        uint16_t index = buckets > 0 ? QEMSLttb::select(previous, points, count, average) : 0;
+        previous = points[index];
+
+        matched += CHECK(begin + index == expected) && CHECK(fabs(points[index].y - co2[expected].values[0]) < RESOLUTION);
+    }
+    CHECK(matched == buckets);
+
+    printf("RESULT %-6s %d of %d buckets keep the same record\n", name, matched, buckets);
+}
+
+int main() {
+    useFileSystem();
+    remove(FLASH_IMAGE_FILE);
+    co2 = readCsv("/co2.csv");
+
+    // the window holds the first day of the file, the image the complete file
+    setNow(at("28.03.2023 08:44:00"));
+    QEMSTimeManager timeManager;
+    QEMSDataManager<uint16_t> window(&timeManager);
+    window.addChannel("/co2.csv");
+    window.loadDataFromFile();
+    CHECK(window.isReady());
+    QEMSMappedDataManager mapped(&timeManager);
+    mapped.addChannel("/co2.csv");
+    mapped.loadDataFromFile();
+    CHECK(mapped.isReady());
+
+    compareSamples(window, "window", co2.front().time, co2[5759].time);
+    compareSamples(mapped, "mapped", co2.front().time, co2.back().time);
+    compareAggregates(window, "window");
+    compareAggregates(mapped, "mapped");
+    // the buckets of the window are partly read from the file through the record cache
+    compareLttb(window, "window", co2.front().time, co2.back().time);
+    compareLttb(mapped, "mapped", co2.front().time, co2.back().time);
+
+    return finish();
+}
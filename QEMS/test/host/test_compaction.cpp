@@ -0,0 +1,65 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+
+/**
+ * Appends records to the segment of the co2 data file and merges them into the data file. The merge writes a copy of the data file that replaces it, the
+ * records are reloaded afterwards even if there are fewer future records than needed for a regular load, so the window never shows the outdated records.
+ * The merged file is reported to the file listener, the file index of the web server is updated from it without reading the file.
+ */
+
+using namespace QEMSHostTest;
+
+int main() {
+    useFileSystem();
+    std::vector<Record> co2 = readCsv("/co2.csv");
+    time_t last = co2.back().time;
+
+    // a window of the last 200 records of the file
+    setNow(last - 200 * 15 + 7);
+    QEMSTimeManager timeManager;
+    QEMSDataManager<uint16_t> manager(&timeManager);
+    manager.addChannel("/co2.csv");
+    manager.loadDataFromFile();
+    CHECK(manager.isReady());
+
+    String records;
+    for (int i = 1; i <= 10; i++) {
+        records += (stamp(last + i * 15) + ";0.5\n").c_str();
+    }
+    CHECK(manager.appendRecords(0, records));
+    CHECK(LittleFS.exists("/co2.csv" SEGMENT_SUFFIX));
+
+    // the clock passed most of the records, a regular load would not provide enough of them. The merged file is reported with the checksum of its writer.
+    setNow(last - 50 * 15 + 7);
+    uint32_t generation = manager.getGeneration();
+    String written;
+    size_t writtenSize = 0;
+    uint32_t writtenCrc = 0;
+    manager.setFileListener([&](String path, size_t size, uint32_t crc) {
+        written = path;
+        writtenSize = size;
+        writtenCrc = crc;
+    });
+    CHECK(manager.compactSegment(0));
+    CHECK(manager.getGeneration() != generation);
+    CHECK(!LittleFS.exists("/co2.csv" SEGMENT_SUFFIX));
+    CHECK(!LittleFS.exists("/co2.csv.tmp"));
+
+    std::ifstream file(g_hostFsRoot + "/co2.csv", std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    CHECK(written == "/co2.csv" && writtenSize == content.size() && writtenCrc == esp_rom_crc32_le(0, (const uint8_t *)content.data(), content.size()));
+
+    std::vector<Record> merged = readCsv("/co2.csv");
+    CHECK(merged.size() == co2.size() + 10);
+    CHECK(merged.back().time == last + 150 && merged.back().values[0] == 50);
+
+    // the reloaded window starts at the current time and holds the merged records, the aggregates were recreated with them
+    time_t times[100];
+    float values[100];
+    CHECK(manager.getRecords(0, g_hostNow, last + 151, times, values, 100) == 60);
+    CHECK(times[59] == last + 150 && values[59] == 50);
+    QEMSAggregate aggregate;
+    CHECK(manager.getAggregate(0, last + 1, last + 3600, aggregate) && aggregate.count == 10 && aggregate.min == 50 && aggregate.max == 50);
+
+    return finish();
+}
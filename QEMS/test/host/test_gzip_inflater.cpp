@@ -0,0 +1,80 @@
+#include <QEMSGzipInflater.h>
+#include <QEMSHostTest.h>
+#include <malloc.h>
+
+/**
+ * Decompresses gzip streams with the inflater of the uploads in chunks of a network packet. Valid streams are written as they were compressed, streams with
+ * an invalid header, a checksum or size in the trailer that does not match the data, a missing end or more data than allowed fail. The inflate state of a
+ * stream is released, also if the stream did not end.
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief decompresses the passed stream to /out.csv.
+ * @param written set to false if a chunk was rejected
+ * @return the result of QEMSGzipInflater::end()
+ */
+static bool inflate(const std::string &stream, bool &written, size_t maxSize = SIZE_MAX) {
+    QEMSBlockWriter writer;
+    QEMSGzipInflater inflater;
+    writer.open("/out.csv");
+    inflater.begin(&writer, maxSize);
+    written = true;
+    for (size_t pos = 0; pos < stream.size() && written; pos += 1460) {
+        written = inflater.write((const uint8_t *)stream.data() + pos, min(stream.size() - pos, (size_t)1460));
+    }
+    bool complete = inflater.end();
+    writer.close();
+    return complete;
+}
+
+/**
+ * @brief returns the stream with one byte inverted.
+ */
+static std::string corrupt(std::string stream, size_t pos) {
+    stream[pos] = ~stream[pos];
+    return stream;
+}
+
+int main() {
+    useFileSystem();
+    std::string data = readFile(g_hostFsRoot + "/co2.csv");
+    std::string stream = gzip(data, "co2.csv");
+    bool written;
+
+    // a valid stream with the name of the file in the header
+    CHECK(inflate(stream, written) && written);
+    CHECK(readFile(g_hostFsRoot + "/out.csv") == data);
+    CHECK(inflate(gzip(""), written) && written);
+    CHECK(readFile(g_hostFsRoot + "/out.csv").empty());
+
+    // an invalid magic number or compression method
+    CHECK(!inflate(corrupt(stream, 0), written) && !written);
+    CHECK(!inflate(corrupt(stream, 2), written) && !written);
+
+    // the checksum or the size of the trailer do not match
+    CHECK(!inflate(corrupt(stream, stream.size() - 8), written) && !written);
+    CHECK(!inflate(corrupt(stream, stream.size() - 1), written) && !written);
+
+    // a truncated stream is accepted chunk by chunk, but it is not complete
+    CHECK(!inflate(stream.substr(0, stream.size() - 4), written) && written);
+    CHECK(!inflate(stream.substr(0, stream.size() / 2), written) && written);
+    CHECK(!inflate(stream.substr(0, 5), written) && written);
+
+    // the decompressed data is limited, not the stream
+    CHECK(inflate(stream, written, data.size()) && written);
+    CHECK(!inflate(stream, written, data.size() - 1) && !written);
+    CHECK(!inflate(gzip(std::string(4 * 1024 * 1024, '0')), written, 1024 * 1024) && !written);
+
+    // the inflate state of streams that did not end is released
+    size_t used = mallinfo2().uordblks;
+    for (int i = 0; i < 50; i++) {
+        inflate(stream.substr(0, stream.size() / 2), written);
+    }
+    CHECK(mallinfo2().uordblks <= used + 1024);
+    printf("RESULT %zu bytes compressed to %zu bytes, %zu bytes allocated after 50 truncated streams\n", data.size(), stream.size(),
+           mallinfo2().uordblks - min(used, mallinfo2().uordblks));
+
+    return finish();
+}
@@ -0,0 +1,40 @@
+#include <QEMSHostTest.h>
+#include <QEMSJobQueue.h>
+#include <atomic>
+
+/**
+ * Runs jobs in the job queue. The queue is busy from the enqueue until the job finished, also while the job task takes it from the queue, so the guards of
+ * the web server never run at the same time as a job. The names of the jobs are escaped in the status.
+ */
+
+using namespace QEMSHostTest;
+
+int main() {
+    QEMSJobQueue queue;
+    CHECK(!queue.isBusy());
+
+    // the queue is polled while the job task takes the jobs from the queue and executes them
+    std::atomic<int> running(0);
+    std::atomic<bool> overlap(false);
+    for (int i = 0; i < 200; i++) {
+        uint32_t id = queue.enqueue("job", [&](QEMSJobQueue::Job &job) {
+            running++;
+            delay(i % 3);
+            running--;
+            return true;
+        });
+        CHECK(id != 0);
+        while (queue.isBusy()) {
+        }
+        overlap = overlap || running > 0 || queue.getJobStatus(id).indexOf("\"done\"") < 0;
+    }
+    CHECK(!overlap);
+
+    uint32_t id = queue.enqueue("delete a\"b\\c\n.csv", [](QEMSJobQueue::Job &job) { return true; });
+    while (queue.isBusy()) {
+    }
+    CHECK(queue.getJobStatus(id).indexOf("\"name\":\"delete a\\\"b\\\\c\\u000a.csv\"") >= 0);
+    CHECK(queue.getJobsStatus().indexOf("a\\\"b") >= 0);
+
+    return finish();
+}
@@ -0,0 +1,124 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+#include <QEMSMappedDataManager.h>
+#include <atomic>
+#include <thread>
+
+/**
+ * Runs the memory mapped data manager on the image file the flash partition is replaced with on the host. The image must provide the values of the RAM
+ * window, be mapped again after a reboot and stay readable while updates rebuild the slots: a task reading the values concurrently must only see the old or
+ * the new values.
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief replaces the co2 data file through a validated update, like an upload.
+ */
+static bool update(QEMSDataSource &manager, const std::string &content) {
+    File file = LittleFS.open("/co2.csv.tmp", FILE_WRITE);
+    file.write((const uint8_t *)content.data(), content.size());
+    file.close();
+
+    if (!manager.prepareUpdate("/co2.csv", "/co2.csv.tmp")) {
+        return false;
+    }
+    LittleFS.rename("/co2.csv.tmp", "/co2.csv");
+    manager.commitUpdate();
+    return true;
+}
+
+int main() {
+    useFileSystem();
+    remove(FLASH_IMAGE_FILE);
+    setNow(at("28.03.2023 09:00:07"));
+
+    QEMSTimeManager timeManager;
+    QEMSDataManager<uint16_t> window(&timeManager);
+    window.addChannel("/co2.csv");
+    window.addChannel("/costs.csv");
+    window.loadDataFromFile();
+
+    std::vector<Record> co2 = readCsv("/co2.csv");
+    std::string original;
+    std::string constant;
+    for (const Record &record : co2) {
+        original += stamp(record.time) + ";" + std::to_string(record.values[0] / 100) + "\n";
+        constant += stamp(record.time) + ";0.25\n";
+    }
+    time_t now = g_hostNow;
+
+    {
+        QEMSMappedDataManager mapped(&timeManager);
+        mapped.addChannel("/co2.csv");
+        mapped.addChannel("/costs.csv");
+        mapped.loadDataFromFile();
+        CHECK(mapped.isReady());
+
+        // the image holds the records of the files up to the last one of the costs file, which ends a minute earlier
+        std::vector<Record> costs = readCsv("/costs.csv");
+        size_t common = 0;
+        while (common < co2.size() && co2[common].time <= costs.back().time) {
+            common++;
+        }
+        static time_t times[10000];
+        static float values[10000];
+        CHECK(mapped.getRecords(0, 0, INT32_MAX, times, values, 10000) == common);
+
+        // the values of the loaded day are those of the window, after the first record of the window passed which is never shown
+        bool equal = true;
+        for (time_t time = now + 30; time < now + 86400 - 3600; time += 61) {
+            setNow(time);
+            int mappedValues[MAX_CHANNELS];
+            int windowValues[MAX_CHANNELS];
+            equal = equal && mapped.getActiveValues(mappedValues) && window.getActiveValues(windowValues) && mappedValues[0] == windowValues[0] &&
+                    mappedValues[1] == windowValues[1];
+        }
+        setNow(now);
+        CHECK(equal);
+    }
+
+    // after a reboot the image of the unchanged files is mapped again
+    QEMSMappedDataManager mapped(&timeManager);
+    mapped.addChannel("/co2.csv");
+    mapped.addChannel("/costs.csv");
+    double start = nowUs();
+    mapped.loadDataFromFile();
+    printf("Mapped the existing image in %.1f ms\n", (nowUs() - start) / 1000);
+    CHECK(mapped.isReady());
+
+    int before[MAX_CHANNELS];
+    CHECK(mapped.getActiveValues(before));
+
+    // every update rebuilds the slot of the previous image while another task keeps reading
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> reads(0);
+    std::atomic<uint32_t> unexpected(0);
+    std::thread reader([&]() {
+        time_t times[240];
+        float values[240];
+        while (!stop) {
+            int current[MAX_CHANNELS];
+            mapped.getActiveValues(current);
+            unexpected += current[0] != before[0] && current[0] != 25;
+            unexpected += mapped.getRecords(0, now, now + 3600, times, values, 240) != 240;
+            reads++;
+        }
+    });
+
+    for (int i = 0; i < 6; i++) {
+        CHECK(update(mapped, i % 2 == 0 ? constant : original));
+        int current[MAX_CHANNELS];
+        CHECK(mapped.getActiveValues(current));
+        CHECK(current[0] == (i % 2 == 0 ? 25 : before[0]));
+        CHECK(current[1] == before[1]);
+    }
+    stop = true;
+    reader.join();
+
+    printf("%d concurrent reads during 6 updates\n", reads.load());
+    CHECK(reads > 0);
+    CHECK(unexpected == 0);
+
+    return finish();
+}
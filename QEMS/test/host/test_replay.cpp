@@ -0,0 +1,57 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+#include <QEMSTimeManager.h>
+#include <QEMSWebServer.h>
+
+/**
+ * Sets the replay clock forward and back. Only setting it back counts as jump that makes the data task reload the records, changing the speed, stepping
+ * forward or returning to the real time after the replay of the fixture data does not. The replay form of the web page sets the replay clock, the script of
+ * the upload form on the same page only handles the upload form.
+ */
+
+using namespace QEMSHostTest;
+
+int main() {
+    QEMSTimeManager timeManager;
+    time_t start = at("29.03.2023 06:00:00");
+
+    uint32_t jumps = timeManager.getJumps();
+    timeManager.startReplay(start, 60);
+    CHECK(timeManager.isReplay() && timeManager.getJumps() == jumps + 1);
+
+    timeManager.setReplaySpeed(0);
+    CHECK(timeManager.getReplaySpeed() == 0 && timeManager.getJumps() == jumps + 1);
+
+    timeManager.advanceReplay(3600);
+    CHECK(timeManager.now() >= start + 3600 && timeManager.getJumps() == jumps + 1);
+
+    timeManager.startReplay(start + 7200, 1);
+    CHECK(timeManager.getJumps() == jumps + 1);
+
+    timeManager.startReplay(start - 86400, 1);
+    CHECK(timeManager.now() < start && timeManager.getJumps() == jumps + 2);
+
+    timeManager.stopReplay();
+    CHECK(!timeManager.isReplay() && timeManager.getJumps() == jumps + 2);
+
+    // the page submits the replay form to /replay, only the upload form is posted to /upload by its script
+    useFileSystem();
+    setNow(start);
+    QEMSDataManager<> dataManager(&timeManager);
+    dataManager.addChannel("/co2.csv");
+    dataManager.addChannel("/costs.csv");
+    dataManager.loadDataFromFile();
+    QEMSJobQueue jobQueue;
+    QEMSWebServer webServer(&dataManager, &timeManager, &jobQueue);
+    WebServer &server = *WebServer::current();
+    CHECK(server.request(HTTP_GET, "/") == 200);
+    String page = server.getContent();
+    CHECK(page.indexOf("<form action='replay'") >= 0 && page.indexOf("id='upload_form'") >= 0);
+    CHECK(page.indexOf("$('form')") < 0 && page.indexOf("$('#upload_form').submit(") >= 0);
+
+    CHECK(server.request(HTTP_GET, "/replay", {{"start", "29.03.2023 06:00:00"}, {"speed", "60"}}) == 200);
+    CHECK(timeManager.isReplay() && timeManager.getReplaySpeed() == 60);
+    timeManager.stopReplay();
+
+    return finish();
+}
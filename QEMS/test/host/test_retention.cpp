@@ -0,0 +1,79 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+#include <QEMSMappedDataManager.h>
+
+/**
+ * Drops the records of the first days from the fixture files with both data managers after the clock passed most of the loaded records. The records are
+ * reloaded even though a regular load would not provide enough of them, so neither the window nor the image shows the dropped records afterwards. The
+ * shortened files are reported to the file listener.
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief copies the fixture files without the files the data managers created for them.
+ */
+static void resetFiles() {
+    useFileSystem();
+    for (const char *file : {"/co2.csv", "/costs.csv"}) {
+        for (const char *suffix : {CSV_INDEX_SUFFIX, AGGREGATE_SUFFIX, ARCHIVE_SUFFIX, CHECKPOINT_SUFFIX, SEGMENT_SUFFIX}) {
+            LittleFS.remove((String(file) + suffix).c_str());
+        }
+    }
+    remove(FLASH_IMAGE_FILE);
+}
+
+static void dropHistory(QEMSDataSource &manager, const char *name) {
+    std::vector<Record> co2 = readCsv("/co2.csv");
+    time_t last = co2.back().time;
+    time_t common = readCsv("/costs.csv").back().time; // the costs file ends a minute earlier
+
+    // the records of the last 200 records are loaded, then the clock passes most of them
+    setNow(last - 200 * 15 + 7);
+    manager.addChannel("/co2.csv");
+    manager.addChannel("/costs.csv");
+    manager.loadDataFromFile();
+    CHECK(manager.isReady());
+    setNow(last - 50 * 15 + 7);
+
+    // the records are dropped up to the start of the day in UTC
+    time_t before = at("30.03.2023 00:00:00");
+    before -= before % 86400;
+    uint32_t generation = manager.getGeneration();
+    std::map<String, size_t> written;
+    manager.setFileListener([&](String path, size_t size, uint32_t crc) { written[path] = size; });
+    CHECK(manager.dropHistory(before));
+    CHECK(manager.getGeneration() != generation);
+    CHECK(written.size() == 2 && written["/co2.csv"] == LittleFS.open("/co2.csv").size());
+
+    std::vector<Record> kept = readCsv("/co2.csv");
+    CHECK(kept.size() < co2.size() && kept.front().time >= before && kept.back().time == last);
+
+    // the dropped records are gone, the kept ones are still provided
+    static time_t times[10000];
+    static float values[10000];
+    uint16_t dropped = manager.getRecords(0, 0, before, times, values, 10000);
+    uint16_t count = manager.getRecords(0, g_hostNow, common + 1, times, values, 10000);
+    CHECK(dropped == 0);
+    CHECK(count == 46 && times[count - 1] == common);
+
+    printf("RESULT %-6s kept %zu of %zu records, %d dropped records provided, %d future records\n", name, kept.size(), co2.size(), dropped, count);
+}
+
+int main() {
+    QEMSTimeManager timeManager;
+
+    resetFiles();
+    {
+        QEMSDataManager<uint16_t> window(&timeManager);
+        dropHistory(window, "window");
+    }
+
+    resetFiles();
+    {
+        QEMSMappedDataManager mapped(&timeManager);
+        dropHistory(mapped, "mapped");
+    }
+
+    return finish();
+}
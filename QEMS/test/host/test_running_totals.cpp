@@ -0,0 +1,101 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+#include <QEMSMappedDataManager.h>
+#include <QEMSRunningTotals.h>
+
+/**
+ * Keeps the running totals with both data managers. Only the data task restarts them from the aggregates of the data files, reading the active values adds
+ * the records the clock passed and leaves the totals as they are after other records were loaded, until they were restarted.
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief returns the number of co2 records from the start of the local day up to the passed time (inclusive).
+ */
+static uint32_t countToday(const std::vector<Record> &records, time_t now) {
+    struct tm ts;
+    localtime_r(&now, &ts);
+    ts.tm_hour = ts.tm_min = ts.tm_sec = 0;
+    ts.tm_isdst = -1;
+    time_t dayStart = mktime(&ts);
+    return std::count_if(records.begin(), records.end(), [&](const Record &record) { return record.time >= dayStart && record.time <= now; });
+}
+
+/**
+ * @brief returns the savings of the co2 records from the start of the local day up to the passed time (inclusive) in percent hours.
+ */
+static double sumToday(const std::vector<Record> &records, time_t now) {
+    struct tm ts;
+    localtime_r(&now, &ts);
+    ts.tm_hour = ts.tm_min = ts.tm_sec = 0;
+    ts.tm_isdst = -1;
+    time_t dayStart = mktime(&ts);
+    double sum = 0;
+    for (const Record &record : records) {
+        sum += record.time >= dayStart && record.time <= now ? record.values[0] : 0;
+    }
+    return sum * 15 / 3600;
+}
+
+static void keepTotals(QEMSDataSource &manager, const char *name) {
+    useFileSystem();
+    remove(FLASH_IMAGE_FILE);
+    std::vector<Record> co2 = readCsv("/co2.csv");
+    setNow(at("29.03.2023 12:00:07"));
+    manager.addChannel("/co2.csv");
+    manager.addChannel("/costs.csv");
+    manager.loadDataFromFile();
+    CHECK(manager.isReady());
+
+    // the active values do not start the totals
+    int values[MAX_CHANNELS];
+    QEMSAggregate today, week;
+    CHECK(manager.getActiveValues(values));
+    CHECK(!manager.getRunningTotals(0, today, week));
+
+    // the restart covers the full minutes, the records of the current minute are added by the active values
+    CHECK(manager.restartTotals());
+    CHECK(!manager.restartTotals());
+    CHECK(manager.getActiveValues(values));
+    CHECK(manager.getRunningTotals(0, today, week));
+    CHECK(today.count == countToday(co2, g_hostNow) && week.count > today.count);
+
+    // the passed records are added by the active values
+    setNow(g_hostNow + 600);
+    CHECK(manager.getActiveValues(values));
+    CHECK(manager.getRunningTotals(0, today, week));
+    CHECK(today.count == countToday(co2, g_hostNow));
+
+    // after a reload the records are not added until the totals were restarted
+    uint32_t count = today.count;
+    manager.loadDataFromFile();
+    setNow(g_hostNow + 600);
+    CHECK(manager.getActiveValues(values));
+    CHECK(manager.getRunningTotals(0, today, week));
+    CHECK(today.count == count);
+    CHECK(manager.restartTotals());
+    CHECK(manager.getActiveValues(values));
+    CHECK(manager.getRunningTotals(0, today, week));
+    CHECK(today.count == countToday(co2, g_hostNow));
+
+    // the savings are accumulated over the records, not averaged
+    float hours = QEMSRunningTotals::getPercentHours(today);
+    CHECK(fabs(hours - sumToday(co2, g_hostNow)) < 0.01 * hours + 1);
+    CHECK(QEMSRunningTotals::getPercentHours(week) > hours);
+
+    printf("RESULT %-6s %d records today, %d this week, %.0f %%h today\n", name, today.count, week.count, hours);
+}
+
+int main() {
+    QEMSTimeManager timeManager;
+    {
+        QEMSDataManager<uint16_t> window(&timeManager);
+        keepTotals(window, "window");
+    }
+    {
+        QEMSMappedDataManager mapped(&timeManager);
+        keepTotals(mapped, "mapped");
+    }
+    return finish();
+}
@@ -0,0 +1,111 @@
+#include <QEMSDataManager.h>
+#include <QEMSHostTest.h>
+#include <QEMSWebServer.h>
+
+/**
+ * Uploads data files through the upload handler of the web server: valid files replace the data file and its records, invalid ones are rejected and leave
+ * the data file untouched. The upload is written in whole blocks, data files are validated by a background job. Compressed uploads are limited to the free
+ * space by their decompressed size. A file index that cannot be built is reported on the page instead of formatting the file system.
+ */
+
+using namespace QEMSHostTest;
+
+/**
+ * @brief returns the data file with all values set to the passed one.
+ */
+static std::string withValue(const char *path, const char *value) {
+    std::string result;
+    for (const Record &record : readCsv(path)) {
+        result += stamp(record.time) + ";" + value + "\n";
+    }
+    return result;
+}
+
+int main() {
+    useFileSystem();
+    setNow(at("28.03.2023 09:00:07"));
+
+    QEMSTimeManager timeManager;
+    QEMSDataManager<> dataManager(&timeManager);
+    uint8_t co2 = dataManager.addChannel("/co2.csv");
+    uint8_t costs = dataManager.addChannel("/costs.csv");
+    dataManager.loadDataFromFile();
+    QEMSJobQueue jobQueue;
+    QEMSWebServer webServer(&dataManager, &timeManager, &jobQueue);
+    WebServer &server = *WebServer::current();
+
+    int before[MAX_CHANNELS];
+    CHECK(dataManager.getActiveValues(before));
+
+    // a valid upload replaces the data file and the active records, the data is written in whole blocks
+    std::string upload = withValue("/co2.csv", "0.5");
+    size_t writes = g_hostFsWrites;
+    CHECK(server.upload("/upload", "CO2.csv", upload) == 302);
+    CHECK(server.getHeader("X-Job-Id").length() > 0);
+    CHECK(waitForJob(server).indexOf("\"done\"") >= 0);
+    CHECK(g_hostFsWrites - writes >= (upload.size() + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE);
+
+    int values[MAX_CHANNELS];
+    CHECK(dataManager.getActiveValues(values));
+    CHECK(values[co2] == 50);
+    CHECK(values[costs] == before[costs]);
+    CHECK(LittleFS.open("/co2.csv").size() == upload.size());
+    CHECK(!LittleFS.exists("/co2.csv.tmp"));
+    CHECK(LittleFS.exists("/co2.csv.idx"));
+
+    // an invalid upload fails its job, the data file and the records stay
+    CHECK(server.upload("/upload", "co2.csv", "28.03.2023 09:00:00;abc\n") == 302);
+    CHECK(waitForJob(server).indexOf("\"failed\"") >= 0);
+    CHECK(dataManager.getActiveValues(values));
+    CHECK(values[co2] == 50);
+    CHECK(LittleFS.open("/co2.csv").size() == upload.size());
+    CHECK(!LittleFS.exists("/co2.csv.tmp"));
+    CHECK(!LittleFS.exists("/co2.csv.tmp.idx"));
+
+    // files that are not data files are stored as they are
+    CHECK(server.upload("/upload", "notes.txt", "notes") == 302);
+    CHECK(server.request(HTTP_GET, "/notes.txt") == 200);
+    CHECK(server.getContent() == "notes");
+
+    // the free space is read from the file system, a file written after the file index was built is counted
+    File filler = LittleFS.open("/filler.bin", FILE_WRITE);
+    std::string fill(LittleFS.totalBytes() - LittleFS.usedBytes() - upload.size() / 2, 'x');
+    filler.write((const uint8_t *)fill.data(), fill.size());
+    filler.close();
+    CHECK(server.upload("/upload", "co2.csv", upload) == 500);
+    CHECK(!LittleFS.exists("/co2.csv.tmp"));
+
+    // a compressed upload fits before it is decompressed, the decompressed data is limited to the free space
+    std::string compressed = gzip(upload);
+    CHECK(compressed.size() < fill.size() / 4);
+    CHECK(server.upload("/upload", "co2.csv.gz", compressed) == 500);
+    CHECK(!LittleFS.exists("/co2.csv.tmp"));
+    CHECK(LittleFS.open("/co2.csv").size() == upload.size());
+    LittleFS.remove("/filler.bin");
+    CHECK(server.upload("/upload", "co2.csv.gz", compressed) == 302);
+    CHECK(waitForJob(server).indexOf("\"done\"") >= 0);
+    CHECK(LittleFS.open("/co2.csv").size() == upload.size());
+
+    // deleting a data file makes the data manager drop its records
+    CHECK(dataManager.isReady());
+    CHECK(server.request(HTTP_GET, "/delete", {{"name", "co2.csv"}}) == 302);
+    CHECK(waitForJob(server).indexOf("\"done\"") >= 0);
+    CHECK(!LittleFS.exists("/co2.csv"));
+    CHECK(!dataManager.isFileAvailable());
+    CHECK(!dataManager.isReady());
+
+    // without index the page shows an error and keeps the files until the index was rebuilt
+    g_hostFsRoot = "missing";
+    QEMSWebServer unindexed(&dataManager, &timeManager, &jobQueue);
+    g_hostFsRoot = "fs";
+    WebServer &unindexedServer = *WebServer::current();
+    CHECK(unindexedServer.request(HTTP_GET, "/") == 200);
+    CHECK(unindexedServer.getContent().indexOf("File index unavailable") >= 0 && unindexedServer.getContent().indexOf("notes.txt") < 0);
+    CHECK(LittleFS.exists("/notes.txt") && LittleFS.exists("/costs.csv"));
+    CHECK(unindexedServer.request(HTTP_GET, "/reindex") == 302);
+    waitForJob(unindexedServer);
+    CHECK(unindexedServer.request(HTTP_GET, "/") == 200);
+    CHECK(unindexedServer.getContent().indexOf("notes.txt") >= 0);
+
+    return finish();
+}
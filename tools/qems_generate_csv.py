@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Generates synthetic QEMS data files in the device format "dd.mm.yyyy HH:MM:SS;value[;value...]" with values from 0 .. 1.
+
+The timestamps are local times of the device time zone, like the records the device parses with mktime(). Examples:
+
+    # a day of records every 15 seconds, starting now
+    qems_generate_csv.py co2.csv --records 5760
+
+    # 1M records with jitter, gaps and swapped rows in three columns, compressed for the upload
+    qems_generate_csv.py big.csv.gz --records 1000000 --start "28.03.2023 00:00:00" --jitter 3 --gap-rate 0.001 --gap-length 600 \\
+        --out-of-order-rate 0.0001 --columns 3
+"""
+
+import argparse
+import gzip
+import math
+import os
+import random
+import sys
+import time
+
+TIME_FORMAT = "%d.%m.%Y %H:%M:%S"
+
+# the time zone configured by QEMSTimeManager, CET with daylight saving time
+DEVICE_TZ = "CET-1CEST,M3.5.0,M10.5.0/3"
+
+
+def parse_start(value):
+    if value == "now":
+        return int(time.time())
+    if value.isdigit():
+        return int(value)
+    return int(time.mktime(time.strptime(value, TIME_FORMAT)))
+
+
+def value_at(shape, rng, epoch, column, index):
+    """Returns a value from 0 .. 1 for a record, each column with its own phase."""
+    if shape == "random":
+        return rng.random()
+    if shape == "ramp":
+        return (index % 1000) / 999.0
+    day = (epoch % 86400) / 86400.0
+    base = 0.5 + 0.4 * math.sin(2 * math.pi * (day + column / 7.0))
+    return min(max(base + rng.uniform(-0.1, 0.1), 0.0), 1.0)
+
+
+def generate_lines(args):
+    """Yields the records, each one as line including the line break."""
+    rng = random.Random(args.seed)
+    value_format = "%." + str(args.decimals) + "f"
+    separator = "," if args.decimal_comma else "."
+    jitter = min(args.jitter, (args.interval - 1) // 2)
+
+    epoch = args.start
+    pending = None
+    for index in range(args.records):
+        if args.gap_rate > 0 and rng.random() < args.gap_rate:
+            epoch += args.gap_length
+
+        stamp = epoch + (rng.randint(-jitter, jitter) if jitter > 0 else 0)
+        values = (value_format % value_at(args.shape, rng, epoch, c, index) for c in range(args.columns))
+        line = time.strftime(TIME_FORMAT, time.localtime(stamp)) + ";" + ";".join(values).replace(".", separator) + "\n"
+        epoch += args.interval
+
+        # a swapped row is held back and written after the next one
+        if pending is None and args.out_of_order_rate > 0 and rng.random() < args.out_of_order_rate:
+            pending = line
+            continue
+        yield line
+        if pending is not None:
+            yield pending
+            pending = None
+
+    if pending is not None:
+        yield pending
+
+
+def create_parser():
+    parser = argparse.ArgumentParser(description="Generates synthetic QEMS data files.")
+    parser.add_argument("output", help="the data file, '-' for stdout, compressed with gzip if it ends with .gz")
+    parser.add_argument("--records", type=int, default=10000, help="number of records (default 10000)")
+    parser.add_argument("--start", default="now", help="first timestamp, 'dd.mm.yyyy HH:MM:SS', epoch or 'now' (default)")
+    parser.add_argument("--interval", type=int, default=15, help="seconds between two records (default 15)")
+    parser.add_argument("--jitter", type=int, default=0, help="maximum deviation of a timestamp in seconds, less than half the interval")
+    parser.add_argument("--gap-rate", type=float, default=0.0, help="probability of a gap before a record")
+    parser.add_argument("--gap-length", type=int, default=3600, help="seconds without records of a gap (default 3600)")
+    parser.add_argument("--out-of-order-rate", type=float, default=0.0, help="probability of a record swapped with the next one")
+    parser.add_argument("--columns", type=int, default=1, help="number of value columns (default 1)")
+    parser.add_argument("--decimals", type=int, default=8, help="number of decimals of the values (default 8)")
+    parser.add_argument("--decimal-comma", action="store_true", help="writes the values with decimal comma")
+    parser.add_argument("--shape", choices=["daily", "random", "ramp"], default="daily", help="course of the values (default daily)")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the random numbers, the same seed creates the same file")
+    parser.add_argument("--tz", default=DEVICE_TZ, help="time zone of the timestamps (default: the device time zone)")
+    return parser
+
+
+def generate(argv):
+    """Writes the data file for the command line arguments and returns the parsed arguments."""
+    args = create_parser().parse_args(argv)
+    os.environ["TZ"] = args.tz
+    time.tzset()
+    args.start = parse_start(args.start)
+
+    if args.output == "-":
+        out = sys.stdout
+    elif args.output.endswith(".gz"):
+        out = gzip.open(args.output, "wt", newline="")
+    else:
+        out = open(args.output, "w", newline="")
+
+    try:
+        out.writelines(generate_lines(args))
+    finally:
+        if out is not sys.stdout:
+            out.close()
+    return args
+
+
+if __name__ == "__main__":
+    generate(sys.argv[1:])
@@ -0,0 +1,269 @@
+#!/usr/bin/env python3
+"""Measures the data paths of a QEMS device with synthetic data files of growing size, see qems_generate_csv.py.
+
+For every size a data file is generated, uploaded, which includes parsing and loading it on the device, then records and aggregates of random ranges
+are queried and the file listing is rendered. The results contain the times seen by the client and the memory of the device reported by /api/status,
+the minimum free heap since boot shows the peak usage. The data file on the device is replaced during the run and restored afterwards.
+
+The LittleFS partition of the device has 0x110000 bytes, a data file of 10k records has about 310 kB and is uploaded next to the one it replaces, so the
+default sizes stop at 10k. Sizes that do not fit into the free space reported by the device are skipped. Larger sizes run on the host with the runner of
+the host tests, QEMS/test/host/bench_scale, which uploads the same files through the web server of the firmware and reports the same keys; --fs-bytes
+enlarges its file system. Examples:
+
+    qems_scale.py 192.168.178.42 --sizes 1k,2k,5k,10k --gzip --out scale.csv
+
+    qems_scale.py --host-runner QEMS/test/host/build/bench_scale --sizes 10k,100k,1M --fs-bytes 1000000000
+"""
+
+import argparse
+import csv
+import gzip
+import http.client
+import json
+import os
+import random
+import shlex
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+import qems_generate_csv
+
+CHUNK_SIZE = 64 * 1024
+
+
+def parse_size(value):
+    factors = {"k": 1000, "m": 1000000}
+    return int(float(value[:-1]) * factors[value[-1].lower()]) if value[-1].lower() in factors else int(value)
+
+
+class Device:
+    """HTTP client of the QEMS web server, every request uses a new connection like a browser without keep alive."""
+
+    def __init__(self, host, timeout):
+        self.host = host
+        self.timeout = timeout
+
+    def get(self, path):
+        """Returns the status, the body and the seconds until the body was received."""
+        start = time.monotonic()
+        connection = http.client.HTTPConnection(self.host, timeout=self.timeout)
+        try:
+            connection.request("GET", path)
+            response = connection.getresponse()
+            body = response.read()
+            return response.status, body, time.monotonic() - start
+        finally:
+            connection.close()
+
+    def get_json(self, path):
+        status, body, _ = self.get(path)
+        return json.loads(body) if status == 200 else {}
+
+    def download(self, name, path):
+        status, body, _ = self.get("/" + name)
+        if status != 200:
+            return False
+        with open(path, "wb") as out:
+            out.write(body)
+        return True
+
+    def upload(self, path, name):
+        """Uploads a file as multipart form like the upload form, returns the status and the seconds until the device answered."""
+        boundary = "qems%016x" % random.getrandbits(64)
+        head = ('--%s\r\nContent-Disposition: form-data; name="update"; filename="%s"\r\nContent-Type: application/octet-stream\r\n\r\n' % (boundary, name)).encode()
+        tail = ("\r\n--%s--\r\n" % boundary).encode()
+
+        start = time.monotonic()
+        connection = http.client.HTTPConnection(self.host, timeout=self.timeout)
+        try:
+            connection.putrequest("POST", "/upload")
+            connection.putheader("Content-Type", "multipart/form-data; boundary=" + boundary)
+            connection.putheader("Content-Length", str(len(head) + os.path.getsize(path) + len(tail)))
+            connection.endheaders()
+            connection.send(head)
+            with open(path, "rb") as data:
+                for chunk in iter(lambda: data.read(CHUNK_SIZE), b""):
+                    connection.send(chunk)
+            connection.send(tail)
+            response = connection.getresponse()
+            response.read()
+            return response.status, time.monotonic() - start
+        finally:
+            connection.close()
+
+    def wait_for_jobs(self):
+        """Waits until no background job runs, the device rejects uploads until then."""
+        while any(job.get("status") in ("queued", "running") for job in self.get_json("/jobs") or []):
+            time.sleep(0.5)
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(int(len(ordered) * fraction), len(ordered) - 1)] if ordered else 0
+
+
+def measure_lookups(device, args, first, last):
+    """Returns the median and 95th percentile in milliseconds of /api/records and /api/aggregate for random ranges of the records."""
+    rng = random.Random(args.seed)
+    records, aggregates = [], []
+    for _ in range(args.lookups):
+        start = rng.randint(first, max(first, last - args.lookup_span))
+        query = "channel=%d&from=%d&to=%d" % (args.channel, start, start + args.lookup_span)
+        records.append(device.get("/api/records?" + query)[2] * 1000)
+        aggregates.append(device.get("/api/aggregate?" + query)[2] * 1000)
+    return statistics.median(records), percentile(records, 0.95), statistics.median(aggregates), percentile(aggregates, 0.95)
+
+
+def generate_file(args, records, directory, generator_args=()):
+    """Generates the data file of a size, returns its path, the upload name, the first and last timestamp and the seconds it took."""
+    name = args.file + (".gz" if args.gzip else "")
+    path = os.path.join(directory, name)
+    start = int(time.time()) - args.history * 3600
+
+    generated = time.monotonic()
+    generator = qems_generate_csv.generate([path, "--records", str(records), "--start", str(start), "--interval", str(args.interval)] +
+                                           list(generator_args) + shlex.split(args.generator_args))
+    return path, name, start, start + records * generator.interval, time.monotonic() - generated
+
+
+def stored_size(path):
+    """Returns the bytes the file takes on the device, compressed uploads are stored decompressed."""
+    if not path.endswith(".gz"):
+        return os.path.getsize(path)
+    with gzip.open(path, "rb") as data:
+        return sum(len(chunk) for chunk in iter(lambda: data.read(CHUNK_SIZE), b""))
+
+
+def run_size(device, args, records, directory):
+    path, name, start, last, generated = generate_file(args, records, directory)
+    result = {
+        "records": records,
+        "bytes": os.path.getsize(path),
+        "generate_s": round(generated, 2),
+    }
+
+    device.wait_for_jobs()
+    before = device.get_json("/api/status")
+    free = before.get("fsTotal", 0) - before.get("fsUsed", 0)
+    if stored_size(path) > free:
+        result["skipped"] = "needs %d bytes, %d free" % (stored_size(path), free)
+        os.remove(path)
+        return result
+
+    status, upload = device.upload(path, name)
+    after = device.get_json("/api/status")
+
+    result.update({
+        "upload_status": status,
+        "upload_s": round(upload, 3),
+        "heap_before": before.get("heap"),
+        "heap_after": after.get("heap"),
+        "min_heap": after.get("minHeap"),
+        "max_alloc": after.get("maxAlloc"),
+        "fs_used": after.get("fsUsed"),
+        "ready": after.get("ready"),
+    })
+
+    if status in (200, 302):
+        lookups = measure_lookups(device, args, start, last)
+        for key, value in zip(("records_ms", "records_p95_ms", "aggregate_ms", "aggregate_p95_ms"), lookups):
+            result[key] = round(value, 1)
+
+        _, page, page_s = device.get("/")
+        result["page_ms"] = round(page_s * 1000, 1)
+        result["page_bytes"] = len(page)
+
+    os.remove(path)
+    return result
+
+
+def run_host_size(args, records, directory):
+    """Runs the host runner with the data file of a size in the temporary directory, its file system is created there."""
+    # the timestamps are written in standard time, the repeated hour at the end of daylight saving time would make files of many days unordered
+    path, _, start, last, generated = generate_file(args, records, directory, ["--tz", "CET-1"])
+    command = [os.path.abspath(args.host_runner), "--file=" + path, "--records=%d" % records, "--first=%d" % start, "--last=%d" % last,
+               "--history=%d" % args.history, "--lookups=%d" % args.lookups, "--lookup-span=%d" % args.lookup_span, "--seed=%d" % args.seed]
+    if args.fs_bytes:
+        command.append("--fs-bytes=%d" % args.fs_bytes)
+
+    output = subprocess.run(command, cwd=directory, env=dict(os.environ, QEMS_HOST_QUIET="1"), stdout=subprocess.PIPE, text=True,
+                            timeout=args.timeout).stdout
+    result = {"records": records, "bytes": os.path.getsize(path), "generate_s": round(generated, 2)}
+    for line in output.splitlines():
+        if line.startswith("RESULT "):
+            result.update({key: value for key, value in json.loads(line[len("RESULT "):]).items() if key not in result})
+    os.remove(path)
+    return result
+
+
+def create_parser():
+    parser = argparse.ArgumentParser(description="Measures the data paths of a QEMS device with synthetic data files of growing size.")
+    parser.add_argument("host", nargs="?", help="address of the device, not needed with --host-runner")
+    parser.add_argument("--sizes", default="1k,2k,5k,10k", help="numbers of records, e.g. 1k,2k,5k,10k (default), larger ones with --host-runner")
+    parser.add_argument("--host-runner", help="runs the sizes on the host with this build of QEMS/test/host/bench_scale instead of a device")
+    parser.add_argument("--fs-bytes", type=int, help="size of the file system of the host runner (default the 0x110000 bytes of the device)")
+    parser.add_argument("--file", default="co2.csv", help="the data file that is replaced (default co2.csv)")
+    parser.add_argument("--channel", type=int, default=0, help="the channel loaded from the file (default 0)")
+    parser.add_argument("--gzip", action="store_true", help="uploads the data files compressed")
+    parser.add_argument("--interval", type=int, default=15, help="seconds between two records (default 15)")
+    parser.add_argument("--history", type=int, default=1, help="hours of records before the current time (default 1)")
+    parser.add_argument("--generator-args", default="", help="further arguments of qems_generate_csv.py, e.g. '--jitter 3 --gap-rate 0.001'")
+    parser.add_argument("--lookups", type=int, default=50, help="number of random ranges queried per size (default 50)")
+    parser.add_argument("--lookup-span", type=int, default=3600, help="seconds of a queried range (default 3600)")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the queried ranges")
+    parser.add_argument("--timeout", type=float, default=600, help="seconds to wait for an answer of the device (default 600)")
+    parser.add_argument("--keep", action="store_true", help="keeps the last generated file on the device instead of restoring the original one")
+    parser.add_argument("--out", help="CSV file the results are written to")
+    return parser
+
+
+def run_device(args):
+    """Runs the sizes on the device, its data file is restored afterwards."""
+    device = Device(args.host, args.timeout)
+    results = []
+
+    with tempfile.TemporaryDirectory() as directory:
+        original = os.path.join(directory, "original_" + args.file)
+        has_original = device.download(args.file, original)
+
+        try:
+            for size in args.sizes.split(","):
+                result = run_size(device, args, parse_size(size), directory)
+                results.append(result)
+                print(json.dumps(result), flush=True)
+        finally:
+            if has_original and not args.keep:
+                device.wait_for_jobs()
+                status, _ = device.upload(original, args.file)
+                print("Restored %s, status %d" % (args.file, status), file=sys.stderr)
+    return results
+
+
+def main(argv):
+    parser = create_parser()
+    args = parser.parse_args(argv)
+    if not args.host and not args.host_runner:
+        parser.error("the address of the device or --host-runner is required")
+
+    if args.host_runner:
+        results = []
+        with tempfile.TemporaryDirectory() as directory:
+            for size in args.sizes.split(","):
+                result = run_host_size(args, parse_size(size), directory)
+                results.append(result)
+                print(json.dumps(result), flush=True)
+    else:
+        results = run_device(args)
+
+    if args.out and results:
+        with open(args.out, "w", newline="") as out:
+            writer = csv.DictWriter(out, fieldnames=list(dict.fromkeys(key for result in results for key in result)))
+            writer.writeheader()
+            writer.writerows(results)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])